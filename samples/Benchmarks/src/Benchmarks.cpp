@@ -0,0 +1,586 @@
+//
+//  Benchmarks.cpp
+//  OculusSDKTest
+//
+//  Headless benchmarks of the library hot paths, no window, GL context or HMD needed.
+//  Usage: Benchmarks [results.json|-] [name filter]
+//
+
+#include "cinder/Rand.h"
+#include "cinder/Surface.h"
+
+#include "BufferRingSlots.h"
+#include "CameraStereoHMD.h"
+#include "CpuDistortion.h"
+#include "Distortion.h"
+#include "DistortionMesh.h"
+#include "FusionEngine.h"
+#include "HiddenAreaMask.h"
+#include "OculusVR.h"
+#include "PixelDensity.h"
+#include "Pose.h"
+#include "PoseHistory.h"
+#include "StereoCuller.h"
+#include "SyntheticSensor.h"
+#include "../../InstancedCubes/src/InstanceAnimator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ci;
+using namespace std;
+
+namespace {
+
+// Width over height of one DK1 eye
+const float kAspectRatio        = 0.8f;
+
+// Written by every benchmark so the compiler can't drop the work
+volatile float sSink = 0.0f;
+
+struct Result {
+    string  name;
+    size_t  opsPerRun;
+    size_t  runs;
+    // Nanoseconds per op
+    double  medianNs, minNs, maxNs;
+};
+
+class Suite {
+public:
+    Suite( const string &filter ) : mFilter( filter ) {}
+
+    //! Times \a fn, which performs \a opsPerRun ops, after a warmup run. Repeats for at least 5 runs and 200ms
+    template<typename Fn>
+    void run( const string &name, size_t opsPerRun, Fn fn )
+    {
+        if( ! matches( name ) )
+            return;
+
+        typedef chrono::high_resolution_clock Clock;
+        fn();
+
+        vector<double> times;
+        double total = 0.0;
+        while( times.size() < 5 || ( total < 0.2 && times.size() < 1000 ) ){
+            Clock::time_point begin = Clock::now();
+            fn();
+            double seconds = chrono::duration<double>( Clock::now() - begin ).count();
+            times.push_back( seconds * 1.0e9 / opsPerRun );
+            total += seconds;
+        }
+        sort( times.begin(), times.end() );
+
+        Result result;
+        result.name         = name;
+        result.opsPerRun    = opsPerRun;
+        result.runs         = times.size();
+        result.medianNs     = times[times.size() / 2];
+        result.minNs        = times.front();
+        result.maxNs        = times.back();
+        mResults.push_back( result );
+
+        fprintf( stderr, "%-36s %12.1f ns/op  (min %.1f, max %.1f, %zu runs)\n", name.c_str(), result.medianNs, result.minNs, result.maxNs, result.runs );
+    }
+
+    bool matches( const string &name ) const { return mFilter.empty() || name.find( mFilter ) != string::npos; }
+
+    void writeJson( ostream &out ) const
+    {
+        char date[32];
+        time_t now = time( NULL );
+        strftime( date, sizeof( date ), "%Y-%m-%dT%H:%M:%SZ", gmtime( &now ) );
+
+        out << "{\n";
+        out << "  \"suite\": \"OculusSDKTest\",\n";
+        out << "  \"version\": 1,\n";
+        out << "  \"date\": \"" << date << "\",\n";
+        out << "  \"cores\": " << thread::hardware_concurrency() << ",\n";
+        out << "  \"distortionLanes\": " << ovr::CpuDistortion::getNumLanes() << ",\n";
+        out << "  \"cullingLanes\": " << ovr::StereoCuller::getNumLanes() << ",\n";
+        out << "  \"poseHistoryLanes\": " << ovr::PoseHistory::getNumLanes() << ",\n";
+        out << "  \"fusionLanes\": " << ovr::MadgwickFusion::getNumLanes() << ",\n";
+        out << "  \"results\": [\n";
+        for( size_t i = 0; i < mResults.size(); i++ ){
+            const Result &r = mResults[i];
+            char line[512];
+            snprintf( line, sizeof( line ), "    { \"name\": \"%s\", \"ops\": %zu, \"runs\": %zu, \"median_ns\": %.3f, \"min_ns\": %.3f, \"max_ns\": %.3f, \"ops_per_second\": %.1f }%s\n",
+                     r.name.c_str(), r.opsPerRun, r.runs, r.medianNs, r.minNs, r.maxNs, r.medianNs > 0.0 ? 1.0e9 / r.medianNs : 0.0, i + 1 < mResults.size() ? "," : "" );
+            out << line;
+        }
+        out << "  ]\n";
+        out << "}\n";
+    }
+
+private:
+    string          mFilter;
+    vector<Result>  mResults;
+};
+
+Quatf randQuat( Rand &rand )
+{
+    Quatf q( rand.nextFloat( -1.0f, 1.0f ), rand.nextFloat( -1.0f, 1.0f ), rand.nextFloat( -1.0f, 1.0f ), rand.nextFloat( -1.0f, 1.0f ) );
+    q.normalize();
+    return q;
+}
+
+void benchmarkCamera( Suite &suite )
+{
+    const size_t numUpdates = 1000;
+    Rand rand( 1 );
+    vector<Quatf> orientations( numUpdates );
+    for( size_t i = 0; i < numUpdates; i++ )
+        orientations[i] = randQuat( rand );
+
+    for( int fused = 1; fused >= 0; fused-- ){
+        CameraStereoHMD camera( 640, 800, 125.0f, 0.1f, 1000.0f );
+        camera.setEyeSeparation( 0.064f );
+        camera.setProjectionCenterOffset( 0.1453f );
+        camera.enableFusedUpdate( fused != 0 );
+        string suffix = fused ? "_fused" : "_unfused";
+
+        // A new head orientation every frame, then every matrix the sample reads
+        suite.run( "camera.modelview" + suffix, numUpdates, [&](){
+            float sum = 0.0f;
+            for( size_t i = 0; i < numUpdates; i++ ){
+                camera.setOrientation( orientations[i] );
+                sum += camera.getModelViewMatrixLeft().m[12] + camera.getModelViewMatrixRight().m[12];
+                sum += camera.getInverseModelViewMatrixLeft().m[12] + camera.getInverseModelViewMatrixRight().m[12];
+            }
+            sSink = sum;
+        } );
+
+        suite.run( "camera.projection" + suffix, numUpdates, [&](){
+            float sum = 0.0f;
+            for( size_t i = 0; i < numUpdates; i++ ){
+                camera.setProjectionCenterOffset( ( i & 1 ) ? 0.1453f : 0.1454f );
+                sum += camera.getProjectionMatrixLeft().m[8] + camera.getProjectionMatrixRight().m[8];
+            }
+            sSink = sum;
+        } );
+
+        suite.run( "camera.view_projection" + suffix, numUpdates, [&](){
+            float sum = 0.0f;
+            Matrix44f matrices[2];
+            for( size_t i = 0; i < numUpdates; i++ ){
+                camera.setOrientation( orientations[i] );
+                camera.getViewProjectionMatrices( matrices );
+                sum += matrices[0].m[12] + matrices[1].m[12];
+            }
+            sSink = sum;
+        } );
+    }
+}
+
+// Largest difference between the elements of two matrices, relative to their magnitude
+float matrixError( const Matrix44f &a, const Matrix44f &b )
+{
+    float error = 0.0f;
+    for( int i = 0; i < 16; i++ )
+        error = max( error, fabsf( a.m[i] - b.m[i] ) / max( 1.0f, fabsf( b.m[i] ) ) );
+    return error;
+}
+
+// Compares the matrices of both eyes from the fused and the unfused updates for random poses and offsets, returns false past the tolerance
+bool validateCamera( const Suite &suite )
+{
+    if( ! suite.matches( "camera.validate" ) )
+        return true;
+
+    const float tolerance = 1.0e-4f;
+    CameraStereoHMD fused( 640, 800, 125.0f, 0.1f, 1000.0f );
+    CameraStereoHMD unfused( 640, 800, 125.0f, 0.1f, 1000.0f );
+    unfused.enableFusedUpdate( false );
+
+    float modelView = 0.0f, inverseModelView = 0.0f, projection = 0.0f, inverseProjection = 0.0f;
+    Rand rand( 6 );
+    for( int i = 0; i < 1000; i++ ){
+        Vec3f eyePoint( rand.nextFloat( -10.0f, 10.0f ), rand.nextFloat( -10.0f, 10.0f ), rand.nextFloat( -10.0f, 10.0f ) );
+        Quatf orientation   = randQuat( rand );
+        float separation    = rand.nextFloat( 0.05f, 0.08f );
+        float offset        = rand.nextFloat( 0.1f, 0.2f );
+        for( CameraStereoHMD *camera : { &fused, &unfused } ){
+            camera->setEyePoint( eyePoint );
+            camera->setOrientation( orientation );
+            camera->setEyeSeparation( separation );
+            camera->setProjectionCenterOffset( offset );
+        }
+
+        modelView           = max( { modelView, matrixError( fused.getModelViewMatrixLeft(), unfused.getModelViewMatrixLeft() ), matrixError( fused.getModelViewMatrixRight(), unfused.getModelViewMatrixRight() ) } );
+        inverseModelView    = max( { inverseModelView, matrixError( fused.getInverseModelViewMatrixLeft(), unfused.getInverseModelViewMatrixLeft() ), matrixError( fused.getInverseModelViewMatrixRight(), unfused.getInverseModelViewMatrixRight() ) } );
+        projection          = max( { projection, matrixError( fused.getProjectionMatrixLeft(), unfused.getProjectionMatrixLeft() ), matrixError( fused.getProjectionMatrixRight(), unfused.getProjectionMatrixRight() ) } );
+        inverseProjection   = max( { inverseProjection, matrixError( fused.getInverseProjectionMatrixLeft(), unfused.getInverseProjectionMatrixLeft() ), matrixError( fused.getInverseProjectionMatrixRight(), unfused.getInverseProjectionMatrixRight() ) } );
+    }
+
+    const char *names[4]    = { "camera.validate_modelview", "camera.validate_inverse_modelview", "camera.validate_projection", "camera.validate_inverse_projection" };
+    float errors[4]         = { modelView, inverseModelView, projection, inverseProjection };
+    bool valid              = true;
+    for( int i = 0; i < 4; i++ ){
+        fprintf( stderr, "%-36s max error %.2e%s\n", names[i], errors[i], errors[i] > tolerance ? "  FAILED" : "" );
+        valid = valid && errors[i] <= tolerance;
+    }
+    return valid;
+}
+
+// Fences whose outcome is picked before each release(), a GPU reading the slots without a GL context
+class ScriptedFenceProvider : public ovr::FenceProvider {
+public:
+    enum State { SIGNALED, PENDING, TIMED_OUT };
+
+    ScriptedFenceProvider() : mNextState( SIGNALED ), mNumLive( 0 ) {}
+
+    virtual Fence   insertFence()
+    {
+        mNumLive++;
+        return new State( mNextState );
+    }
+    // A pending fence is signaled by a blocking wait, a timed out one never is
+    virtual bool    waitFence( Fence fence, uint64_t timeoutNs )
+    {
+        State state = *static_cast<State*>( fence );
+        return state == SIGNALED || ( state == PENDING && timeoutNs > 0 );
+    }
+    virtual void    deleteFence( Fence fence )
+    {
+        mNumLive--;
+        delete static_cast<State*>( fence );
+    }
+
+    State   mNextState;
+    int     mNumLive;
+};
+
+// Drives BufferRingSlots through each fence outcome and the wrap without fences, returns false if one goes wrong
+bool validateBufferRing( const Suite &suite )
+{
+    if( ! suite.matches( "buffer_ring.validate" ) )
+        return true;
+
+    bool signaled = false, pending = false, timedOut = false, noFences = false;
+    shared_ptr<ScriptedFenceProvider> fences( new ScriptedFenceProvider() );
+    {
+        ovr::BufferRingSlots slots( 2, fences );
+        slots.acquire();
+        slots.release();
+        slots.acquire();
+        slots.release();
+
+        // Slot 0 again, its fence is already signaled
+        bool orphan = slots.acquire();
+        signaled    = ! orphan && slots.getCurrent() == 0 && slots.getNumWaits() == 0 && slots.getNumOrphans() == 0;
+
+        // Still read by the GPU, acquire() blocks until it is done
+        fences->mNextState = ScriptedFenceProvider::PENDING;
+        slots.release();
+        fences->mNextState = ScriptedFenceProvider::SIGNALED;
+        slots.acquire();
+        slots.release();
+        orphan      = slots.acquire();
+        pending     = ! orphan && slots.getNumWaits() == 1 && slots.getNumOrphans() == 0;
+
+        // Never done within the wait, the storage is orphaned and no fence guards it anymore
+        fences->mNextState = ScriptedFenceProvider::TIMED_OUT;
+        slots.release();
+        fences->mNextState = ScriptedFenceProvider::SIGNALED;
+        slots.acquire();
+        slots.release();
+        orphan      = slots.acquire();
+        timedOut    = orphan && slots.getNumWaits() == 2 && slots.getNumOrphans() == 1 && fences->mNumLive == 0;
+        slots.release();
+    }
+    timedOut = timedOut && fences->mNumLive == 0;
+
+    // Without fences the storage is orphaned each time the ring wraps to slot 0, and only then
+    ovr::BufferRingSlots slots( 3, ovr::FenceProviderRef() );
+    noFences = true;
+    for( int i = 0; i < 7; i++ )
+        noFences = noFences && slots.acquire() == ( slots.getCurrent() == 0 );
+    noFences = noFences && slots.getNumOrphans() == 3 && slots.getNumWaits() == 0;
+
+    const char *names[4]    = { "buffer_ring.validate_signaled", "buffer_ring.validate_pending", "buffer_ring.validate_timed_out", "buffer_ring.validate_no_fences" };
+    bool results[4]         = { signaled, pending, timedOut, noFences };
+    bool valid              = true;
+    for( int i = 0; i < 4; i++ ){
+        fprintf( stderr, "%-36s %s\n", names[i], results[i] ? "ok" : "FAILED" );
+        valid = valid && results[i];
+    }
+    return valid;
+}
+
+void benchmarkConversions( Suite &suite )
+{
+    const size_t count = 100000;
+    Rand rand( 2 );
+
+    vector<OVR::Matrix4f> matrices( count );
+    vector<OVR::Quatf> quats( count );
+    vector<OVR::Vector3f> vectors( count );
+    for( size_t i = 0; i < count; i++ ){
+        for( int j = 0; j < 16; j++ )
+            matrices[i].M[j / 4][j % 4] = rand.nextFloat( -1.0f, 1.0f );
+        quats[i]    = OVR::Quatf( rand.nextFloat(), rand.nextFloat(), rand.nextFloat(), rand.nextFloat() );
+        vectors[i]  = OVR::Vector3f( rand.nextFloat(), rand.nextFloat(), rand.nextFloat() );
+    }
+
+    vector<Matrix44f> cinderMatrices( count );
+    vector<Quatf> cinderQuats( count );
+    vector<Vec3f> cinderVectors( count );
+
+    suite.run( "convert.matrix44", count, [&](){
+        for( size_t i = 0; i < count; i++ )
+            cinderMatrices[i] = ovr::toCinder( matrices[i] );
+        sSink = cinderMatrices[count - 1].m[5];
+    } );
+    suite.run( "convert.quat", count, [&](){
+        for( size_t i = 0; i < count; i++ )
+            cinderQuats[i] = ovr::toCinder( quats[i] );
+        sSink = cinderQuats[count - 1].w;
+    } );
+    suite.run( "convert.vec3", count, [&](){
+        for( size_t i = 0; i < count; i++ )
+            cinderVectors[i] = ovr::toCinder( vectors[i] );
+        sSink = cinderVectors[count - 1].x;
+    } );
+}
+
+void benchmarkDistortion( Suite &suite )
+{
+    const size_t numParams = 10000;
+    suite.run( "distortion.eye_params", numParams, [&](){
+        float sum = 0.0f;
+        for( size_t i = 0; i < numParams; i++ ){
+            ovr::EyeWarpParams params = ovr::EyeWarpParams::calc( ( i & 1 ) ? ovr::EYE_RIGHT : ovr::EYE_LEFT, kAspectRatio, ovr::DK1DistortionScale + i * 1.0e-6f );
+            sum += params.lensCenter.x + params.scaleIn.y;
+        }
+        sSink = sum;
+    } );
+
+    suite.run( "distortion.mesh_32x40", 1, [&](){
+        ovr::DistortionMeshRef mesh = ovr::DistortionMesh::create( ovr::DK1DistortionParams, ovr::DK1DistortionScale, ovr::DK1ChromaticAbCorrection, true, kAspectRatio );
+        sSink = (float) mesh->getVertices().size();
+    } );
+
+    suite.run( "distortion.density_map_16x20", 1, [&](){
+        ovr::PixelDensityMapRef map = ovr::PixelDensityMap::create( ovr::DK1DistortionParams, ovr::DK1DistortionScale, kAspectRatio );
+        sSink = map->getMaxDensity();
+    } );
+
+    suite.run( "distortion.hidden_area_mask", 1, [&](){
+        ovr::HiddenAreaMaskRef mask = ovr::HiddenAreaMask::create( ovr::DK1DistortionParams, ovr::DK1DistortionScale, ovr::DK1ChromaticAbCorrection, true, kAspectRatio, Vec2i( 2196, 1372 ) );
+        sSink = mask->getCoverage();
+    } );
+
+    // One 1280x800 frame from a side by side target at the lens pixel density
+    Surface8u source( 2196, 1372, false );
+    Rand rand( 3 );
+    Surface8u::Iter it = source.getIter();
+    while( it.line() ){
+        while( it.pixel() ){
+            it.r() = rand.nextUint() & 0xff;
+            it.g() = rand.nextUint() & 0xff;
+            it.b() = rand.nextUint() & 0xff;
+        }
+    }
+    Surface8u destination( 1280, 800, false );
+    for( size_t numThreads : { (size_t) 1, (size_t) 0 } ){
+        ovr::CpuDistortionRef distortion = ovr::CpuDistortion::create( true, numThreads );
+        suite.run( numThreads == 1 ? "distortion.cpu_frame_1thread" : "distortion.cpu_frame_all_cores", 1, [&](){
+            distortion->render( source, &destination );
+            sSink = destination.getData()[0];
+        } );
+    }
+}
+
+void benchmarkPoses( Suite &suite )
+{
+    const size_t count = 100000;
+    Rand rand( 4 );
+    vector<ovr::Pose> poses( count + 1 );
+    for( size_t i = 0; i <= count; i++ )
+        poses[i] = ovr::Pose( i * 0.001, randQuat( rand ), Vec3f( rand.nextFloat( -3.0f, 3.0f ), rand.nextFloat( -3.0f, 3.0f ), rand.nextFloat( -3.0f, 3.0f ) ) );
+
+    // 40ms ahead, roughly the motion to photon latency of the DK1
+    suite.run( "pose.predict", count, [&](){
+        float sum = 0.0f;
+        for( size_t i = 0; i < count; i++ )
+            sum += ovr::predictOrientation( poses[i].orientation, poses[i].angularVelocity, 0.04f ).w;
+        sSink = sum;
+    } );
+
+    suite.run( "pose.interpolate", count, [&](){
+        float sum = 0.0f;
+        for( size_t i = 0; i < count; i++ )
+            sum += ovr::interpolate( poses[i], poses[i + 1], poses[i].time + 0.0003 ).orientation.w;
+        sSink = sum;
+    } );
+
+    // The last second of poses, sampled at a few hundred unsorted timestamps as a physics step would
+    ovr::PoseHistoryRef history = ovr::PoseHistory::create( 1024 );
+    history->push( &poses[count + 1 - 1024], 1024 );
+    const size_t numTimes = 256;
+    vector<double> times( numTimes );
+    for( size_t i = 0; i < numTimes; i++ )
+        times[i] = rand.nextFloat( (float) history->getOldestTime(), (float) history->getNewestTime() );
+    vector<ovr::Pose> samples( numTimes );
+
+    suite.run( "pose.history_sample", numTimes, [&](){
+        sSink = (float) history->sample( times.data(), numTimes, samples.data() );
+    } );
+
+    suite.run( "pose.history_sample_single", numTimes, [&](){
+        float sum = 0.0f;
+        for( size_t i = 0; i < numTimes; i++ ){
+            history->sample( times[i], &samples[i] );
+            sum += samples[i].orientation.w;
+        }
+        sSink = sum;
+    } );
+}
+
+void printFusionComparison( const string &name, const ovr::FusionComparison &comparison )
+{
+    fprintf( stderr, "%-36s tilt %.3f deg (max %.3f), total %.3f deg (max %.3f), %zu samples\n", name.c_str(), comparison.meanTiltError, comparison.maxTiltError, comparison.meanError, comparison.maxError, comparison.numSamples );
+}
+
+void benchmarkFusion( Suite &suite )
+{
+    // Ten seconds of the DK1 tracker rate, with a gyroscope bias the accelerometer has to correct
+    ovr::SyntheticSensor::Options options;
+    options.duration = 10.0;
+    ovr::SyntheticSensorRef sensor = ovr::SyntheticSensor::create( options );
+    vector<ovr::SensorSample> samples;
+    vector<Quatf> truth;
+    ovr::SensorSample sample;
+    while( sensor->nextSample( &sample ) ){
+        sample.rotationRate += Vec3f( 0.01f, 0.0f, -0.01f );
+        samples.push_back( sample );
+        truth.push_back( sensor->getOrientation() );
+    }
+    size_t count = samples.size();
+
+    ovr::MadgwickFusionRef madgwick = ovr::MadgwickFusion::create();
+    suite.run( "fusion.madgwick", count, [&](){
+        madgwick->process( samples.data(), count );
+        sSink = madgwick->getOrientation().w;
+    } );
+
+    suite.run( "fusion.madgwick_single", count, [&](){
+        for( size_t i = 0; i < count; i++ )
+            madgwick->process( &samples[i], 1 );
+        sSink = madgwick->getOrientation().w;
+    } );
+
+    ovr::OvrFusionEngineRef reference = ovr::OvrFusionEngine::create();
+    suite.run( "fusion.ovr_sensor_fusion", count, [&](){
+        reference->process( samples.data(), count );
+        sSink = reference->getOrientation().w;
+    } );
+
+    if( ! suite.matches( "fusion.validate" ) )
+        return;
+
+    // Against the orientation the synthetic stream integrated, after a second to settle
+    ovr::FusionComparison comparison;
+    double tiltSum = 0.0, errorSum = 0.0;
+    madgwick->reset();
+    for( size_t i = 0; i < count; i++ ){
+        madgwick->process( &samples[i], 1 );
+        if( samples[i].time < 1.0 )
+            continue;
+        float tilt  = toDegrees( ovr::tiltBetween( madgwick->getOrientation(), truth[i] ) );
+        float error = toDegrees( ovr::angleBetween( madgwick->getOrientation(), truth[i] ) );
+        tiltSum    += tilt;
+        errorSum   += error;
+        comparison.maxTiltError = max( comparison.maxTiltError, tilt );
+        comparison.maxError     = max( comparison.maxError, error );
+        comparison.numSamples++;
+    }
+    if( comparison.numSamples ){
+        comparison.meanTiltError    = (float) ( tiltSum / comparison.numSamples );
+        comparison.meanError        = (float) ( errorSum / comparison.numSamples );
+    }
+    printFusionComparison( "fusion.validate_synthetic", comparison );
+    printFusionComparison( "fusion.validate_synthetic_ovr", ovr::compareFusion( ovr::SyntheticSensor::create( options ), ovr::MadgwickFusion::create(), ovr::OvrFusionEngine::create() ) );
+
+    // Same variable as Device::create(), a recording is compared to OVR::SensorFusion
+    const char *backend = getenv( "CINDER_OVR_DEVICE" );
+    if( backend && string( backend ).compare( 0, 7, "replay:" ) == 0 ){
+        ovr::SensorRecordingRef recording = ovr::SensorRecording::open( string( backend ).substr( 7 ) );
+        if( recording )
+            printFusionComparison( "fusion.validate_recording", ovr::compareFusion( recording, ovr::MadgwickFusion::create(), ovr::OvrFusionEngine::create() ) );
+        else
+            fprintf( stderr, "Can't open the recording %s\n", backend + 7 );
+    }
+}
+
+void benchmarkInstances( Suite &suite )
+{
+    // Same layout as the sample, 10x10x10 cubes and the 100k stress case
+    for( size_t count : { (size_t) 1000, (size_t) 10000, (size_t) 100000 } ){
+        vector<Matrix44f> transforms( count );
+        Rand rand( 5 );
+        for( size_t i = 0; i < count; i++ ){
+            transforms[i].setToIdentity();
+            transforms[i].translate( Vec3f( rand.nextFloat( -50.0f, 50.0f ), rand.nextFloat( -50.0f, 50.0f ), rand.nextFloat( -50.0f, 50.0f ) ) );
+        }
+
+        for( size_t numThreads : { (size_t) 1, (size_t) 0 } ){
+            InstanceAnimatorRef animator = InstanceAnimator::create( numThreads );
+            float time = 0.0f;
+            suite.run( "instances.animate_" + to_string( count ) + ( numThreads == 1 ? "_1thread" : "_all_cores" ), count, [&](){
+                animator->update( transforms.data(), count, time += 0.016f );
+                sSink = transforms[count - 1].m[12];
+            } );
+        }
+
+        CameraStereoHMD camera( 640, 800, 125.0f, 0.1f, 1000.0f );
+        camera.setEyePoint( Vec3f::zero() );
+        camera.setViewDirection( Vec3f( 0.0f, 0.0f, -1.0f ) );
+        ovr::StereoCullerRef culler = ovr::StereoCuller::create();
+        culler->setCamera( camera );
+        vector<Matrix44f> visible( count );
+        suite.run( "instances.cull_" + to_string( count ), count, [&](){
+            sSink = (float) culler->cull( transforms.data(), count, 0.87f, visible.data() );
+        } );
+    }
+}
+
+}
+
+int main( int argc, char *argv[] )
+{
+    string path     = argc > 1 ? argv[1] : "-";
+    string filter   = argc > 2 ? argv[2] : "";
+
+    Suite suite( filter );
+    bool valid = validateCamera( suite );
+    valid      = validateBufferRing( suite ) && valid;
+    benchmarkCamera( suite );
+    benchmarkConversions( suite );
+    benchmarkDistortion( suite );
+    benchmarkPoses( suite );
+    benchmarkFusion( suite );
+    benchmarkInstances( suite );
+
+    if( path == "-" ){
+        suite.writeJson( cout );
+        return valid ? 0 : 1;
+    }
+
+    ofstream file( path.c_str() );
+    if( ! file ){
+        fprintf( stderr, "Can't write %s\n", path.c_str() );
+        return 1;
+    }
+    suite.writeJson( file );
+    return valid ? 0 : 1;
+}
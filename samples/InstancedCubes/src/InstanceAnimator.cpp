@@ -0,0 +1,137 @@
+//
+//  InstanceAnimator.cpp
+//  OculusSDKTest
+//
+
+#include "InstanceAnimator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <ostream>
+
+using namespace ci;
+
+InstanceAnimatorRef InstanceAnimator::create( size_t numThreads, size_t chunkSize )
+{
+    return InstanceAnimatorRef( new InstanceAnimator( numThreads ? numThreads : std::max( std::thread::hardware_concurrency(), 1u ), chunkSize ) );
+}
+
+InstanceAnimator::InstanceAnimator( size_t numThreads, size_t chunkSize )
+: mChunkSize( std::max<size_t>( chunkSize, 1 ) ),
+mGeneration( 0 ),
+mNumBusyWorkers( 0 ),
+mQuit( false ),
+mTransforms( NULL ),
+mCount( 0 ),
+mTime( 0.0f ),
+mNextChunk( 0 )
+{
+    // One generator per thread, a default Perlin always has the same seed so the animation doesn't depend on the thread count
+    mPerlins.resize( numThreads );
+    for( size_t i = 1; i < numThreads; i++ )
+        mWorkers.push_back( std::thread( &InstanceAnimator::workerLoop, this, i ) );
+}
+
+InstanceAnimator::~InstanceAnimator()
+{
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        mQuit = true;
+    }
+    mStartCondition.notify_all();
+    for( size_t i = 0; i < mWorkers.size(); i++ )
+        mWorkers[i].join();
+}
+
+void InstanceAnimator::update( Matrix44f *transforms, size_t count, float time )
+{
+    if( ! count )
+        return;
+    
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        mTransforms     = transforms;
+        mCount          = count;
+        mTime           = time;
+        mNextChunk      = 0;
+        mNumBusyWorkers = mWorkers.size();
+        mGeneration++;
+    }
+    mStartCondition.notify_all();
+    
+    // The calling thread takes its share of the chunks too
+    processChunks( mPerlins[0] );
+    
+    std::unique_lock<std::mutex> lock( mMutex );
+    mDoneCondition.wait( lock, [this]{ return mNumBusyWorkers == 0; } );
+}
+
+void InstanceAnimator::workerLoop( size_t index )
+{
+    uint64_t generation = 0;
+    while( true ){
+        {
+            std::unique_lock<std::mutex> lock( mMutex );
+            mStartCondition.wait( lock, [&]{ return mQuit || mGeneration != generation; } );
+            if( mQuit )
+                return;
+            generation = mGeneration;
+        }
+        
+        processChunks( mPerlins[index] );
+        
+        bool last;
+        {
+            std::lock_guard<std::mutex> lock( mMutex );
+            last = --mNumBusyWorkers == 0;
+        }
+        if( last )
+            mDoneCondition.notify_one();
+    }
+}
+
+void InstanceAnimator::processChunks( const Perlin &perlin )
+{
+    size_t numChunks = ( mCount + mChunkSize - 1 ) / mChunkSize;
+    for( size_t chunk = mNextChunk++; chunk < numChunks; chunk = mNextChunk++ ){
+        size_t begin    = chunk * mChunkSize;
+        size_t end      = std::min( begin + mChunkSize, mCount );
+        for( size_t i = begin; i < end; i++ ){
+            // Same displacement as the former serial loop, evaluated once instead of twice
+            Vec3f d = perlin.dfBm( Vec3f( i, mTime, -( (float) i ) ) * 0.001f );
+            mTransforms[i].translate( d * 0.5f );
+            mTransforms[i].rotate( d * 0.0025f );
+        }
+    }
+}
+
+void InstanceAnimator::benchmark( std::ostream &out, size_t maxInstances )
+{
+    size_t numCores = std::max( std::thread::hardware_concurrency(), 1u );
+    InstanceAnimatorRef serial      = create( 1 );
+    InstanceAnimatorRef parallel    = create( numCores );
+    
+    out << "instances, threads, ms per update, instances per second per core" << std::endl;
+    for( size_t count = 500; count <= maxInstances; count *= 10 ){
+        std::vector<Matrix44f> transforms( count );
+        InstanceAnimatorRef animators[2] = { serial, parallel };
+        for( int a = 0; a < 2; a++ ){
+            if( a == 1 && numCores == 1 )
+                break;
+            
+            // Enough iterations for about as much work at each size
+            size_t iterations = std::max<size_t>( 1, 1000000 / count );
+            auto start = std::chrono::high_resolution_clock::now();
+            for( size_t i = 0; i < iterations; i++ )
+                animators[a]->update( &transforms.front(), count, (float) i );
+            double seconds = std::chrono::duration<double>( std::chrono::high_resolution_clock::now() - start ).count();
+            
+            double perUpdate = seconds / iterations;
+            out << count << ", " << animators[a]->getNumThreads() << ", " << perUpdate * 1000.0 << ", " << count / perUpdate / animators[a]->getNumThreads() << std::endl;
+        }
+        
+        // Finish with the requested size even if it isn't a power of ten times 500
+        if( count < maxInstances && count * 10 > maxInstances )
+            count = maxInstances / 10;
+    }
+}
@@ -0,0 +1,61 @@
+//
+//  InstanceAnimator.h
+//  OculusSDKTest
+//
+//  Animates the instance transforms of the sample on a pool of worker threads.
+//
+
+#pragma once
+
+#include "cinder/Matrix.h"
+#include "cinder/Perlin.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <iosfwd>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::shared_ptr<class InstanceAnimator> InstanceAnimatorRef;
+
+class InstanceAnimator
+{
+public:
+    //! A \a numThreads of 0 uses all cores, the calling thread counts as one of them. \a chunkSize is the number of instances per job
+    static InstanceAnimatorRef create( size_t numThreads = 0, size_t chunkSize = 1024 );
+    ~InstanceAnimator();
+    
+    //! Moves each of the \a count \a transforms along the Perlin field at \a time, blocks until all the chunks are done
+    void    update( ci::Matrix44f *transforms, size_t count, float time );
+    
+    size_t  getNumThreads() const { return mWorkers.size() + 1; }
+    size_t  getChunkSize() const { return mChunkSize; }
+    
+    //! Times update() from 500 to \a maxInstances instances with 1 thread and with all cores, and writes the throughput per core to \a out
+    static void benchmark( std::ostream &out, size_t maxInstances = 1000000 );
+    
+protected:
+    InstanceAnimator( size_t numThreads, size_t chunkSize );
+    
+    void    workerLoop( size_t index );
+    //! Processes chunks until there's none left, with the Perlin generator of the calling thread
+    void    processChunks( const ci::Perlin &perlin );
+    
+    std::vector<std::thread>    mWorkers;
+    std::vector<ci::Perlin>     mPerlins;
+    size_t                      mChunkSize;
+    
+    std::mutex                  mMutex;
+    std::condition_variable     mStartCondition;
+    std::condition_variable     mDoneCondition;
+    uint64_t                    mGeneration;
+    size_t                      mNumBusyWorkers;
+    bool                        mQuit;
+    
+    // Current job, written before the generation is bumped
+    ci::Matrix44f*              mTransforms;
+    size_t                      mCount;
+    float                       mTime;
+    std::atomic<size_t>         mNextChunk;
+};
@@ -11,8 +11,17 @@
 #include "cinder/Utilities.h"
 #include "cinder/ObjLoader.h"
 
+#include "BufferRing.h"
 #include "CameraStereoHMD.h"
+#include "FrameProfiler.h"
+#include "HiddenAreaMask.h"
+#include "InstanceAnimator.h"
+#include "MultiResTarget.h"
 #include "OculusVR.h"
+#include "PixelDensity.h"
+#include "ResolutionController.h"
+#include "SpectatorMirror.h"
+#include "StereoCuller.h"
 
 using namespace ci;
 using namespace ci::app;
@@ -29,6 +38,27 @@ static const char* instanceVertexShader =
 "   gl_Position 	= gl_ModelViewProjectionMatrix * modelView * gl_Vertex;\n"
 "}\n";
 
+// Single pass stereo version, each cube is drawn twice in a row. The instance index
+// picks the eye matrix and squeezes the result in that eye's half of the viewport,
+// the clip vertex keeps the triangles from bleeding into the other half.
+static const char* stereoInstanceVertexShader =
+"#version 120\n"
+"#extension GL_ARB_draw_instanced : require\n"
+"attribute mat4 modelView;\n"
+"uniform mat4 ViewProjection[2];\n"
+"\n"
+"void main()\n"
+"{\n"
+"   int eye         = int( mod( float( gl_InstanceIDARB ), 2.0 ) );\n"
+"   float side      = eye == 0 ? -1.0 : 1.0;\n"
+"   vec4 position   = ViewProjection[eye] * modelView * gl_Vertex;\n"
+"   position.x      = position.x * 0.5 + side * 0.5 * position.w;\n"
+"   gl_TexCoord[0] 	= gl_MultiTexCoord0;\n"
+"   gl_FrontColor 	= gl_Color;\n"
+"   gl_ClipVertex   = vec4( side * position.x, 0.0, 0.0, 1.0 );\n"
+"   gl_Position 	= position;\n"
+"}\n";
+
 
 class OculusSDKTestApp : public AppNative {
   public:
@@ -39,11 +69,23 @@ class OculusSDKTestApp : public AppNative {
 	void draw();
 	void keyDown( KeyEvent event );
     
-    void render();
+    void setupRenderTargets();
+    void setupDevice();
+    void drawMirror();
+    void renderEyes( const Vec2i &size, const Matrix44f *crops = NULL );
+    void render( bool instances = true, const Matrix44f *crop = NULL );
+    void renderInstancesStereo( const Matrix44f *crops = NULL );
+    void enableFog();
+    void drawInstances( size_t numInstances );
+    void setNumInstances( size_t numInstances );
+    GLuint createInstancesVao( GLint location, GLuint divisor );
+    void updateFloor();
     
     ovr::DeviceRef              mOculusVR;
+    std::future<ovr::DeviceRef> mOculusVRFuture;
     ovr::DistortionHelperRef    mDistortionHelper;
     CameraStereoHMD             mCamera;
+    double                      mUpdateTime;
     
     float                       mTime;
     float                       mTimeInc;
@@ -53,10 +95,48 @@ class OculusSDKTestApp : public AppNative {
     gl::Texture                 mBakedAO;
     
 	ci::gl::VboMeshRef          mVboMesh;
-	ci::gl::Vbo                 mTransformsBuffer;
+    ovr::BufferRingRef          mTransformsRing;
+    ovr::BufferRingRef          mFloorRing;
     ci::gl::GlslProgRef         mShader;
 	GLuint                      mVAO;
+    GLint                       mTransformsLocation;
+    
+    // Single pass stereo, both eyes of each instance in one draw call
+    bool                        mSinglePassStereo;
+    ci::gl::GlslProgRef         mStereoShader;
+    GLuint                      mStereoVAO;
+    GLint                       mStereoTransformsLocation;
     size_t                      mNumInstances;
+    
+    // Transforms are animated here by the worker pool, then uploaded in one go
+    vector<Matrix44f>           mTransforms;
+    InstanceAnimatorRef         mAnimator;
+    
+    // Only the instances visible from either eye are uploaded and drawn
+    bool                        mCulling;
+    ovr::StereoCullerRef        mCuller;
+    float                       mCubeRadius;
+    size_t                      mNumVisible;
+    
+    // Lens matched resolution, the center of each eye at the density the lens needs and the rest at a lower one
+    bool                        mMultiRes;
+    ovr::PixelDensityMapRef     mDensityMap;
+    ovr::MultiResTargetRef      mMultiResTarget;
+    
+    // Depth mask over the parts of each eye the distortion never reads
+    bool                        mMaskHiddenArea;
+    ovr::HiddenAreaMaskRef      mHiddenArea;
+    
+    // Shrinks the part of mFbo the eyes are rendered to when the frames run late
+    ovr::ResolutionControllerRef mResolution;
+    
+    // Stage timings of the last frames, exported with 'f'
+    ovr::FrameProfilerRef       mProfiler;
+    
+    // Downsampled copy of the eyes shown on the desktop display, never rendered twice
+    ovr::SpectatorMirrorRef     mMirror;
+    WindowRef                   mMirrorWindow;
+    bool                        mMirrorVerticalSync;
 };
 
 void OculusSDKTestApp::prepareSettings( Settings* settings )
@@ -73,20 +153,23 @@ void OculusSDKTestApp::prepareSettings( Settings* settings )
 void OculusSDKTestApp::setup()
 {
     
-    // Create Render Target a bit bigger to compensate the distortion quality loss
-    gl::Fbo::Format format;
-    format.enableColorBuffer();
-    format.enableDepthBuffer();
-    format.setSamples( 8 );
+    // Init OVR in the background, the first frames use the default DK1 distortion until the HMD is picked up in update()
+    mOculusVRFuture     = ovr::Device::createAsync();
+    mDistortionHelper   = ovr::DistortionHelper::create();
+    mDistortionHelper->setCacheDirectory( getTemporaryDirectory() / "OculusSDKTest" );
     
-    mFbo = gl::Fbo( 1600, 1000, format );
+    // Build every shader variant the keys can switch to now, from the program binaries of the previous runs when possible
+    mDistortionHelper->precompileShaders();
+    mDistortionHelper->getShaderCache()->writeReport( console() );
     
-    // Init OVR
-    mOculusVR           = ovr::Device::create();
-    mDistortionHelper   = ovr::DistortionHelper::create();
+    mMultiRes       = false;
+    mMaskHiddenArea = true;
+    setupRenderTargets();
+    
+    mProfiler = ovr::FrameProfiler::create();
     
     // Create Stereo Camera
-    mCamera = CameraStereoHMD( 640, 800, mOculusVR ? mOculusVR->getFov() : 125, mOculusVR ? mOculusVR->getEyeToScreenDistance() : 10, 10000.0f );
+    mCamera = CameraStereoHMD( 640, 800, 125, 10, 10000.0f );
     mCamera.setEyePoint( Vec3f::zero() );
     mCamera.setWorldUp( Vec3f( 0, 1, 0 ) );
     
@@ -106,6 +189,14 @@ void OculusSDKTestApp::setup()
     
     mVboMesh = gl::VboMesh::create( mesh );
     
+    // Bounding sphere of the cube, scaled by each instance transform when culling
+    mCubeRadius = 0.0f;
+    for( size_t i = 0; i < mesh.getNumVertices(); i++ )
+        mCubeRadius = math<float>::max( mCubeRadius, mesh.getVertices()[i].length() );
+    mCulling    = true;
+    mCuller     = ovr::StereoCuller::create();
+    mNumVisible = 0;
+    
     // Load instancing shader
     try {
         mShader = gl::GlslProg::create( instanceVertexShader, NULL );
@@ -114,45 +205,72 @@ void OculusSDKTestApp::setup()
         std::cout << "ovr::DistortionHelper Exception: " << std::endl << exc.what() << std::endl;
     }
     
-    // Create temp vector with trans matrices
-    vector< Matrix44f > matrices;
-    for( int i = 0; i < mNumInstances; i++ ){
-        Matrix44f mat;
-        mat.translate( randVec3f() * randFloat( 60, 500 ) );
-        mat.rotate( randVec3f() * 50.0f );
-        mat.scale( Vec3f::one() * randFloat(0.1,1) * 0.25f );//* Vec3f( 0.1f, 150.0f, 0.1f ) );
-        matrices.push_back( mat );
+    mAnimator = InstanceAnimator::create();
+    
+    // Setup transform VAO, the attribute pointers follow the ring slot of the frame and are set in render()
+    mTransformsLocation = mShader->getAttribLocation( "modelView" );
+    mVAO                = createInstancesVao( mTransformsLocation, 1 );
+    
+    // The stereo pass needs gl_InstanceIDARB and the divisor to advance the transform every other instance
+    mSinglePassStereo   = false;
+    mStereoVAO          = 0;
+    if( gl::isExtensionAvailable( "GL_ARB_draw_instanced" ) && gl::isExtensionAvailable( "GL_ARB_instanced_arrays" ) ){
+        try {
+            mStereoShader               = gl::GlslProg::create( stereoInstanceVertexShader, NULL );
+            mStereoTransformsLocation   = mStereoShader->getAttribLocation( "modelView" );
+            mStereoVAO                  = createInstancesVao( mStereoTransformsLocation, 2 );
+            mSinglePassStereo           = true;
+        }
+        catch( gl::GlslProgCompileExc exc ){
+            std::cout << "Single pass stereo unavailable: " << std::endl << exc.what() << std::endl;
+        }
     }
     
-    // Setup transform VAO
-    GLint ulocation = mShader->getAttribLocation( "modelView" );
+    setNumInstances( mNumInstances );
+    
+    // Floor and ceiling quads, 8 vertices of position and texture coordinates
+    mFloorRing = ovr::BufferRing::create( GL_ARRAY_BUFFER, 8 * 5 * sizeof(GLfloat) );
+
+    // Load Textures
+    gl::Texture::Format texFormat;
+    texFormat.enableMipmapping();
+    texFormat.setMinFilter( GL_LINEAR_MIPMAP_NEAREST );
+    texFormat.setWrap( GL_REPEAT, GL_REPEAT );
+    
+    mTexture = gl::Texture( loadImage( loadAsset( "Grid.png" ) ), texFormat );
+    mBakedAO = gl::Texture( loadImage( loadAsset( "CubeAmbient_Occlusion.png" ) ), texFormat );
     
-	if( ulocation != -1 ){
+    // Setup Extra Window, it only draws the mirror of the eyes rendered for the HMD
+    mMirrorVerticalSync = true;
+    if( Display::getDisplays().size() > 1 ){
+        mMirrorWindow = createWindow();
+        mMirrorWindow->setSize( 1280, 800 );
+        mMirror = ovr::SpectatorMirror::create();
+    }
+    else setWindowSize( 1280, 800 );
+}
+GLuint OculusSDKTestApp::createInstancesVao( GLint location, GLuint divisor )
+{
+    GLuint vao = 0;
+	if( location != -1 ){
         
 #if( defined GL_APPLE_vertex_array_object )
-		glGenVertexArraysAPPLE( 1, &mVAO );
-		glBindVertexArrayAPPLE( mVAO );
+		glGenVertexArraysAPPLE( 1, &vao );
+		glBindVertexArrayAPPLE( vao );
 #else
-		glGenVertexArrays( 1, &mVAO );
-		glBindVertexArray( mVAO );
+		glGenVertexArrays( 1, &vao );
+		glBindVertexArray( vao );
 #endif
-		mTransformsBuffer = gl::Vbo( GL_ARRAY_BUFFER );
-        
-		mTransformsBuffer.bind();
 		for (unsigned int i = 0; i < 4 ; i++) {
-			glEnableVertexAttribArray(ulocation + i);
-			glVertexAttribPointer(ulocation + i, 4, GL_FLOAT, GL_FALSE, sizeof(Matrix44f), (const GLvoid*)(sizeof(GLfloat) * i * 4));
+			glEnableVertexAttribArray(location + i);
             
 #if( defined GL_ARB_instanced_arrays )
-			glVertexAttribDivisorARB(ulocation + i, 1);
+			glVertexAttribDivisorARB(location + i, divisor);
 #else
-			glVertexAttribDivisor(ulocation + i, 1);
+			glVertexAttribDivisor(location + i, divisor);
 #endif
 		}
         
-		mTransformsBuffer.bufferData( matrices.size() * sizeof(Matrix44f), &matrices.front(), GL_STATIC_READ );
-		mTransformsBuffer.unbind();
-        
         
 #if( defined GL_APPLE_vertex_array_object )
 		glBindVertexArrayAPPLE(0);
@@ -164,22 +282,7 @@ void OculusSDKTestApp::setup()
             cout << "VAO Init Problem" << endl;
         else cout << "All good" << endl;
 	}
-
-    // Load Textures
-    gl::Texture::Format texFormat;
-    texFormat.enableMipmapping();
-    texFormat.setMinFilter( GL_LINEAR_MIPMAP_NEAREST );
-    texFormat.setWrap( GL_REPEAT, GL_REPEAT );
-    
-    mTexture = gl::Texture( loadImage( loadAsset( "Grid.png" ) ), texFormat );
-    mBakedAO = gl::Texture( loadImage( loadAsset( "CubeAmbient_Occlusion.png" ) ), texFormat );
-    
-    // Setup Extra Window
-    if( Display::getDisplays().size() > 1 ){
-        WindowRef secondWindow = createWindow();
-        secondWindow->setSize( 1280, 800 );
-    }
-    else setWindowSize( 1280, 800 );
+    return vao;
 }
 void OculusSDKTestApp::keyDown( KeyEvent event )
 {
@@ -195,61 +298,234 @@ void OculusSDKTestApp::keyDown( KeyEvent event )
         mCamera.setProjectionCenterOffset( mCamera.getProjectionCenterOffset() - 1.1f );
     else if( event.getChar() =='x' )
         mCamera.setProjectionCenterOffset( mCamera.getProjectionCenterOffset() + 1.1f );
+    else if( event.getChar() =='m' )
+        mDistortionHelper->setUseMesh( ! mDistortionHelper->isUsingMesh() );
+    else if( event.getChar() =='+' )
+        setNumInstances( mNumInstances * 2 );
+    else if( event.getChar() =='-' )
+        setNumInstances( math<size_t>::max( mNumInstances / 2, 1 ) );
+    else if( event.getChar() =='b' )
+        InstanceAnimator::benchmark( console() );
+    else if( event.getChar() =='v' && mStereoShader )
+        mSinglePassStereo = ! mSinglePassStereo;
+    else if( event.getChar() =='c' )
+        mCulling = ! mCulling;
+    else if( event.getChar() =='l' )
+        mMultiRes = ! mMultiRes;
+    else if( event.getChar() =='h' )
+        mMaskHiddenArea = ! mMaskHiddenArea;
+    else if( event.getChar() =='d' )
+        mResolution->enable( ! mResolution->isEnabled() );
+    else if( event.getChar() =='f' ){
+        fs::path directory = getDocumentsDirectory();
+        if( mProfiler->writeStatsCsv( directory / "OculusSDKTest_stages.csv" ) && mProfiler->writeHistogramCsv( directory / "OculusSDKTest_histograms.csv" ) && mProfiler->writeChromeTrace( directory / "OculusSDKTest_trace.json" ) )
+            console() << "Frame stages saved to " << directory << endl;
+    }
+    else if( event.getChar() =='k' ){
+        if( ovr::saveFrameTimings( getDocumentsDirectory() / "OculusSDKTest_frames.csv", mResolution->getHistory() ) )
+            console() << "Frame timings saved to " << getDocumentsDirectory() / "OculusSDKTest_frames.csv" << endl;
+    }
+    else if( event.getChar() =='t' )
+        mDistortionHelper->enableTimewarp( ! mDistortionHelper->isTimewarpEnabled() );
+    else if( event.getChar() =='p' && mOculusVR ){
+        ovr::Device::PredictionStats stats = mOculusVR->getPredictionStats();
+        console() << "Prediction horizon " << mOculusVR->getPredictionHorizon() * 1000.0f << "ms, error over " << stats.numSamples << " samples: mean " << stats.meanError << " rms " << stats.rmsError << " max " << stats.maxError << " degrees" << endl;
+        mOculusVR->resetPredictionStats();
+        mOculusVR->enablePredictionStats();
+    }
+    else if( event.getChar() =='o' && mMirror )
+        mMirror->setSource( mMirror->getSource() == ovr::SpectatorMirror::SOURCE_BOTH_EYES ? ovr::SpectatorMirror::SOURCE_LEFT_EYE : ovr::SpectatorMirror::SOURCE_BOTH_EYES );
+    else if( event.getChar() =='g' && mOculusVR ){
+        mOculusVR->setFusionEngine( mOculusVR->getFusionEngine() ? ovr::FusionEngineRef() : ovr::MadgwickFusion::create() );
+        console() << "Sensor fusion: " << ( mOculusVR->getFusionEngine() ? mOculusVR->getFusionEngine()->getName() : "OVR::SensorFusion" ) << endl;
+    }
+    else if( event.getChar() =='w' && mOculusVR ){
+        if( mOculusVR->isRecording() )
+            mOculusVR->stopRecording();
+        else if( mOculusVR->startRecording( getDocumentsDirectory() / "OculusSDKTest.ovrs" ) )
+            console() << "Recording sensor stream to " << getDocumentsDirectory() / "OculusSDKTest.ovrs" << endl;
+    }
+}
+void OculusSDKTestApp::setupRenderTargets()
+{
+    // Render Target as big as the lens center needs to compensate the distortion quality loss
+    Vec2i displaySize   = mOculusVR ? mOculusVR->getResolution() : Vec2i( 1280, 800 );
+    mDensityMap         = ovr::PixelDensityMap::create( mDistortionHelper->getDistortionParams(), mDistortionHelper->getDistortionScale(), ( displaySize.x * 0.5f ) / displaySize.y );
+    float density       = mDensityMap->getMaxDensity();
+    Vec2i size( 2 * (int) ( displaySize.x * 0.5f * density ), displaySize.y * density );
+    
+    gl::Fbo::Format format;
+    format.enableColorBuffer();
+    format.enableDepthBuffer();
+    format.setSamples( 8 );
+    
+    mFbo = gl::Fbo( size.x, size.y, format );
+    
+    // Same center resolution in the multi resolution mode, the regions needing less than 3/4 of it use the periphery
+    float peripheryScale    = 0.75f;
+    Rectf centerRegion      = mDensityMap->calcCenterRegion( density, peripheryScale );
+    mMultiResTarget         = ovr::MultiResTarget::create( size, centerRegion, peripheryScale, format );
+    
+    // Budget of the HMD refresh rate, mFbo is the largest size the eyes can take
+    ovr::ResolutionPolicy::Options resolutionOptions;
+    resolutionOptions.frameBudget   = 1000.0 / 60.0;
+    mResolution                     = ovr::ResolutionController::create( size, resolutionOptions );
+    
+    // Timewarp moves the lookups by the rotation since the eyes were rendered, the margin has to cover it, at the smallest resolution too
+    mHiddenArea             = ovr::HiddenAreaMask::create( mDistortionHelper->getDistortionParams(), mDistortionHelper->getDistortionScale(), mDistortionHelper->getChromaticAbCorrection(), mDistortionHelper->isUsingChromaticAbCorrection(), ( displaySize.x * 0.5f ) / displaySize.y, size, 64, ( mOculusVR ? 16.0f : 3.0f ) / resolutionOptions.minScale );
+    console() << "Hidden area mask covers " << mHiddenArea->getCoverage() * 100.0f << "% of the eyes, " << mHiddenArea->countMaskedLookups( displaySize ) << " distortion lookups masked" << endl;
+    console() << "Render target " << size << " for a lens center density of " << density << ", multi resolution shades " << ovr::PixelDensityMap::calcShadedFraction( centerRegion, peripheryScale ) * 100.0f << "% of it" << endl;
+}
+void OculusSDKTestApp::setupDevice()
+{
+    mDistortionHelper->setDevice( mOculusVR );
+    
+    // The display size and the distortion may differ from the defaults, the targets follow
+    setupRenderTargets();
+    
+    // Poll the sensor on its own thread, the app then only reads the published poses
+    mOculusVR->startSensorThread();
+    mDistortionHelper->enableTimewarp();
+    
+    mCamera.setFov( mOculusVR->getFov() );
+    mCamera.setNearClip( mOculusVR->getEyeToScreenDistance() );
 }
 void OculusSDKTestApp::update()
 {
+    // Pick up the HMD once its initialization is done, without waiting for it
+    if( mOculusVRFuture.valid() && mOculusVRFuture.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready ){
+        mOculusVR = mOculusVRFuture.get();
+        if( mOculusVR )
+            setupDevice();
+        console() << ( mOculusVR ? "HMD ready after " : "No HMD found after " ) << getElapsedSeconds() << "s" << endl;
+    }
+    
+    mResolution->beginFrame();
+    mProfiler->beginFrame();
+    
     // Extrat Oculus Orientation and Update Camera
     Quatf orientation;
     
     if( mOculusVR ){
-        orientation = mOculusVR->getOrientation();
+        ovr::FrameProfiler::Scope scope( mProfiler, "sensor", false );
+        orientation = mOculusVR->getPredictedOrientation();
     }
     
     mCamera.setOrientation( orientation * Quatf( Vec3f( 0, 1, 0 ), M_PI ) );
+    mUpdateTime = getElapsedSeconds();
     
     // Scene animation
     mTime += mTimeInc;
     
-    uint8_t *data           = mTransformsBuffer.map( GL_WRITE_ONLY );
-    uint8_t stride          = sizeof(Matrix44f);
+    // Animate the staging copy, then copy it, or only its visible part, to a slot the GPU isn't reading
+    mAnimator->update( &mTransforms.front(), mTransforms.size(), mTime );
+    Matrix44f *slot = reinterpret_cast<Matrix44f*>( mTransformsRing->map() );
+    if( mCulling ){
+        mCuller->setCamera( mCamera );
+        mNumVisible = mCuller->cull( &mTransforms.front(), mTransforms.size(), mCubeRadius, slot );
+    }
+    else {
+        memcpy( slot, &mTransforms.front(), mTransforms.size() * sizeof(Matrix44f) );
+        mNumVisible = mTransforms.size();
+    }
+    mTransformsRing->unmap();
     
-    Perlin p;
-    for( int i = 0; i < mNumInstances; i++ ){
-        Matrix44f *ptr = reinterpret_cast<Matrix44f*>( &data[0] );
-        if( ptr != NULL ){
-            ptr->translate( p.dfBm( Vec3f( i, mTime, -i ) * 0.001f ) * 0.5f );
-            ptr->rotate(  p.dfBm( Vec3f( i, mTime, -i ) * 0.001f ) * 0.0025f );
-            data += stride;
-        }
+    updateFloor();
+}
+void OculusSDKTestApp::updateFloor()
+{
+    float k = 1000.0f;
+    float s = 5000.0f;
+    float timeScl = 0.0f;
+    
+    // Texture coordinates are paired with the vertices the same way the former glBegin/glEnd
+    // version ended up pairing them, each glTexCoord applying to the following glVertex
+    GLfloat t = mTime * timeScl;
+    GLfloat vertices[8 * 5] = {
+        // Floor
+        -s, -k, -s,     0 + t, 100,
+         s, -k, -s,     0 + t, 0,
+         s, -k,  s,     100 + t, 0,
+        -s, -k,  s,     100 + t, 100,
+        // Ceiling
+        -s,  k, -s,     0 + t, 100,
+         s,  k, -s,     0 + t, 0,
+         s,  k,  s,     100 + t, 0,
+        -s,  k,  s,     100 + t, 100
+    };
+    memcpy( mFloorRing->map(), vertices, sizeof( vertices ) );
+    mFloorRing->unmap();
+}
+void OculusSDKTestApp::setNumInstances( size_t numInstances )
+{
+    // Keep the current instances and add random ones
+    size_t previous = mTransforms.size();
+    mTransforms.resize( numInstances );
+    for( size_t i = previous; i < numInstances; i++ ){
+        Matrix44f mat;
+        mat.translate( randVec3f() * randFloat( 60, 500 ) );
+        mat.rotate( randVec3f() * 50.0f );
+        mat.scale( Vec3f::one() * randFloat(0.1,1) * 0.25f );//* Vec3f( 0.1f, 150.0f, 0.1f ) );
+        mTransforms[i] = mat;
     }
+    mNumInstances = numInstances;
     
-	mTransformsBuffer.unmap();
-	mTransformsBuffer.unbind();
+    // Written every frame, in a new slot each time
+    mTransformsRing = ovr::BufferRing::create( GL_ARRAY_BUFFER, mTransforms.size() * sizeof(Matrix44f) );
 }
 void OculusSDKTestApp::draw()
 {
+    if( mMirrorWindow && getWindow() == mMirrorWindow ){
+        drawMirror();
+        return;
+    }
+    
 	// clear out the window with black
 	gl::clear( Color( 0, 0, 0 ) );
     
-    // Start Rendering to Our Side by Side RenderTarget
-    mFbo.bindFramebuffer();
-    
-    // Clear
-    gl::clear( ColorA( 1.0f, 1.0f, 1.0f, 1.0f ) );
-    
-    // Render Left Eye
-    mCamera.enableStereoLeft();
-    gl::setViewport( Area( Vec2f( 0.0f, 0.0f ), Vec2f( mFbo.getWidth() / 2.0f, mFbo.getHeight() ) ) );
-    
-    render();
-    
-    // Render Right Eye
-    mCamera.enableStereoRight();
-    gl::setViewport( Area( Vec2f( mFbo.getWidth() / 2.0f, 0.0f ), Vec2f( mFbo.getWidth(), mFbo.getHeight() ) ) );
-    
-    render();
+    if( mMultiRes ){
+        // Center regions first, with the projections narrowed to them
+        Matrix44f crops[2] = { mMultiResTarget->getCenterCrop( ovr::EYE_LEFT ), mMultiResTarget->getCenterCrop( ovr::EYE_RIGHT ) };
+        mMultiResTarget->bindCenter();
+        gl::clear( ColorA( 1.0f, 1.0f, 1.0f, 1.0f ) );
+        renderEyes( mMultiResTarget->getCenterFbo().getSize(), crops );
+        
+        // Then the whole eyes at a lower resolution, minus the centers
+        mMultiResTarget->bindPeriphery();
+        gl::clear( ColorA( 1.0f, 1.0f, 1.0f, 1.0f ) );
+        mMultiResTarget->maskCenter();
+        if( mMaskHiddenArea )
+            mHiddenArea->render( mMultiResTarget->getPeripheryFbo().getSize() );
+        renderEyes( mMultiResTarget->getPeripheryFbo().getSize() );
+        mMultiResTarget->unbind();
+    }
+    else {
+        // Start Rendering to Our Side by Side RenderTarget
+        mFbo.bindFramebuffer();
+        
+        // Clear
+        gl::clear( ColorA( 1.0f, 1.0f, 1.0f, 1.0f ) );
+        
+        // Only the bottom left part picked by the resolution controller is used, the mask scales with it
+        if( mMaskHiddenArea )
+            mHiddenArea->render( mResolution->getSize() );
+        renderEyes( mResolution->getSize() );
+        
+        mFbo.unbindFramebuffer();
+    }
     
-    mFbo.unbindFramebuffer();
+    // Both eyes are issued, the slots of this frame can be recycled once the GPU is done with them
+    mTransformsRing->fence();
+    mFloorRing->fence();
+    
+    // One downsampling blit of the undistorted eyes for the spectators, at the mirror rate
+    if( mMirror ){
+        ovr::FrameProfiler::Scope scope( mProfiler, "mirror" );
+        if( mMultiRes )
+            mMirror->update( *mMultiResTarget, getElapsedSeconds() );
+        else
+            mMirror->update( mFbo, Area( Vec2i::zero(), mResolution->getSize() ), getElapsedSeconds() );
+    }
     
     
     // Back to 2d rendering
@@ -258,25 +534,73 @@ void OculusSDKTestApp::draw()
     gl::disableDepthRead();
     gl::disableDepthWrite();
     
+    // Reproject both eyes to the orientation predicted for the same display time, now that less of the horizon is left
+    if( mOculusVR && mDistortionHelper->isTimewarpEnabled() ){
+        float horizon = math<float>::max( mOculusVR->getPredictionHorizon() - (float) ( getElapsedSeconds() - mUpdateTime ), 0.0f );
+        mDistortionHelper->setRenderOrientations( mCamera.getOrientation(), mCamera.getOrientation() );
+        mDistortionHelper->setLatestOrientation( mOculusVR->getPredictedOrientation( horizon ) * Quatf( Vec3f( 0, 1, 0 ), M_PI ) );
+    }
+    
     // Send the Side by Side texture to our distortion correction shader
-    mDistortionHelper->render( mFbo.getTexture(), getWindowBounds() );
+    {
+        ovr::FrameProfiler::Scope scope( mProfiler, "distortion" );
+        if( mMultiRes )
+            mDistortionHelper->render( mMultiResTarget, getWindowBounds() );
+        else
+            mDistortionHelper->render( mFbo.getTexture(), getWindowBounds(), mResolution->getTexCoordScale() );
+    }
     
     // Draw FPS
     gl::setMatricesWindow( getWindowSize() );
-    gl::drawString( toString( (int) getAverageFps() ), Vec2f( 10, 10 ) );
+    gl::drawString( toString( (int) getAverageFps() ) + " fps, " + toString( mDistortionHelper->getNumGlCalls() ) + " distortion GL calls" + ( mSinglePassStereo ? ", single pass stereo" : "" ) + ( mMultiRes ? ", multi resolution" : "" ) + ( mMaskHiddenArea ? ", " + toString( mHiddenArea->getCoverage() * 100.0f ) + "% hidden area masked" : "" ), Vec2f( 10, 10 ) );
+    if( mCulling )
+        gl::drawString( toString( mCuller->getNumCulled() ) + " / " + toString( mCuller->getNumTested() ) + " instances culled in " + toString( mCuller->getCullTime() ) + "ms", Vec2f( 10, 25 ) );
+    if( ! mMultiRes ){
+        const ovr::FrameTiming &timing = mResolution->getLastTiming();
+        gl::drawString( "Eyes at " + toString( mResolution->getSize().x ) + "x" + toString( mResolution->getSize().y ) + ( mResolution->isEnabled() ? "" : " (fixed)" ) + ", cpu " + toString( timing.cpuTime ) + "ms, gpu " + ( timing.gpuTime >= 0.0 ? toString( timing.gpuTime ) + "ms" : "n/a" ), Vec2f( 10, 40 ) );
+    }
+    
+    // Median and 99th percentile of the stages over the last frames
+    std::string stages;
+    const std::vector<std::string> &names = mProfiler->getStageNames();
+    for( std::vector<std::string>::const_iterator it = names.begin(); it != names.end(); ++it ){
+        ovr::FrameProfiler::Stats stats = mProfiler->isGpuTimed() && *it != "sensor" && *it != "swap" ? mProfiler->getGpuStats( *it ) : mProfiler->getCpuStats( *it );
+        stages += ( stages.empty() ? "" : ", " ) + *it + " " + toString( stats.p50 ) + "/" + toString( stats.p99 );
+    }
+    gl::drawString( stages + " ms", Vec2f( 10, 55 ) );
+    
+    mProfiler->endFrame();
+    mResolution->endFrame();
 }
 
-
-void OculusSDKTestApp::render()
+void OculusSDKTestApp::renderEyes( const Vec2i &size, const Matrix44f *crops )
 {
+    // Render the instances of both eyes at once
+    if( mSinglePassStereo ){
+        ovr::FrameProfiler::Scope scope( mProfiler, "both eyes" );
+        gl::setViewport( Area( Vec2i::zero(), size ) );
+        renderInstancesStereo( crops );
+    }
     
-    // Enable depth testing
-    gl::enableDepthRead();
-    gl::enableDepthWrite();
+    // Render Left Eye
+    mProfiler->begin( "left eye" );
+    mCamera.enableStereoLeft();
+    gl::setViewport( Area( Vec2f( 0.0f, 0.0f ), Vec2f( size.x / 2.0f, size.y ) ) );
     
-    // Set camera
-    gl::setMatrices( mCamera );
+    render( ! mSinglePassStereo, crops ? &crops[0] : NULL );
+    mProfiler->end();
     
+    // Render Right Eye
+    mProfiler->begin( "right eye" );
+    mCamera.enableStereoRight();
+    gl::setViewport( Area( Vec2f( size.x / 2.0f, 0.0f ), Vec2f( size.x, size.y ) ) );
+    
+    render( ! mSinglePassStereo, crops ? &crops[1] : NULL );
+    mProfiler->end();
+}
+
+void OculusSDKTestApp::enableFog()
+{
     // Add a bit of white fog
     GLfloat fogColor[4]= {1.0f, 1.0f, 1.0f, 1.0f};
     
@@ -287,39 +611,94 @@ void OculusSDKTestApp::render()
     glFogf(GL_FOG_START, 500.0f);
     glFogf(GL_FOG_END, 5000.0f);
     glEnable(GL_FOG);
+}
+
+void OculusSDKTestApp::renderInstancesStereo( const Matrix44f *crops )
+{
+    gl::enableDepthRead();
+    gl::enableDepthWrite();
+    
+    enableFog();
+    
+    // The clip plane is specified with an identity modelView so it applies to gl_ClipVertex as is
+    GLdouble plane[4] = { 1.0, 0.0, 0.0, 0.0 };
+    gl::pushModelView();
+    glLoadIdentity();
+    glClipPlane( GL_CLIP_PLANE0, plane );
+    gl::popModelView();
+    glEnable( GL_CLIP_PLANE0 );
     
-    // Render random cubes
-    Perlin p;
     gl::color( ColorA::white() );
     mBakedAO.enableAndBind();
     
+    Matrix44f viewProjections[2];
+    mCamera.getViewProjectionMatrices( viewProjections );
+    if( crops ){
+        viewProjections[0] = crops[0] * viewProjections[0];
+        viewProjections[1] = crops[1] * viewProjections[1];
+    }
     
-    // Render instanced meshes
-    mShader->bind();
+    mStereoShader->bind();
+    glUniformMatrix4fv( mStereoShader->getUniformLocation( "ViewProjection" ), 2, GL_FALSE, viewProjections[0].m );
     
 #if( defined GL_APPLE_vertex_array_object )
-    glBindVertexArrayAPPLE(mVAO);
+    glBindVertexArrayAPPLE(mStereoVAO);
 #else
-    glBindVertexArray(mVAO);
+    glBindVertexArray(mStereoVAO);
 #endif
     
+    mTransformsRing->bind();
+    for (unsigned int i = 0; i < 4 && mStereoTransformsLocation != -1 ; i++)
+        glVertexAttribPointer(mStereoTransformsLocation + i, 4, GL_FLOAT, GL_FALSE, sizeof(Matrix44f), (const GLvoid*)(mTransformsRing->getOffset() + sizeof(GLfloat) * i * 4));
+    mTransformsRing->unbind();
+    
+    // Two instances per cube, one per eye
+    drawInstances( mNumVisible * 2 );
+    
+#if( defined GL_APPLE_vertex_array_object )
+    glBindVertexArrayAPPLE(0);
+#else
+    glBindVertexArray(0);
+#endif
+    mStereoShader->unbind();
+    mBakedAO.unbind();
+    
+    glDisable( GL_CLIP_PLANE0 );
+    glDisable( GL_FOG );
+}
+
+void OculusSDKTestApp::drawMirror()
+{
+    // Waiting for the vertical blank of this window too would halve the HMD frame rate
+    if( mMirrorVerticalSync ){
+        gl::enableVerticalSync( false );
+        mMirrorVerticalSync = false;
+    }
+    
+    gl::clear( Color( 0, 0, 0 ) );
+    gl::setMatricesWindow( getWindowSize() );
+    gl::setViewport( getWindowBounds() );
+    mMirror->draw( getWindowBounds() );
+}
+void OculusSDKTestApp::drawInstances( size_t numInstances )
+{
     mVboMesh->enableClientStates();
     mVboMesh->bindAllData();
     
     if( mVboMesh->getNumIndices() > 0 ){
 #if( defined GL_ARB_draw_instanced )
-        glDrawElementsInstancedARB( mVboMesh->getPrimitiveType(), mVboMesh->getNumIndices(), GL_UNSIGNED_INT, (GLvoid*)( sizeof(uint32_t) * (size_t)0 ), mNumInstances );
+        glDrawElementsInstancedARB( mVboMesh->getPrimitiveType(), mVboMesh->getNumIndices(), GL_UNSIGNED_INT, (GLvoid*)( sizeof(uint32_t) * (size_t)0 ), numInstances );
 #elif( defined GL_EXT_draw_instanced )
-        glDrawElementsInstancedEXT( mVboMesh->getPrimitiveType(), mVboMesh->getNumIndices(), GL_UNSIGNED_INT, (GLvoid*)( sizeof(uint32_t) * (size_t)0 ), mNumInstances );
+        glDrawElementsInstancedEXT( mVboMesh->getPrimitiveType(), mVboMesh->getNumIndices(), GL_UNSIGNED_INT, (GLvoid*)( sizeof(uint32_t) * (size_t)0 ), numInstances );
 #else
         glDrawElements( mVboMesh->getPrimitiveType(), mVboMesh->getNumIndices(), GL_UNSIGNED_INT, (GLvoid*)( sizeof(uint32_t) * startIndex ) );
 #endif
     }
     else {
 #if( defined GL_ARB_draw_instanced )
-        glDrawArraysInstancedARB( mVboMesh->getPrimitiveType(), 0, mVboMesh->getNumVertices(), mNumInstances );
+        glDrawArraysInstancedARB( mVboMesh->getPrimitiveType(), 0, mVboMesh->getNumVertices(), numInstances );
 #elif( defined GL_EXT_draw_instanced )
-        glDrawArraysInstancedEXT( mVboMesh->getPrimitiveType(), 0, mVboMesh->getNumVertices(), mNumInstances );
+        glDrawArraysInstancedEXT( mVboMesh->getPrimitiveType(), 0, mVboMesh->getNumVertices(), numInstances );
 #else
         glDrawArrays( mVboMesh->getPrimitiveType(), first, mVboMesh->getNumVertices() );
 #endif
@@ -327,51 +706,71 @@ void OculusSDKTestApp::render()
     
     gl::VboMesh::unbindBuffers();
     mVboMesh->disableClientStates();
-#if( defined GL_APPLE_vertex_array_object )
-    glBindVertexArrayAPPLE(0);
-#else
-    glBindVertexArray(0);
-#endif
-    mShader->unbind();
-    mBakedAO.unbind();
-    
-    mTexture.enableAndBind();
-    
-    // Render Ground and ceiling, and offset textureCoordinate
-    // to fake the travelling animation
-    glBegin( GL_QUADS );
-    
-    float k = 1000.0f;
-    float s = 5000.0f;
-    float timeScl = 0.0f;
-    
-    // Floor
-    glVertex3f( -s, -k, -s );
-    glTexCoord2f( 0 + mTime * timeScl, 0 );
-    
-    glVertex3f( s, -k, -s );
-    glTexCoord2f( 100 + mTime * timeScl, 0 );
+}
+
+void OculusSDKTestApp::render( bool instances, const Matrix44f *crop )
+{
     
-    glVertex3f( s, -k, s );
-    glTexCoord2f( 100 + mTime * timeScl, 100 );
+    // Enable depth testing
+    gl::enableDepthRead();
+    gl::enableDepthWrite();
     
-    glVertex3f( -s, -k, s );
-    glTexCoord2f( 0 + mTime * timeScl, 100 );
+    // Set camera
+    gl::setMatrices( mCamera );
     
-    // Ceiling
-    glVertex3f( -s, k, -s );
-    glTexCoord2f( 0 + mTime * timeScl, 0 );
+    // Narrow the projection to the region being rendered
+    if( crop ){
+        glMatrixMode( GL_PROJECTION );
+        glLoadMatrixf( ( *crop * mCamera.getProjectionMatrix() ).m );
+        glMatrixMode( GL_MODELVIEW );
+    }
     
-    glVertex3f( s, k, -s );
-    glTexCoord2f( 100 + mTime * timeScl, 0 );
+    enableFog();
     
-    glVertex3f( s, k, s );
-    glTexCoord2f( 100 + mTime * timeScl, 100 );
+    // Render random cubes
+    if( instances ){
+        gl::color( ColorA::white() );
+        mBakedAO.enableAndBind();
+        
+        
+        // Render instanced meshes
+        mShader->bind();
+        
+#if( defined GL_APPLE_vertex_array_object )
+        glBindVertexArrayAPPLE(mVAO);
+#else
+        glBindVertexArray(mVAO);
+#endif
+        
+        mTransformsRing->bind();
+        for (unsigned int i = 0; i < 4 && mTransformsLocation != -1 ; i++)
+            glVertexAttribPointer(mTransformsLocation + i, 4, GL_FLOAT, GL_FALSE, sizeof(Matrix44f), (const GLvoid*)(mTransformsRing->getOffset() + sizeof(GLfloat) * i * 4));
+        mTransformsRing->unbind();
+        
+        drawInstances( mNumVisible );
+        
+#if( defined GL_APPLE_vertex_array_object )
+        glBindVertexArrayAPPLE(0);
+#else
+        glBindVertexArray(0);
+#endif
+        mShader->unbind();
+        mBakedAO.unbind();
+    }
     
-    glVertex3f( -s, k, s );
-    glTexCoord2f( 0 + mTime * timeScl, 100 );
+    mTexture.enableAndBind();
     
-    glEnd();
+    // Render Ground and ceiling from the slot written this frame, the texture
+    // coordinates can be offset to fake the travelling animation
+    mFloorRing->bind();
+    glEnableClientState( GL_VERTEX_ARRAY );
+    glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+    glVertexPointer( 3, GL_FLOAT, 5 * sizeof(GLfloat), (const GLvoid*) mFloorRing->getOffset() );
+    glTexCoordPointer( 2, GL_FLOAT, 5 * sizeof(GLfloat), (const GLvoid*)( mFloorRing->getOffset() + 3 * sizeof(GLfloat) ) );
+    glDrawArrays( GL_QUADS, 0, 8 );
+    glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+    glDisableClientState( GL_VERTEX_ARRAY );
+    mFloorRing->unbind();
     
     mTexture.unbind();
     
@@ -0,0 +1,98 @@
+//
+//  BufferRing.cpp
+//  OculusSDKTest
+//
+
+#include "BufferRing.h"
+
+namespace ovr {
+
+    FenceProviderRef GlFenceProvider::create()
+    {
+#if defined( GL_ARB_sync )
+        if( ci::gl::isExtensionAvailable( "GL_ARB_sync" ) )
+            return FenceProviderRef( new GlFenceProvider() );
+#endif
+        return FenceProviderRef();
+    }
+
+    FenceProvider::Fence GlFenceProvider::insertFence()
+    {
+#if defined( GL_ARB_sync )
+        return glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+#else
+        return 0;
+#endif
+    }
+    bool GlFenceProvider::waitFence( Fence fence, uint64_t timeoutNs )
+    {
+#if defined( GL_ARB_sync )
+        GLenum result = glClientWaitSync( (GLsync) fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeoutNs );
+        return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+#else
+        return true;
+#endif
+    }
+    void GlFenceProvider::deleteFence( Fence fence )
+    {
+#if defined( GL_ARB_sync )
+        glDeleteSync( (GLsync) fence );
+#endif
+    }
+
+
+    BufferRingRef BufferRing::create( GLenum target, size_t slotSize, size_t numSlots )
+    {
+        return BufferRingRef( new BufferRing( target, slotSize, numSlots, GlFenceProvider::create() ) );
+    }
+
+    BufferRing::BufferRing( GLenum target, size_t slotSize, size_t numSlots, const FenceProviderRef &fences )
+    : mTarget( target ), mId( 0 ), mSlotSize( slotSize ), mSlots( numSlots, fences ), mMapBufferRange( false )
+    {
+#if defined( GL_ARB_map_buffer_range )
+        mMapBufferRange = ci::gl::isExtensionAvailable( "GL_ARB_map_buffer_range" );
+#endif
+        if( ! mMapBufferRange )
+            mStaging.resize( mSlotSize );
+
+        glGenBuffers( 1, &mId );
+        glBindBuffer( mTarget, mId );
+        glBufferData( mTarget, mSlotSize * mSlots.getNumSlots(), NULL, GL_STREAM_DRAW );
+        glBindBuffer( mTarget, 0 );
+    }
+    BufferRing::~BufferRing()
+    {
+        glDeleteBuffers( 1, &mId );
+    }
+
+    void* BufferRing::map()
+    {
+        bool orphan = mSlots.acquire();
+
+        glBindBuffer( mTarget, mId );
+        if( orphan )
+            glBufferData( mTarget, mSlotSize * mSlots.getNumSlots(), NULL, GL_STREAM_DRAW );
+
+        if( ! mMapBufferRange )
+            return &mStaging.front();
+
+#if defined( GL_ARB_map_buffer_range )
+        // The slot is known to be idle, the driver doesn't need to check
+        return glMapBufferRange( mTarget, getOffset(), mSlotSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT );
+#else
+        return NULL;
+#endif
+    }
+    void BufferRing::unmap()
+    {
+        glBindBuffer( mTarget, mId );
+        if( mMapBufferRange )
+            glUnmapBuffer( mTarget );
+        else glBufferSubData( mTarget, getOffset(), mSlotSize, &mStaging.front() );
+        glBindBuffer( mTarget, 0 );
+    }
+    void BufferRing::fence()
+    {
+        mSlots.release();
+    }
+}
@@ -0,0 +1,70 @@
+//
+//  BufferRing.h
+//  OculusSDKTest
+//
+//  N-buffered GL buffer for data streamed every frame.
+//
+
+#pragma once
+
+#include "cinder/gl/gl.h"
+
+#include "BufferRingSlots.h"
+
+namespace ovr {
+
+    //! GL_ARB_sync fences, returns an empty ptr if the extension isn't available
+    class GlFenceProvider : public FenceProvider
+    {
+    public:
+        static FenceProviderRef create();
+
+        virtual Fence   insertFence();
+        virtual bool    waitFence( Fence fence, uint64_t timeoutNs );
+        virtual void    deleteFence( Fence fence );
+
+    protected:
+        GlFenceProvider() {}
+    };
+
+    typedef std::shared_ptr<class BufferRing> BufferRingRef;
+
+    //! Single buffer split in \a numSlots slots, each frame writes the next slot while the
+    //! draws of the previous frames keep reading theirs. Slots are recycled once their fence
+    //! is signaled, or the storage is orphaned when fences aren't available.
+    class BufferRing
+    {
+    public:
+        //! \a slotSize is the number of bytes written each frame
+        static BufferRingRef create( GLenum target, size_t slotSize, size_t numSlots = 3 );
+        ~BufferRing();
+
+        //! Moves to the next slot and returns where to write up to getSlotSize() bytes
+        void*   map();
+        //! Ends the writes of the current slot
+        void    unmap();
+        //! Guards the current slot, call once the draws reading it have been issued
+        void    fence();
+
+        //! Returns the offset of the current slot in the buffer, to use in the attribute pointers
+        size_t  getOffset() const { return mSlots.getCurrent() * mSlotSize; }
+        void    bind() const { glBindBuffer( mTarget, mId ); }
+        void    unbind() const { glBindBuffer( mTarget, 0 ); }
+
+        GLuint  getId() const { return mId; }
+        GLenum  getTarget() const { return mTarget; }
+        size_t  getSlotSize() const { return mSlotSize; }
+        const BufferRingSlots& getSlots() const { return mSlots; }
+
+    protected:
+        BufferRing( GLenum target, size_t slotSize, size_t numSlots, const FenceProviderRef &fences );
+
+        GLenum              mTarget;
+        GLuint              mId;
+        size_t              mSlotSize;
+        BufferRingSlots     mSlots;
+        bool                mMapBufferRange;
+        //! Written instead of the mapped range when GL_ARB_map_buffer_range isn't available
+        std::vector<uint8_t> mStaging;
+    };
+}
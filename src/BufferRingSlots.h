@@ -0,0 +1,122 @@
+//
+//  BufferRingSlots.h
+//  OculusSDKTest
+//
+//  Slot and fence bookkeeping of ovr::BufferRing, without any GL call.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+namespace ovr {
+
+    typedef std::shared_ptr<class FenceProvider> FenceProviderRef;
+
+    //! Creates and waits on the fences guarding the slots of a ring. The GL implementation
+    //! wraps GL_ARB_sync, other implementations can simulate a GPU
+    class FenceProvider
+    {
+    public:
+        typedef void* Fence;
+
+        virtual ~FenceProvider() {}
+
+        //! Returns a fence signaled once the commands issued so far are done
+        virtual Fence   insertFence() = 0;
+        //! Waits up to \a timeoutNs nanoseconds, returns whether \a fence is signaled
+        virtual bool    waitFence( Fence fence, uint64_t timeoutNs ) = 0;
+        virtual void    deleteFence( Fence fence ) = 0;
+    };
+
+    //! Cycles through the slots of a buffer and tells when a slot can be written without
+    //! synchronizing with the draws still reading it. Without a FenceProvider the whole
+    //! storage is orphaned each time the ring wraps around.
+    class BufferRingSlots
+    {
+    public:
+        //! \a fences can be empty, \a maxWaitNs is how long acquire() blocks on a slot before falling back to orphaning
+        BufferRingSlots( size_t numSlots, const FenceProviderRef &fences, uint64_t maxWaitNs = 5000000 )
+        : mFences( fences ), mSlotFences( std::max<size_t>( numSlots, 1 ), (FenceProvider::Fence) 0 ),
+        mCurrent( mSlotFences.size() - 1 ), mMaxWaitNs( maxWaitNs ), mNumWaits( 0 ), mNumOrphans( 0 )
+        {
+        }
+        ~BufferRingSlots()
+        {
+            releaseFences();
+        }
+
+        //! Moves to the next slot. Returns true if the caller must orphan the storage before writing it
+        bool acquire()
+        {
+            mCurrent = ( mCurrent + 1 ) % mSlotFences.size();
+
+            if( ! mFences ){
+                if( mCurrent == 0 ){
+                    mNumOrphans++;
+                    return true;
+                }
+                return false;
+            }
+
+            FenceProvider::Fence &fence = mSlotFences[mCurrent];
+            if( ! fence )
+                return false;
+
+            // Only block if the GPU is still reading the slot, and not forever
+            bool signaled = mFences->waitFence( fence, 0 );
+            if( ! signaled ){
+                mNumWaits++;
+                signaled = mFences->waitFence( fence, mMaxWaitNs );
+            }
+            if( ! signaled ){
+                // Fresh storage, none of the previous fences guard anything anymore
+                releaseFences();
+                mNumOrphans++;
+                return true;
+            }
+            mFences->deleteFence( fence );
+            fence = 0;
+            return false;
+        }
+
+        //! Marks the current slot as read by the commands issued so far, call after the draws using it
+        void release()
+        {
+            if( ! mFences )
+                return;
+            FenceProvider::Fence &fence = mSlotFences[mCurrent];
+            if( fence )
+                mFences->deleteFence( fence );
+            fence = mFences->insertFence();
+        }
+
+        size_t      getCurrent() const { return mCurrent; }
+        size_t      getNumSlots() const { return mSlotFences.size(); }
+        bool        isUsingFences() const { return (bool) mFences; }
+        //! Returns how many times acquire() had to block on a fence
+        uint32_t    getNumWaits() const { return mNumWaits; }
+        //! Returns how many times acquire() asked for the storage to be orphaned
+        uint32_t    getNumOrphans() const { return mNumOrphans; }
+
+    protected:
+        void releaseFences()
+        {
+            for( size_t i = 0; i < mSlotFences.size(); i++ ){
+                if( mSlotFences[i] )
+                    mFences->deleteFence( mSlotFences[i] );
+                mSlotFences[i] = 0;
+            }
+        }
+
+        FenceProviderRef                    mFences;
+        std::vector<FenceProvider::Fence>   mSlotFences;
+        size_t                              mCurrent;
+        uint64_t                            mMaxWaitNs;
+        uint32_t                            mNumWaits;
+        uint32_t                            mNumOrphans;
+    };
+}
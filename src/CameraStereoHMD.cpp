@@ -8,12 +8,126 @@
 
 #include "CameraStereoHMD.h"
 
+#if defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 1 )
+    #include <xmmintrin.h>
+    #define CAMERA_STEREO_HMD_SSE
+#endif
+
 using namespace ci;
 
+namespace {
+    
+    // The eye offsets are pure translations along x, so both eyes are derived from the
+    // center matrices by touching a single row or column instead of full 4x4 products.
+    
+    // modelView * T( offset ) and its rigid inverse for both eyes, from the center modelView
+    void calcStereoModelViews( const float *modelView, float offset, float *left, float *right, float *inverse, float *inverseLeft, float *inverseRight )
+    {
+#if defined( CAMERA_STEREO_HMD_SSE )
+        __m128 c0 = _mm_loadu_ps( modelView );
+        __m128 c1 = _mm_loadu_ps( modelView + 4 );
+        __m128 c2 = _mm_loadu_ps( modelView + 8 );
+        __m128 c3 = _mm_loadu_ps( modelView + 12 );
+        __m128 eyeOffset = _mm_setr_ps( offset, 0, 0, 0 );
+        
+        // T( offset ) * modelView only adds the offset to the translation
+        _mm_storeu_ps( left, c0 );      _mm_storeu_ps( right, c0 );
+        _mm_storeu_ps( left + 4, c1 );  _mm_storeu_ps( right + 4, c1 );
+        _mm_storeu_ps( left + 8, c2 );  _mm_storeu_ps( right + 8, c2 );
+        _mm_storeu_ps( left + 12, _mm_add_ps( c3, eyeOffset ) );
+        _mm_storeu_ps( right + 12, _mm_sub_ps( c3, eyeOffset ) );
+        
+        // Rigid inverse: transposed rotation and -R^T * t
+        __m128 r0 = c0, r1 = c1, r2 = c2, r3 = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS( r0, r1, r2, r3 );
+        __m128 t = _mm_add_ps( _mm_add_ps( _mm_mul_ps( r0, _mm_shuffle_ps( c3, c3, _MM_SHUFFLE( 0, 0, 0, 0 ) ) ),
+                                           _mm_mul_ps( r1, _mm_shuffle_ps( c3, c3, _MM_SHUFFLE( 1, 1, 1, 1 ) ) ) ),
+                               _mm_mul_ps( r2, _mm_shuffle_ps( c3, c3, _MM_SHUFFLE( 2, 2, 2, 2 ) ) ) );
+        __m128 w = _mm_setr_ps( 0, 0, 0, 1 );
+        __m128 inverseT = _mm_add_ps( _mm_sub_ps( _mm_setzero_ps(), t ), w );
+        __m128 eyeInverseOffset = _mm_mul_ps( r0, _mm_set1_ps( offset ) );
+        
+        _mm_storeu_ps( inverse, r0 );       _mm_storeu_ps( inverseLeft, r0 );       _mm_storeu_ps( inverseRight, r0 );
+        _mm_storeu_ps( inverse + 4, r1 );   _mm_storeu_ps( inverseLeft + 4, r1 );   _mm_storeu_ps( inverseRight + 4, r1 );
+        _mm_storeu_ps( inverse + 8, r2 );   _mm_storeu_ps( inverseLeft + 8, r2 );   _mm_storeu_ps( inverseRight + 8, r2 );
+        _mm_storeu_ps( inverse + 12, inverseT );
+        _mm_storeu_ps( inverseLeft + 12, _mm_sub_ps( inverseT, eyeInverseOffset ) );
+        _mm_storeu_ps( inverseRight + 12, _mm_add_ps( inverseT, eyeInverseOffset ) );
+#else
+        for( int i = 0; i < 16; i++ )
+            left[i] = right[i] = modelView[i];
+        left[12]    += offset;
+        right[12]   -= offset;
+        
+        for( int c = 0; c < 3; c++ ){
+            for( int r = 0; r < 3; r++ )
+                inverse[c * 4 + r] = modelView[r * 4 + c];
+            inverse[c * 4 + 3] = 0.0f;
+        }
+        for( int r = 0; r < 3; r++ )
+            inverse[12 + r] = -( modelView[r * 4] * modelView[12] + modelView[r * 4 + 1] * modelView[13] + modelView[r * 4 + 2] * modelView[14] );
+        inverse[15] = 1.0f;
+        
+        for( int i = 0; i < 16; i++ )
+            inverseLeft[i] = inverseRight[i] = inverse[i];
+        for( int r = 0; r < 3; r++ ){
+            inverseLeft[12 + r]     -= offset * inverse[r];
+            inverseRight[12 + r]    += offset * inverse[r];
+        }
+#endif
+    }
+    
+    // T( offset ) * projection and projection^-1 * T( -offset ) for both eyes, from the center matrices
+    void calcStereoProjections( const float *projection, const float *inverseProjection, float offset, float *left, float *right, float *inverseLeft, float *inverseRight )
+    {
+#if defined( CAMERA_STEREO_HMD_SSE )
+        // Work on rows to add the scaled last row to the first one
+        __m128 r0 = _mm_loadu_ps( projection );
+        __m128 r1 = _mm_loadu_ps( projection + 4 );
+        __m128 r2 = _mm_loadu_ps( projection + 8 );
+        __m128 r3 = _mm_loadu_ps( projection + 12 );
+        _MM_TRANSPOSE4_PS( r0, r1, r2, r3 );
+        
+        __m128 shift = _mm_mul_ps( r3, _mm_set1_ps( offset ) );
+        __m128 l0 = _mm_add_ps( r0, shift ), l1 = r1, l2 = r2, l3 = r3;
+        __m128 p0 = _mm_sub_ps( r0, shift ), p1 = r1, p2 = r2, p3 = r3;
+        _MM_TRANSPOSE4_PS( l0, l1, l2, l3 );
+        _MM_TRANSPOSE4_PS( p0, p1, p2, p3 );
+        _mm_storeu_ps( left, l0 );      _mm_storeu_ps( right, p0 );
+        _mm_storeu_ps( left + 4, l1 );  _mm_storeu_ps( right + 4, p1 );
+        _mm_storeu_ps( left + 8, l2 );  _mm_storeu_ps( right + 8, p2 );
+        _mm_storeu_ps( left + 12, l3 ); _mm_storeu_ps( right + 12, p3 );
+        
+        // The inverse translation only changes the last column
+        __m128 i0 = _mm_loadu_ps( inverseProjection );
+        __m128 i3 = _mm_loadu_ps( inverseProjection + 12 );
+        __m128 inverseShift = _mm_mul_ps( i0, _mm_set1_ps( offset ) );
+        for( int i = 0; i < 12; i++ )
+            inverseLeft[i] = inverseRight[i] = inverseProjection[i];
+        _mm_storeu_ps( inverseLeft + 12, _mm_sub_ps( i3, inverseShift ) );
+        _mm_storeu_ps( inverseRight + 12, _mm_add_ps( i3, inverseShift ) );
+#else
+        for( int i = 0; i < 16; i++ ){
+            left[i] = right[i] = projection[i];
+            inverseLeft[i] = inverseRight[i] = inverseProjection[i];
+        }
+        for( int c = 0; c < 4; c++ ){
+            left[c * 4]     += offset * projection[c * 4 + 3];
+            right[c * 4]    -= offset * projection[c * 4 + 3];
+        }
+        for( int r = 0; r < 4; r++ ){
+            inverseLeft[12 + r]     -= offset * inverseProjection[r];
+            inverseRight[12 + r]    += offset * inverseProjection[r];
+        }
+#endif
+    }
+}
+
 
 CameraStereoHMD::CameraStereoHMD()
 : ci::CameraStereo()
 , mProjectionCenterOffset( 0.151976f )
+, mFusedUpdate( true )
 {
     setEyeSeparation( 0.64f );//0.00119808f );
     setConvergence(0);
@@ -23,6 +137,7 @@ CameraStereoHMD::CameraStereoHMD()
 CameraStereoHMD::CameraStereoHMD( int pixelWidth, int pixelHeight, float fov )
 : CameraStereo( pixelWidth, pixelHeight, fov )
 , mProjectionCenterOffset( 0.151976f )
+, mFusedUpdate( true )
 {
     setEyeSeparation( 0.64f );//0.00119808f );
     setConvergence(0);
@@ -31,6 +146,7 @@ CameraStereoHMD::CameraStereoHMD( int pixelWidth, int pixelHeight, float fov )
 CameraStereoHMD::CameraStereoHMD( int pixelWidth, int pixelHeight, float fov, float nearPlane, float farPlane )
 : CameraStereo( pixelWidth, pixelHeight, fov, nearPlane, farPlane )
 , mProjectionCenterOffset( 0.151976f )
+, mFusedUpdate( true )
 {
     setEyeSeparation( 0.64f );//0.00119808f );
     setConvergence(0);
@@ -58,6 +174,13 @@ const Matrix44f& CameraStereoHMD::getInverseModelViewMatrixLeft() const
     
     return mInverseModelViewMatrixLeft;
 }
+const Matrix44f& CameraStereoHMD::getInverseProjectionMatrixLeft() const
+{
+	if( ! mProjectionCached )
+		calcProjection();
+    
+    return mInverseProjectionMatrixLeft;
+}
 
 
 const Matrix44f& CameraStereoHMD::getProjectionMatrixRight() const
@@ -81,6 +204,19 @@ const Matrix44f& CameraStereoHMD::getInverseModelViewMatrixRight() const
     
     return mInverseModelViewMatrixRight;
 }
+const Matrix44f& CameraStereoHMD::getInverseProjectionMatrixRight() const
+{
+	if( ! mProjectionCached )
+		calcProjection();
+    
+    return mInverseProjectionMatrixRight;
+}
+
+void CameraStereoHMD::getViewProjectionMatrices( Matrix44f matrices[2] ) const
+{
+    matrices[0] = getProjectionMatrixLeft() * getModelViewMatrixLeft();
+    matrices[1] = getProjectionMatrixRight() * getModelViewMatrixRight();
+}
 
 
 void CameraStereoHMD::calcModelView() const
@@ -88,6 +224,13 @@ void CameraStereoHMD::calcModelView() const
 	// calculate default matrix first
 	CameraPersp::calcModelView();
     
+    if( mFusedUpdate ){
+        calcStereoModelViews( mModelViewMatrix.m, getEyeSeparation(), mModelViewMatrixLeft.m, mModelViewMatrixRight.m,
+                              mInverseModelViewMatrix.m, mInverseModelViewMatrixLeft.m, mInverseModelViewMatrixRight.m );
+        mInverseModelViewCached = true;
+        return;
+    }
+    
 	mModelViewMatrixLeft = Matrix44f::createTranslation( Vec3f( getEyeSeparation(), 0, 0 ) ) * mModelViewMatrix;
 	mModelViewMatrixRight = Matrix44f::createTranslation( Vec3f( -getEyeSeparation(), 0, 0 ) ) * mModelViewMatrix;
 }
@@ -96,9 +239,17 @@ void CameraStereoHMD::calcProjection() const
 	// calculate default matrices first
 	CameraPersp::calcProjection();
 	
+    if( mFusedUpdate ){
+        // CameraPersp already provides the exact inverse of the center projection
+        calcStereoProjections( mProjectionMatrix.m, mInverseProjectionMatrix.m, mProjectionCenterOffset, mProjectionMatrixLeft.m, mProjectionMatrixRight.m,
+                               mInverseProjectionMatrixLeft.m, mInverseProjectionMatrixRight.m );
+        return;
+    }
+    
+	// A perspective projection isn't affine, affineInverted() would drop its last row
 	mProjectionMatrixLeft = Matrix44f::createTranslation( Vec3f( mProjectionCenterOffset, 0, 0 ) ) * mProjectionMatrix;
-	mInverseProjectionMatrixLeft = mProjectionMatrixLeft.affineInverted();
+	mInverseProjectionMatrixLeft = mProjectionMatrixLeft.inverted();
 	
 	mProjectionMatrixRight = Matrix44f::createTranslation( Vec3f( -mProjectionCenterOffset, 0, 0 ) ) * mProjectionMatrix;
-	mInverseProjectionMatrixRight = mProjectionMatrixRight.affineInverted();
+	mInverseProjectionMatrixRight = mProjectionMatrixRight.inverted();
 }
\ No newline at end of file
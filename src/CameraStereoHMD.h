@@ -20,7 +20,13 @@ public:
     //! Returns value used to offset the projections matrices
     float   getProjectionCenterOffset() const { return mProjectionCenterOffset; }
     //! Set the value used to offset the projections matrices
-    void    setProjectionCenterOffset( float offset ) { mProjectionCenterOffset = offset; }
+    void    setProjectionCenterOffset( float offset ) { mProjectionCenterOffset = offset; mProjectionCached = false; }
+    
+    //! Enables the fused update computing both eyes matrices and their inverses in a single pass (default). Both updates
+    //! produce the same matrices, the inverse projections are exact in both instead of the affineInverted() CameraStereo uses
+    void    enableFusedUpdate( bool enable = true ) { mFusedUpdate = enable; mModelViewCached = mProjectionCached = mInverseModelViewCached = false; }
+    //! Returns whether the fused update is enabled
+    bool    isFusedUpdateEnabled() const { return mFusedUpdate; }
 	
     //! Returns Left Eye Projection Matrix
 	virtual const ci::Matrix44f&	getProjectionMatrixLeft() const;
@@ -28,6 +34,8 @@ public:
 	virtual const ci::Matrix44f&	getModelViewMatrixLeft() const;
     //! Returns Left Eye Inverse-ModelView Matrix
 	virtual const ci::Matrix44f&	getInverseModelViewMatrixLeft() const;
+    //! Returns Left Eye Inverse Projection Matrix
+	const ci::Matrix44f&	getInverseProjectionMatrixLeft() const;
     
     //! Returns Right Eye Projection Matrix
 	virtual const ci::Matrix44f&	getProjectionMatrixRight() const;
@@ -35,6 +43,11 @@ public:
 	virtual const ci::Matrix44f&	getModelViewMatrixRight() const;
     //! Returns Right Eye Inverse-ModelView Matrix
 	virtual const ci::Matrix44f&	getInverseModelViewMatrixRight() const;
+    //! Returns Right Eye Inverse Projection Matrix
+	const ci::Matrix44f&	getInverseProjectionMatrixRight() const;
+    
+    //! Writes the left and right eye projection * modelView matrices to \a matrices, for shaders drawing both eyes in one pass
+    void    getViewProjectionMatrices( ci::Matrix44f matrices[2] ) const;
     
 protected:
     
@@ -44,4 +57,5 @@ protected:
 private:
     
     float           mProjectionCenterOffset;
+    bool            mFusedUpdate;
 };
\ No newline at end of file
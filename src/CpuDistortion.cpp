@@ -0,0 +1,229 @@
+//
+//  CpuDistortion.cpp
+//  OculusSDKTest
+//
+
+#include "CpuDistortion.h"
+#include "SimdLanes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using namespace ci;
+
+namespace ovr {
+
+    namespace {
+
+        // Red, green and blue lookups of OVR_SIMD_LANES consecutive pixels
+        struct Lookups {
+            float   redX[OVR_SIMD_LANES], redY[OVR_SIMD_LANES];
+            float   greenX[OVR_SIMD_LANES], greenY[OVR_SIMD_LANES];
+            float   blueX[OVR_SIMD_LANES], blueY[OVR_SIMD_LANES];
+            int     insideMask;
+        };
+
+#if OVR_SIMD_LANES > 1
+        inline int insideMask( lane_t x, lane_t y, lane_t minX, lane_t maxX, lane_t minY, lane_t maxY )
+        {
+            lane_t inX = andMask( cmpge( x, minX ), cmple( x, maxX ) );
+            lane_t inY = andMask( cmpge( y, minY ), cmple( y, maxY ) );
+            return movemask( andMask( inX, inY ) );
+        }
+
+        // Vectorized HmdWarp, same operations in the same order as hmdWarp and hmdWarpChromatic
+        void warpLanes( const EyeWarpParams &eye, const Vec4f &k, const Vec4f &chromAb, bool chromatic, int32_t x, float v, int32_t width, Lookups *out )
+        {
+            lane_t px       = add( set1( (float) x ), laneIndices() );
+            lane_t u        = div( add( px, set1( 0.5f ) ), set1( (float) width ) );
+            lane_t thetaX   = mul( sub( u, set1( eye.lensCenter.x ) ), set1( eye.scaleIn.x ) );
+            lane_t thetaY   = mul( sub( set1( v ), set1( eye.lensCenter.y ) ), set1( eye.scaleIn.y ) );
+            lane_t rSq      = add( mul( thetaX, thetaX ), mul( thetaY, thetaY ) );
+            lane_t f        = add( add( add( set1( k.x ), mul( set1( k.y ), rSq ) ),
+                                        mul( mul( set1( k.z ), rSq ), rSq ) ),
+                                   mul( mul( mul( set1( k.w ), rSq ), rSq ), rSq ) );
+            lane_t theta1X  = mul( thetaX, f );
+            lane_t theta1Y  = mul( thetaY, f );
+
+            lane_t lensX    = set1( eye.lensCenter.x );
+            lane_t lensY    = set1( eye.lensCenter.y );
+            lane_t scaleX   = set1( eye.scale.x );
+            lane_t scaleY   = set1( eye.scale.y );
+            lane_t minX     = set1( eye.screenCenter.x - 0.25f );
+            lane_t maxX     = set1( eye.screenCenter.x + 0.25f );
+            lane_t minY     = set1( eye.screenCenter.y - 0.5f );
+            lane_t maxY     = set1( eye.screenCenter.y + 0.5f );
+
+            lane_t greenX   = add( lensX, mul( scaleX, theta1X ) );
+            lane_t greenY   = add( lensY, mul( scaleY, theta1Y ) );
+            store( out->greenX, greenX );
+            store( out->greenY, greenY );
+
+            if( chromatic ){
+                lane_t blue     = add( set1( chromAb.z ), mul( set1( chromAb.w ), rSq ) );
+                lane_t red      = add( set1( chromAb.x ), mul( set1( chromAb.y ), rSq ) );
+                lane_t blueX    = add( lensX, mul( scaleX, mul( theta1X, blue ) ) );
+                lane_t blueY    = add( lensY, mul( scaleY, mul( theta1Y, blue ) ) );
+                store( out->blueX, blueX );
+                store( out->blueY, blueY );
+                store( out->redX, add( lensX, mul( scaleX, mul( theta1X, red ) ) ) );
+                store( out->redY, add( lensY, mul( scaleY, mul( theta1Y, red ) ) ) );
+                out->insideMask = insideMask( blueX, blueY, minX, maxX, minY, maxY );
+            }
+            else out->insideMask = insideMask( greenX, greenY, minX, maxX, minY, maxY );
+        }
+#endif
+
+        // Scalar HmdWarp of a single pixel, stored in the first lane
+        void warpScalar( const EyeWarpParams &eye, const Vec4f &k, const Vec4f &chromAb, bool chromatic, int32_t x, float v, int32_t width, Lookups *out )
+        {
+            Vec2f in01( ( x + 0.5f ) / (float) width, v );
+            Vec2f red, green, blue;
+            bool inside;
+            if( chromatic )
+                inside = hmdWarpChromatic( eye, k, chromAb, in01, &red, &green, &blue );
+            else {
+                inside = hmdWarp( eye, k, in01, &green );
+                red = blue = green;
+            }
+            out->redX[0]    = red.x;    out->redY[0]    = red.y;
+            out->greenX[0]  = green.x;  out->greenY[0]  = green.y;
+            out->blueX[0]   = blue.x;   out->blueY[0]   = blue.y;
+            out->insideMask = inside ? 1 : 0;
+        }
+
+        // Bilinear fetch of one channel with GL_LINEAR and GL_CLAMP_TO_EDGE semantics
+        inline float sampleChannel( const Surface8u &source, uint8_t offset, float u, float v )
+        {
+            int32_t width       = source.getWidth();
+            int32_t height      = source.getHeight();
+            float x             = u * width - 0.5f;
+            float y             = v * height - 0.5f;
+            float fx            = floorf( x );
+            float fy            = floorf( y );
+            float ax            = x - fx;
+            float ay            = y - fy;
+            int32_t x0          = std::min( std::max( (int32_t) fx, 0 ), width - 1 );
+            int32_t x1          = std::min( std::max( (int32_t) fx + 1, 0 ), width - 1 );
+            int32_t y0          = std::min( std::max( (int32_t) fy, 0 ), height - 1 );
+            int32_t y1          = std::min( std::max( (int32_t) fy + 1, 0 ), height - 1 );
+            uint8_t inc         = source.getPixelInc();
+            const uint8_t *row0 = source.getData() + y0 * source.getRowBytes() + offset;
+            const uint8_t *row1 = source.getData() + y1 * source.getRowBytes() + offset;
+
+            float top           = row0[x0 * inc] * ( 1.0f - ax ) + row0[x1 * inc] * ax;
+            float bottom        = row1[x0 * inc] * ( 1.0f - ax ) + row1[x1 * inc] * ax;
+            return top * ( 1.0f - ay ) + bottom * ay;
+        }
+
+        inline uint8_t toUnorm( float v )
+        {
+            return (uint8_t) std::min( std::max( v + 0.5f, 0.0f ), 255.0f );
+        }
+
+        // Writes the lanes of lookups to count consecutive destination pixels
+        inline void writeLanes( const Surface8u &source, bool chromatic, const Lookups &lookups, int count, uint8_t *dst, const Surface8u &destination )
+        {
+            uint8_t inc = destination.getPixelInc();
+            for( int i = 0; i < count; i++, dst += inc ){
+                bool inside = ( lookups.insideMask >> i ) & 1;
+                if( ! inside ){
+                    dst[destination.getRedOffset()]     = 0;
+                    dst[destination.getGreenOffset()]   = 0;
+                    dst[destination.getBlueOffset()]    = 0;
+                    if( destination.hasAlpha() )
+                        dst[destination.getAlphaOffset()] = chromatic ? 0 : 255;
+                    continue;
+                }
+                dst[destination.getRedOffset()]     = toUnorm( sampleChannel( source, source.getRedOffset(), lookups.redX[i], lookups.redY[i] ) );
+                dst[destination.getGreenOffset()]   = toUnorm( sampleChannel( source, source.getGreenOffset(), lookups.greenX[i], lookups.greenY[i] ) );
+                dst[destination.getBlueOffset()]    = toUnorm( sampleChannel( source, source.getBlueOffset(), lookups.blueX[i], lookups.blueY[i] ) );
+                if( destination.hasAlpha() )
+                    dst[destination.getAlphaOffset()] = 255;
+            }
+        }
+    }
+
+    CpuDistortionRef CpuDistortion::create( bool chromaticAbCorrection, size_t numThreads )
+    {
+        return CpuDistortionRef( new CpuDistortion( chromaticAbCorrection, numThreads ) );
+    }
+
+    CpuDistortion::CpuDistortion( bool chromaticAbCorrection, size_t numThreads )
+    :
+    mDistortionParams( DK1DistortionParams ),
+    mDistortionScale( DK1DistortionScale ),
+    mUseChromaticAbCorrection( chromaticAbCorrection ),
+    mChromaticAbCorrection( DK1ChromaticAbCorrection ),
+    mNumThreads( numThreads ? numThreads : std::max( std::thread::hardware_concurrency(), 1u ) )
+    {
+    }
+
+    size_t CpuDistortion::getNumLanes()
+    {
+        return OVR_SIMD_LANES;
+    }
+
+    Surface8u CpuDistortion::render( const Surface8u &source, const Vec2i &size ) const
+    {
+        Surface8u destination( size.x, size.y, true, SurfaceChannelOrder::RGBA );
+        render( source, &destination );
+        return destination;
+    }
+
+    void CpuDistortion::render( const Surface8u &source, Surface8u *destination ) const
+    {
+        // Split the scanlines in one contiguous band per thread
+        int32_t height      = destination->getHeight();
+        int32_t numBands    = std::min<int32_t>( mNumThreads, height );
+        if( numBands <= 1 ){
+            renderRows( source, destination, 0, height );
+            return;
+        }
+
+        std::vector<std::thread> threads;
+        for( int32_t i = 0; i < numBands; i++ ){
+            int32_t rowBegin    = height * i / numBands;
+            int32_t rowEnd      = height * ( i + 1 ) / numBands;
+            threads.push_back( std::thread( &CpuDistortion::renderRows, this, std::cref( source ), destination, rowBegin, rowEnd ) );
+        }
+        for( size_t i = 0; i < threads.size(); i++ )
+            threads[i].join();
+    }
+
+    void CpuDistortion::renderRows( const Surface8u &source, Surface8u *destination, int32_t rowBegin, int32_t rowEnd ) const
+    {
+        int32_t width       = destination->getWidth();
+        int32_t height      = destination->getHeight();
+        float as            = ( (float) width * 0.5f ) / (float) height;
+        int32_t split       = (int32_t) ( width * 0.5f ); // same split as the scissor in DistortionHelper
+        EyeWarpParams eyes[2] = { EyeWarpParams::calc( EYE_LEFT, as, mDistortionScale ), EyeWarpParams::calc( EYE_RIGHT, as, mDistortionScale ) };
+        uint8_t inc         = destination->getPixelInc();
+        Lookups lookups;
+
+        // The warp is symmetric around the horizontal lens axis, so rows can be
+        // walked top to bottom in both images without flipping the coordinates
+        for( int32_t y = rowBegin; y < rowEnd; y++ ){
+            uint8_t *row    = destination->getData() + y * destination->getRowBytes();
+            float v         = ( y + 0.5f ) / (float) height;
+
+            for( int eye = 0; eye < 2; eye++ ){
+                const EyeWarpParams &params = eyes[eye];
+                int32_t x       = eye == EYE_LEFT ? 0 : split;
+                int32_t end     = eye == EYE_LEFT ? split : width;
+#if OVR_SIMD_LANES > 1
+                for( ; x + OVR_SIMD_LANES <= end; x += OVR_SIMD_LANES ){
+                    warpLanes( params, mDistortionParams, mChromaticAbCorrection, mUseChromaticAbCorrection, x, v, width, &lookups );
+                    writeLanes( source, mUseChromaticAbCorrection, lookups, OVR_SIMD_LANES, row + x * inc, *destination );
+                }
+#endif
+                for( ; x < end; x++ ){
+                    warpScalar( params, mDistortionParams, mChromaticAbCorrection, mUseChromaticAbCorrection, x, v, width, &lookups );
+                    writeLanes( source, mUseChromaticAbCorrection, lookups, 1, row + x * inc, *destination );
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,52 @@
+//
+//  CpuDistortion.h
+//  OculusSDKTest
+//
+//  Headless version of the distortion shaders, used for offline
+//  rendering, golden images and throughput measurements.
+//
+
+#pragma once
+
+#include "cinder/Surface.h"
+
+#include "Distortion.h"
+
+namespace ovr {
+
+    typedef std::shared_ptr<class CpuDistortion> CpuDistortionRef;
+
+    class CpuDistortion
+    {
+    public:
+        //! Returns a CpuDistortion using the same defaults as DistortionHelper. A \a numThreads of 0 uses all cores
+        static CpuDistortionRef create( bool chromaticAbCorrection = true, size_t numThreads = 0 );
+
+        //! Returns the side by side \a source distorted into a \a size image
+        ci::Surface8u   render( const ci::Surface8u &source, const ci::Vec2i &size = ci::Vec2i( 1280, 800 ) ) const;
+        //! Distorts the side by side \a source into \a destination, which keeps its size and channel order
+        void            render( const ci::Surface8u &source, ci::Surface8u *destination ) const;
+
+        void        setDistortionParams( const ci::Vec4f &params ) { mDistortionParams = params; }
+        ci::Vec4f   getDistortionParams() const { return mDistortionParams; }
+        void        setDistortionScale( float scale ) { mDistortionScale = scale; }
+        float       getDistortionScale() const { return mDistortionScale; }
+        void        setChromaticAbCorrection( const ci::Vec4f &params ) { mChromaticAbCorrection = params; }
+        ci::Vec4f   getChromaticAbCorrection() const { return mChromaticAbCorrection; }
+
+        //! Returns the number of pixels processed at once by the vectorized path (1, 4 or 8)
+        static size_t   getNumLanes();
+        size_t          getNumThreads() const { return mNumThreads; }
+
+    protected:
+        CpuDistortion( bool chromaticAbCorrection, size_t numThreads );
+
+        void    renderRows( const ci::Surface8u &source, ci::Surface8u *destination, int32_t rowBegin, int32_t rowEnd ) const;
+
+        ci::Vec4f   mDistortionParams;
+        float       mDistortionScale;
+        bool        mUseChromaticAbCorrection;
+        ci::Vec4f   mChromaticAbCorrection;
+        size_t      mNumThreads;
+    };
+}
@@ -0,0 +1,95 @@
+//
+//  Distortion.h
+//  OculusSDKTest
+//
+//  CPU side of the lens distortion math used by ovr::DistortionHelper.
+//
+
+#pragma once
+
+#include "cinder/Vector.h"
+
+#include <cmath>
+
+namespace ovr {
+
+    //! Eye index used by the distortion utilities
+    enum Eye { EYE_LEFT = 0, EYE_RIGHT = 1 };
+
+    //! Lens parameters of the DK1, used until an HMD provides its own
+    const ci::Vec4f DK1DistortionParams( 1.0f, 0.22f, 0.24f, 0.0f );
+    const float     DK1DistortionScale = 1.71461f;
+    const ci::Vec4f DK1ChromaticAbCorrection( 0.996f, -0.004f, 1.014f, 0.0f );
+
+    //! Per-eye lens warp parameters, expressed in the texture space of the side by side render target
+    struct EyeWarpParams {
+        ci::Vec2f   lensCenter;
+        ci::Vec2f   screenCenter;
+        ci::Vec2f   scale;
+        ci::Vec2f   scaleIn;
+
+        //! Computes the parameters of \a eye. \a aspectRatio is the width of one eye divided by its height
+        static EyeWarpParams calc( Eye eye, float aspectRatio, float distortionScale )
+        {
+            float w                         = 0.5f;
+            float h                         = 1.0f;
+            float x                         = eye == EYE_LEFT ? 0.0f : 0.5f;
+            float y                         = 0.0f;
+            float distortionXCenterOffset   = ( eye == EYE_LEFT ? 0.25f : -0.25f ) / distortionScale;
+            float scaleFactor               = 1.0f / distortionScale;
+
+            EyeWarpParams params;
+            params.lensCenter   = ci::Vec2f( x + (w + distortionXCenterOffset * 0.5f)*0.5f, y + h*0.5f );
+            params.screenCenter = ci::Vec2f( x + w*0.5f, y + h*0.5f );
+            params.scale        = ci::Vec2f( (w/2) * scaleFactor, (h/2) * scaleFactor * aspectRatio );
+            params.scaleIn      = ci::Vec2f( (2/w), (2/h) / aspectRatio );
+            return params;
+        }
+    };
+
+    //! Returns the radial scaling of the HmdWarp polynomial for a squared radius \a rSq
+    inline float warpFactor( const ci::Vec4f &k, float rSq )
+    {
+        return k.x + k.y * rSq + k.z * rSq * rSq + k.w * rSq * rSq * rSq;
+    }
+
+    //! Returns whether \a tc falls inside the eye, same test as the clamp done in the distortion shaders
+    inline bool isInsideEye( const EyeWarpParams &eye, const ci::Vec2f &tc )
+    {
+        return tc.x >= eye.screenCenter.x - 0.25f && tc.x <= eye.screenCenter.x + 0.25f
+            && tc.y >= eye.screenCenter.y - 0.5f  && tc.y <= eye.screenCenter.y + 0.5f;
+    }
+
+    //! Evaluates HmdWarp for \a in01 and returns whether the lookup is inside the eye
+    inline bool hmdWarp( const EyeWarpParams &eye, const ci::Vec4f &k, const ci::Vec2f &in01, ci::Vec2f *tc )
+    {
+        float thetaX    = ( in01.x - eye.lensCenter.x ) * eye.scaleIn.x;
+        float thetaY    = ( in01.y - eye.lensCenter.y ) * eye.scaleIn.y;
+        float rSq       = thetaX * thetaX + thetaY * thetaY;
+        float f         = warpFactor( k, rSq );
+        float theta1X   = thetaX * f;
+        float theta1Y   = thetaY * f;
+
+        *tc = ci::Vec2f( eye.lensCenter.x + eye.scale.x * theta1X, eye.lensCenter.y + eye.scale.y * theta1Y );
+        return isInsideEye( eye, *tc );
+    }
+
+    //! Evaluates HmdWarp with chromatic aberration correction for \a in01.
+    //! Returns whether the blue lookup, the one scaled the furthest, is inside the eye
+    inline bool hmdWarpChromatic( const EyeWarpParams &eye, const ci::Vec4f &k, const ci::Vec4f &chromAb, const ci::Vec2f &in01, ci::Vec2f *tcRed, ci::Vec2f *tcGreen, ci::Vec2f *tcBlue )
+    {
+        float thetaX    = ( in01.x - eye.lensCenter.x ) * eye.scaleIn.x;
+        float thetaY    = ( in01.y - eye.lensCenter.y ) * eye.scaleIn.y;
+        float rSq       = thetaX * thetaX + thetaY * thetaY;
+        float f         = warpFactor( k, rSq );
+        float theta1X   = thetaX * f;
+        float theta1Y   = thetaY * f;
+        float blue      = chromAb.z + chromAb.w * rSq;
+        float red       = chromAb.x + chromAb.y * rSq;
+
+        *tcBlue     = ci::Vec2f( eye.lensCenter.x + eye.scale.x * ( theta1X * blue ), eye.lensCenter.y + eye.scale.y * ( theta1Y * blue ) );
+        *tcGreen    = ci::Vec2f( eye.lensCenter.x + eye.scale.x * theta1X, eye.lensCenter.y + eye.scale.y * theta1Y );
+        *tcRed      = ci::Vec2f( eye.lensCenter.x + eye.scale.x * ( theta1X * red ), eye.lensCenter.y + eye.scale.y * ( theta1Y * red ) );
+        return isInsideEye( eye, *tcBlue );
+    }
+}
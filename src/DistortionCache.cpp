@@ -0,0 +1,161 @@
+//
+//  DistortionCache.cpp
+//  OculusSDKTest
+//
+
+#include "DistortionCache.h"
+#include "MappedFile.h"
+
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+using namespace ci;
+
+namespace ovr {
+
+    namespace {
+
+        struct Header {
+            char        magic[4];
+            uint32_t    version;
+            uint64_t    key;
+            uint32_t    columns;
+            uint32_t    rows;
+            float       aspectRatio;
+            uint32_t    numVertices;
+            uint32_t    numIndices;
+            uint32_t    padding;
+            uint64_t    checksum;
+        };
+
+        const char Magic[4] = { 'O', 'V', 'R', 'D' };
+
+        template<typename T>
+        uint64_t hashValue( const T &value, uint64_t hash )
+        {
+            return fnv1a( &value, sizeof( T ), hash );
+        }
+
+        float aspectRatio( const DistortionCache::Key &key )
+        {
+            return ( (float) key.resolution.x * 0.5f ) / (float) key.resolution.y;
+        }
+    }
+
+    const uint32_t DistortionCache::VERSION;
+
+    DistortionCache::Key::Key()
+    : distortionParams( DK1DistortionParams ),
+    distortionScale( DK1DistortionScale ),
+    chromaticAbCorrection( DK1ChromaticAbCorrection ),
+    useChromaticAbCorrection( true ),
+    resolution( 1280, 800 ),
+    columns( 32 ),
+    rows( 40 )
+    {
+    }
+
+    uint64_t DistortionCache::Key::hash() const
+    {
+        uint64_t h = hashValue( VERSION, 14695981039346656037ULL );
+        for( int i = 0; i < 4; i++ )
+            h = hashValue( distortionParams[i], h );
+        h = hashValue( distortionScale, h );
+        for( int i = 0; i < 4; i++ )
+            h = hashValue( chromaticAbCorrection[i], h );
+        h = hashValue( (uint8_t) useChromaticAbCorrection, h );
+        h = hashValue( resolution.x, h );
+        h = hashValue( resolution.y, h );
+        h = hashValue( columns, h );
+        h = hashValue( rows, h );
+        return h;
+    }
+
+    fs::path DistortionCache::getPath( const fs::path &directory, const Key &key )
+    {
+        std::stringstream name;
+        name << "distortion_" << std::hex << key.hash() << ".bin";
+        return directory / name.str();
+    }
+
+    DistortionMeshRef DistortionCache::loadOrGenerate( const fs::path &directory, const Key &key )
+    {
+        DistortionMeshRef mesh = load( directory, key );
+        if( mesh )
+            return mesh;
+
+        mesh = DistortionMesh::create( key.distortionParams, key.distortionScale, key.chromaticAbCorrection, key.useChromaticAbCorrection, aspectRatio( key ), key.columns, key.rows );
+        save( directory, key, mesh );
+        return mesh;
+    }
+
+    DistortionMeshRef DistortionCache::load( const fs::path &directory, const Key &key )
+    {
+        MappedFileRef file = MappedFile::open( getPath( directory, key ) );
+        if( ! file || file->getSize() < sizeof( Header ) )
+            return DistortionMeshRef();
+
+        // Reject anything that doesn't exactly match the key and the payload
+        Header header;
+        std::memcpy( &header, file->getData(), sizeof( Header ) );
+        if( std::memcmp( header.magic, Magic, 4 ) != 0 || header.version != VERSION || header.key != key.hash() )
+            return DistortionMeshRef();
+        if( header.columns != (uint32_t) key.columns || header.rows != (uint32_t) key.rows || header.aspectRatio != aspectRatio( key ) )
+            return DistortionMeshRef();
+
+        size_t verticesSize = header.numVertices * sizeof( DistortionMesh::Vertex );
+        size_t indicesSize  = header.numIndices * sizeof( uint32_t );
+        if( file->getSize() != sizeof( Header ) + verticesSize + indicesSize )
+            return DistortionMeshRef();
+
+        const uint8_t *payload = file->getData() + sizeof( Header );
+        if( fnv1a( payload, verticesSize + indicesSize ) != header.checksum )
+            return DistortionMeshRef();
+
+        const DistortionMesh::Vertex *vertices  = reinterpret_cast<const DistortionMesh::Vertex*>( payload );
+        const uint32_t *indices                 = reinterpret_cast<const uint32_t*>( payload + verticesSize );
+        for( uint32_t i = 0; i < header.numIndices; i++ ){
+            if( indices[i] >= header.numVertices )
+                return DistortionMeshRef();
+        }
+
+        return DistortionMesh::create( header.columns, header.rows, header.aspectRatio, vertices, header.numVertices, indices, header.numIndices );
+    }
+
+    bool DistortionCache::save( const fs::path &directory, const Key &key, const DistortionMeshRef &mesh )
+    {
+        const std::vector<DistortionMesh::Vertex> &vertices = mesh->getVertices();
+        const std::vector<uint32_t> &indices                = mesh->getIndices();
+        size_t verticesSize                                 = vertices.size() * sizeof( DistortionMesh::Vertex );
+        size_t indicesSize                                  = indices.size() * sizeof( uint32_t );
+
+        Header header;
+        std::memset( &header, 0, sizeof( Header ) );
+        std::memcpy( header.magic, Magic, 4 );
+        header.version      = VERSION;
+        header.key          = key.hash();
+        header.columns      = mesh->getNumColumns();
+        header.rows         = mesh->getNumRows();
+        header.aspectRatio  = mesh->getAspectRatio();
+        header.numVertices  = vertices.size();
+        header.numIndices   = indices.size();
+        header.checksum     = fnv1a( vertices.empty() ? NULL : &vertices.front(), verticesSize );
+        header.checksum     = fnv1a( indices.empty() ? NULL : &indices.front(), indicesSize, header.checksum );
+
+        std::vector<FileChunk> chunks;
+        chunks.push_back( FileChunk( &header, sizeof( Header ) ) );
+        chunks.push_back( FileChunk( vertices.empty() ? NULL : &vertices.front(), verticesSize ) );
+        chunks.push_back( FileChunk( indices.empty() ? NULL : &indices.front(), indicesSize ) );
+
+        try {
+            if( ! writeFileAtomically( getPath( directory, key ), chunks ) )
+                return false;
+        }
+        catch( const std::exception &exc ){
+            std::cout << "ovr::DistortionCache Exception: " << std::endl << exc.what() << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,48 @@
+//
+//  DistortionCache.h
+//  OculusSDKTest
+//
+//  Versioned on-disk cache of the distortion meshes, keyed by the HMD parameters.
+//
+
+#pragma once
+
+#include "cinder/Filesystem.h"
+
+#include "DistortionMesh.h"
+
+namespace ovr {
+
+    class DistortionCache
+    {
+    public:
+        //! Inputs of the distortion tables, any change produces a different cache file
+        struct Key {
+            Key();
+
+            ci::Vec4f   distortionParams;
+            float       distortionScale;
+            ci::Vec4f   chromaticAbCorrection;
+            bool        useChromaticAbCorrection;
+            ci::Vec2i   resolution;
+            int         columns;
+            int         rows;
+
+            //! Returns a hash of every field and of the cache format version
+            uint64_t    hash() const;
+        };
+
+        //! Returns the mesh stored in \a directory for \a key, or generates and stores it if the cache is missing, stale or corrupt
+        static DistortionMeshRef    loadOrGenerate( const ci::fs::path &directory, const Key &key );
+        //! Returns the mesh stored in \a directory for \a key, or an empty ptr
+        static DistortionMeshRef    load( const ci::fs::path &directory, const Key &key );
+        //! Writes \a mesh to \a directory, returns false on failure
+        static bool                 save( const ci::fs::path &directory, const Key &key, const DistortionMeshRef &mesh );
+
+        //! Returns the path of the cache file of \a key in \a directory
+        static ci::fs::path         getPath( const ci::fs::path &directory, const Key &key );
+
+        //! Bump when the layout of the file or the generated data changes
+        static const uint32_t       VERSION = 2;
+    };
+}
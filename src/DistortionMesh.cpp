@@ -0,0 +1,79 @@
+//
+//  DistortionMesh.cpp
+//  OculusSDKTest
+//
+
+#include "DistortionMesh.h"
+
+#include <algorithm>
+
+using namespace ci;
+
+namespace ovr {
+
+    DistortionMeshRef DistortionMesh::create( const Vec4f &distortionParams, float distortionScale, const Vec4f &chromaticAbCorrection, bool useChromaticAbCorrection, float aspectRatio, int columns, int rows )
+    {
+        DistortionMeshRef mesh( new DistortionMesh( columns, rows, aspectRatio ) );
+        mesh->generateEye( EYE_LEFT, distortionParams, distortionScale, chromaticAbCorrection, useChromaticAbCorrection );
+        mesh->generateEye( EYE_RIGHT, distortionParams, distortionScale, chromaticAbCorrection, useChromaticAbCorrection );
+        return mesh;
+    }
+
+    DistortionMeshRef DistortionMesh::create( int columns, int rows, float aspectRatio, const Vertex *vertices, size_t numVertices, const uint32_t *indices, size_t numIndices )
+    {
+        DistortionMeshRef mesh( new DistortionMesh( columns, rows, aspectRatio ) );
+        mesh->mVertices.assign( vertices, vertices + numVertices );
+        mesh->mIndices.assign( indices, indices + numIndices );
+        return mesh;
+    }
+
+    DistortionMesh::DistortionMesh( int columns, int rows, float aspectRatio )
+    : mNumColumns( std::max( columns, 1 ) ),
+    mNumRows( std::max( rows, 1 ) ),
+    mAspectRatio( aspectRatio )
+    {
+        size_t verticesPerEye = ( mNumColumns + 1 ) * ( mNumRows + 1 );
+        mVertices.reserve( verticesPerEye * 2 );
+        mIndices.reserve( mNumColumns * mNumRows * 6 * 2 );
+    }
+
+    void DistortionMesh::generateEye( Eye eye, const Vec4f &distortionParams, float distortionScale, const Vec4f &chromaticAbCorrection, bool useChromaticAbCorrection )
+    {
+        EyeWarpParams params    = EyeWarpParams::calc( eye, mAspectRatio, distortionScale );
+        uint32_t firstVertex    = mVertices.size();
+        float x                 = eye == EYE_LEFT ? 0.0f : 0.5f;
+
+        // Evaluate the warp at each grid point
+        for( int j = 0; j <= mNumRows; j++ ){
+            for( int i = 0; i <= mNumColumns; i++ ){
+                Vertex v;
+                v.position = Vec2f( x + 0.5f * i / (float) mNumColumns, j / (float) mNumRows );
+
+                bool inside;
+                if( useChromaticAbCorrection )
+                    inside = hmdWarpChromatic( params, distortionParams, chromaticAbCorrection, v.position, &v.texCoordRed, &v.texCoordGreen, &v.texCoordBlue );
+                else {
+                    inside = hmdWarp( params, distortionParams, v.position, &v.texCoordGreen );
+                    v.texCoordRed   = v.texCoordGreen;
+                    v.texCoordBlue  = v.texCoordGreen;
+                }
+                v.vignette = inside ? 1.0f : 0.0f;
+                mVertices.push_back( v );
+            }
+        }
+
+        // Triangulate the whole eye, the quads outside of the lenses are still drawn so they come out black
+        uint32_t stride = mNumColumns + 1;
+        for( int j = 0; j < mNumRows; j++ ){
+            for( int i = 0; i < mNumColumns; i++ ){
+                uint32_t i0 = firstVertex + j * stride + i;
+                uint32_t i1 = i0 + 1;
+                uint32_t i2 = i0 + stride;
+                uint32_t i3 = i2 + 1;
+
+                mIndices.push_back( i0 ); mIndices.push_back( i1 ); mIndices.push_back( i3 );
+                mIndices.push_back( i0 ); mIndices.push_back( i3 ); mIndices.push_back( i2 );
+            }
+        }
+    }
+}
@@ -0,0 +1,58 @@
+//
+//  DistortionMesh.h
+//  OculusSDKTest
+//
+//  Tessellated grid holding the precomputed lens warp of both eyes.
+//
+
+#pragma once
+
+#include "Distortion.h"
+
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+namespace ovr {
+
+    typedef std::shared_ptr<class DistortionMesh> DistortionMeshRef;
+
+    class DistortionMesh
+    {
+    public:
+        struct Vertex {
+            //! Position in the normalized [0,1] space of the side by side output
+            ci::Vec2f   position;
+            ci::Vec2f   texCoordRed;
+            ci::Vec2f   texCoordGreen;
+            ci::Vec2f   texCoordBlue;
+            //! 1 when the lookup at the vertex is inside the eye. The shader clamps per fragment, this only describes the grid
+            float       vignette;
+        };
+
+        //! Returns a mesh of \a columns x \a rows quads per eye. \a aspectRatio is the width of one eye divided by its height
+        static DistortionMeshRef create( const ci::Vec4f &distortionParams, float distortionScale, const ci::Vec4f &chromaticAbCorrection, bool useChromaticAbCorrection, float aspectRatio, int columns = 32, int rows = 40 );
+        //! Returns a mesh made of previously generated vertices and indices
+        static DistortionMeshRef create( int columns, int rows, float aspectRatio, const Vertex *vertices, size_t numVertices, const uint32_t *indices, size_t numIndices );
+
+        //! Returns the vertices of both eyes, left eye first
+        const std::vector<Vertex>&      getVertices() const { return mVertices; }
+        //! Returns the triangle list covering both eyes entirely, the fragments looking up outside of the eye are drawn black
+        const std::vector<uint32_t>&    getIndices() const { return mIndices; }
+
+        int     getNumColumns() const { return mNumColumns; }
+        int     getNumRows() const { return mNumRows; }
+        float   getAspectRatio() const { return mAspectRatio; }
+
+    protected:
+        DistortionMesh( int columns, int rows, float aspectRatio );
+
+        void    generateEye( Eye eye, const ci::Vec4f &distortionParams, float distortionScale, const ci::Vec4f &chromaticAbCorrection, bool useChromaticAbCorrection );
+
+        std::vector<Vertex>     mVertices;
+        std::vector<uint32_t>   mIndices;
+        int                     mNumColumns;
+        int                     mNumRows;
+        float                   mAspectRatio;
+    };
+}
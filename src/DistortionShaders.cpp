@@ -0,0 +1,546 @@
+//
+//  DistortionShaders.cpp
+//  OculusSDKTest
+//
+
+#include "DistortionShaders.h"
+#include "MappedFile.h"
+
+#include "cinder/Timer.h"
+
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+using namespace ci;
+
+namespace ovr {
+
+    namespace {
+
+        // Reprojection of a lookup from the latest orientation to the rendered one, see ovr::timewarp.
+        static const char* TimewarpShaderSrc =
+        "#ifdef TIMEWARP\n"
+        "uniform vec2 TimewarpScale;\n"
+        "\n"
+        "vec2 Timewarp(mat3 m, vec2 lensCenter, vec2 tc)\n"
+        "{\n"
+        "   vec3 d = m * vec3((tc - lensCenter) * TimewarpScale, -1.0);\n"
+        "   return lensCenter + d.xy / (max(-d.z, 0.0001) * TimewarpScale);\n"
+        "}\n"
+        "#endif\n"
+        "\n";
+
+        // Lookup in the eye texture. TexCoordScale maps the lookups to the part of the texture the eyes were rendered to.
+        // MULTIRES is defined when the eyes come from a MultiResTarget, the lookups inside the center regions then
+        // read the full resolution center texture.
+        // False when tc is outside of the eye centered on screenCenter, unless CLAMP_EDGE moves it to the edge.
+        static const char* ClampShaderSrc =
+        "bool ClampToEye(vec2 screenCenter, inout vec2 tc)\n"
+        "{\n"
+        "   vec2 clamped = clamp(tc, screenCenter-vec2(0.25,0.5), screenCenter+vec2(0.25,0.5));\n"
+        "#ifdef CLAMP_EDGE\n"
+        "   tc = clamped;\n"
+        "   return true;\n"
+        "#else\n"
+        "   return all(equal(clamped, tc));\n"
+        "#endif\n"
+        "}\n"
+        "\n";
+
+        static const char* EyeTextureShaderSrc =
+        "uniform sampler2D Texture0;\n"
+        "uniform vec2 TexCoordScale;\n"
+        "#ifdef MULTIRES\n"
+        "uniform sampler2D Texture1;\n"
+        "uniform vec4 CenterTexCoordsLeft;\n"
+        "uniform vec4 CenterTexCoordsRight;\n"
+        "\n"
+        "vec4 SampleEye(vec2 tc)\n"
+        "{\n"
+        "   bool left = tc.x < 0.5;\n"
+        "   vec4 rect = left ? CenterTexCoordsLeft : CenterTexCoordsRight;\n"
+        "   if (all(greaterThanEqual(tc, rect.xy)) && all(lessThanEqual(tc, rect.zw)))\n"
+        "       return texture2D(Texture1, vec2(left ? 0.0 : 0.5, 0.0) + (tc - rect.xy) / (rect.zw - rect.xy) * vec2(0.5, 1.0));\n"
+        "   return texture2D(Texture0, tc * TexCoordScale);\n"
+        "}\n"
+        "#else\n"
+        "vec4 SampleEye(vec2 tc)\n"
+        "{\n"
+        "   return texture2D(Texture0, tc * TexCoordScale);\n"
+        "}\n"
+        "#endif\n"
+        "\n";
+
+        // Per-pixel lens distortion, with chromatic aberration correction when CHROMATIC_AB is defined.
+        // Only the WARP_ORDER first coefficients of the polynomial are evaluated.
+        static const char* PostProcessFragShaderSrc =
+        "uniform vec2 LensCenter;\n"
+        "uniform vec2 ScreenCenter;\n"
+        "uniform vec2 Scale;\n"
+        "uniform vec2 ScaleIn;\n"
+        "uniform vec4 HmdWarpParam;\n"
+        "#ifdef CHROMATIC_AB\n"
+        "uniform vec4 ChromAbParam;\n"
+        "#endif\n"
+        "#ifdef TIMEWARP\n"
+        "uniform mat3 TimewarpMatrix;\n"
+        "#endif\n"
+        "\n"
+        "float HmdWarpFactor(float rSq)\n"
+        "{\n"
+        "#if WARP_ORDER == 1\n"
+        "   return HmdWarpParam.x;\n"
+        "#elif WARP_ORDER == 2\n"
+        "   return HmdWarpParam.x + HmdWarpParam.y * rSq;\n"
+        "#elif WARP_ORDER == 3\n"
+        "   return HmdWarpParam.x + rSq * (HmdWarpParam.y + rSq * HmdWarpParam.z);\n"
+        "#else\n"
+        "   return HmdWarpParam.x + rSq * (HmdWarpParam.y + rSq * (HmdWarpParam.z + rSq * HmdWarpParam.w));\n"
+        "#endif\n"
+        "}\n"
+        "\n"
+        "vec2 EyeLookup(vec2 theta1)\n"
+        "{\n"
+        "   vec2 tc = LensCenter + Scale * theta1;\n"
+        "#ifdef TIMEWARP\n"
+        "   tc = Timewarp(TimewarpMatrix, LensCenter, tc);\n"
+        "#endif\n"
+        "   return tc;\n"
+        "}\n"
+        "\n"
+        "void main()\n"
+        "{\n"
+        "   vec2  theta = (gl_TexCoord[0].st - LensCenter) * ScaleIn;\n" // Scales to [-1, 1]
+        "   float rSq = theta.x * theta.x + theta.y * theta.y;\n"
+        "   vec2  theta1 = theta * HmdWarpFactor(rSq);\n"
+        "#ifdef CHROMATIC_AB\n"
+        // Blue is scaled out the furthest, when its lookup is inside the eye the others are too
+        "   vec2 tcBlue = EyeLookup(theta1 * (ChromAbParam.z + ChromAbParam.w * rSq));\n"
+        "   if (!ClampToEye(ScreenCenter, tcBlue))\n"
+        "   {\n"
+        "       gl_FragColor = vec4(0,0,0,1);\n"
+        "       return;\n"
+        "   }\n"
+        "   vec2 tcGreen = EyeLookup(theta1);\n"
+        "   vec2 tcRed = EyeLookup(theta1 * (ChromAbParam.x + ChromAbParam.y * rSq));\n"
+        "#ifdef CLAMP_EDGE\n"
+        "   ClampToEye(ScreenCenter, tcGreen);\n"
+        "   ClampToEye(ScreenCenter, tcRed);\n"
+        "#endif\n"
+        "   gl_FragColor = vec4(SampleEye(tcRed).r, SampleEye(tcGreen).g, SampleEye(tcBlue).b, 1);\n"
+        "#else\n"
+        "   vec2 tc = EyeLookup(theta1);\n"
+        "   if (!ClampToEye(ScreenCenter, tc))\n"
+        "       gl_FragColor = vec4(0,0,0,1);\n"
+        "   else\n"
+        "       gl_FragColor = SampleEye(tc);\n"
+        "#endif\n"
+        "}\n";
+
+        // Distortion mesh shaders, the warp is already baked in the texture coordinates. The vertex red
+        // tells the eye apart for the timewarp, done per vertex as a rotation is smooth enough for the grid,
+        // and for the clamp, done per fragment on the interpolated lookups so the edge of the eye stays sharp.
+        static const char* DistortionMeshVertShaderSrc =
+        "#ifdef TIMEWARP\n"
+        "uniform mat3 TimewarpMatrixLeft;\n"
+        "uniform mat3 TimewarpMatrixRight;\n"
+        "uniform vec2 LensCenterLeft;\n"
+        "uniform vec2 LensCenterRight;\n"
+        "#endif\n"
+        "\n"
+        "void main()\n"
+        "{\n"
+        "   gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+        "   gl_TexCoord[1] = gl_MultiTexCoord1;\n"
+        "   gl_TexCoord[2] = gl_MultiTexCoord2;\n"
+        "#ifdef TIMEWARP\n"
+        "   bool left       = gl_Color.r < 0.5;\n"
+        "   mat3 m          = left ? TimewarpMatrixLeft : TimewarpMatrixRight;\n"
+        "   vec2 lensCenter = left ? LensCenterLeft : LensCenterRight;\n"
+        "   gl_TexCoord[0].st = Timewarp(m, lensCenter, gl_TexCoord[0].st);\n"
+        "   gl_TexCoord[1].st = Timewarp(m, lensCenter, gl_TexCoord[1].st);\n"
+        "   gl_TexCoord[2].st = Timewarp(m, lensCenter, gl_TexCoord[2].st);\n"
+        "#endif\n"
+        "   gl_FrontColor  = gl_Color;\n"
+        "   gl_Position    = ftransform();\n"
+        "}\n";
+
+        static const char* DistortionMeshFragShaderSrc =
+        "void main()\n"
+        "{\n"
+        "   vec2 screenCenter = vec2(gl_Color.r < 0.5 ? 0.25 : 0.75, 0.5);\n"
+        "#ifdef CHROMATIC_AB\n"
+        "   vec2 tcRed   = gl_TexCoord[0].st;\n"
+        "   vec2 tcGreen = gl_TexCoord[1].st;\n"
+        "   vec2 tcBlue  = gl_TexCoord[2].st;\n"
+        "   if (!ClampToEye(screenCenter, tcBlue))\n"
+        "   {\n"
+        "       gl_FragColor = vec4(0,0,0,1);\n"
+        "       return;\n"
+        "   }\n"
+        "#ifdef CLAMP_EDGE\n"
+        "   ClampToEye(screenCenter, tcGreen);\n"
+        "   ClampToEye(screenCenter, tcRed);\n"
+        "#endif\n"
+        "   gl_FragColor = vec4(SampleEye(tcRed).r, SampleEye(tcGreen).g, SampleEye(tcBlue).b, 1);\n"
+        "#else\n"
+        "   vec2 tc = gl_TexCoord[0].st;\n"
+        "   if (!ClampToEye(screenCenter, tc))\n"
+        "       gl_FragColor = vec4(0,0,0,1);\n"
+        "   else\n"
+        "       gl_FragColor = SampleEye(tc);\n"
+        "#endif\n"
+        "}\n";
+
+        struct BinaryHeader {
+            char        magic[4];
+            uint32_t    version;
+            uint64_t    key;
+            uint32_t    format;
+            uint32_t    size;
+            uint64_t    checksum;
+        };
+
+        const char Magic[4] = { 'O', 'V', 'R', 'P' };
+
+        std::string generateDefines( const DistortionShaderVariant &variant )
+        {
+            std::stringstream defines;
+            if( variant.chromaticAbCorrection )
+                defines << "#define CHROMATIC_AB\n";
+            if( variant.timewarp )
+                defines << "#define TIMEWARP\n";
+            if( variant.multiRes )
+                defines << "#define MULTIRES\n";
+            if( variant.clampMode == DistortionShaderVariant::CLAMP_EDGE )
+                defines << "#define CLAMP_EDGE\n";
+            if( ! variant.mesh )
+                defines << "#define WARP_ORDER " << variant.polynomialOrder << "\n";
+            return defines.str();
+        }
+
+        std::string getInfoLog( GLuint handle, bool program )
+        {
+            GLint length = 0;
+            if( program )
+                glGetProgramiv( handle, GL_INFO_LOG_LENGTH, &length );
+            else
+                glGetShaderiv( handle, GL_INFO_LOG_LENGTH, &length );
+            if( length <= 1 )
+                return std::string();
+
+            std::vector<GLchar> log( length );
+            if( program )
+                glGetProgramInfoLog( handle, length, NULL, &log.front() );
+            else
+                glGetShaderInfoLog( handle, length, NULL, &log.front() );
+            return std::string( &log.front() );
+        }
+    }
+
+    ShaderProgram::~ShaderProgram()
+    {
+        glDeleteProgram( mHandle );
+    }
+
+    GLint ShaderProgram::getUniformLocation( const std::string &name ) const
+    {
+        std::map<std::string, GLint>::const_iterator it = mUniformLocations.find( name );
+        if( it != mUniformLocations.end() )
+            return it->second;
+        GLint location = glGetUniformLocation( mHandle, name.c_str() );
+        mUniformLocations[name] = location;
+        return location;
+    }
+
+    DistortionShaderVariant::DistortionShaderVariant()
+    : mesh( false ), chromaticAbCorrection( true ), timewarp( false ), multiRes( false ), clampMode( CLAMP_BLACK ), polynomialOrder( 4 )
+    {
+    }
+
+    DistortionShaderVariant DistortionShaderVariant::normalized() const
+    {
+        DistortionShaderVariant variant = *this;
+        variant.polynomialOrder         = std::min( std::max( polynomialOrder, 1 ), 4 );
+        if( mesh )
+            variant.polynomialOrder = 4;
+        return variant;
+    }
+
+    uint32_t DistortionShaderVariant::getKey() const
+    {
+        DistortionShaderVariant variant = normalized();
+        return ( variant.mesh ? 1 : 0 ) | ( variant.chromaticAbCorrection ? 2 : 0 ) | ( variant.timewarp ? 4 : 0 ) | ( variant.multiRes ? 8 : 0 )
+            | ( (uint32_t) variant.clampMode << 4 ) | ( (uint32_t) variant.polynomialOrder << 8 );
+    }
+
+    std::string DistortionShaderVariant::getName() const
+    {
+        DistortionShaderVariant variant = normalized();
+        std::stringstream name;
+        name << ( variant.mesh ? "mesh" : "per-pixel" );
+        if( variant.chromaticAbCorrection )
+            name << " chromatic";
+        if( variant.timewarp )
+            name << " timewarp";
+        if( variant.multiRes )
+            name << " multires";
+        if( ! variant.mesh )
+            name << " order " << variant.polynomialOrder;
+        name << ( variant.clampMode == CLAMP_EDGE ? " clamp edge" : " clamp black" );
+        return name.str();
+    }
+
+    int DistortionShaderVariant::calcPolynomialOrder( const Vec4f &distortionParams )
+    {
+        if( distortionParams.w != 0.0f )
+            return 4;
+        if( distortionParams.z != 0.0f )
+            return 3;
+        if( distortionParams.y != 0.0f )
+            return 2;
+        return 1;
+    }
+
+    const uint32_t DistortionShaderCache::VERSION;
+
+    DistortionShaderCacheRef DistortionShaderCache::create( const fs::path &binaryDirectory )
+    {
+        return DistortionShaderCacheRef( new DistortionShaderCache( binaryDirectory ) );
+    }
+
+    DistortionShaderCache::DistortionShaderCache( const fs::path &binaryDirectory )
+    : mBinaryDirectory( binaryDirectory ), mBinarySupported( false ), mDriverHash( fnv1a( &VERSION, sizeof( VERSION ) ) )
+    {
+#if defined( GL_ARB_get_program_binary )
+        // Some drivers expose the extension without any format
+        GLint numFormats = 0;
+        if( gl::isExtensionAvailable( "GL_ARB_get_program_binary" ) )
+            glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats );
+        mBinarySupported = numFormats > 0;
+#endif
+        GLenum names[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+        for( int i = 0; i < 3; i++ ){
+            const GLubyte *value = glGetString( names[i] );
+            if( value )
+                mDriverHash = fnv1a( value, std::strlen( reinterpret_cast<const char*>( value ) ), mDriverHash );
+        }
+    }
+
+    ShaderProgramRef DistortionShaderCache::get( const DistortionShaderVariant &variant )
+    {
+        DistortionShaderVariant normalized = variant.normalized();
+        uint32_t key = normalized.getKey();
+        std::map<uint32_t, ShaderProgramRef>::const_iterator it = mPrograms.find( key );
+        if( it != mPrograms.end() )
+            return it->second;
+
+        std::string vertex      = generateVertexShader( normalized );
+        std::string fragment    = generateFragmentShader( normalized );
+
+        Stats stats;
+        stats.name              = normalized.getName();
+        stats.origin            = ORIGIN_SOURCE;
+        stats.compileTime       = stats.linkTime = stats.binaryLoadTime = 0.0;
+        stats.binarySize        = 0;
+
+        // A binary only matches the exact sources and driver it was built from
+        fs::path path;
+        ShaderProgramRef program;
+        if( mBinarySupported && ! mBinaryDirectory.empty() ){
+            uint64_t binaryKey = fnv1a( fragment.data(), fragment.size(), fnv1a( vertex.data(), vertex.size(), mDriverHash ) );
+            std::stringstream name;
+            name << "shader_" << std::hex << binaryKey << ".bin";
+            path    = mBinaryDirectory / name.str();
+            program = loadBinary( path, binaryKey, &stats );
+            if( ! program ){
+                program = build( vertex, fragment, &stats );
+                if( program )
+                    saveBinary( path, binaryKey, program, &stats );
+            }
+        }
+        else
+            program = build( vertex, fragment, &stats );
+
+        if( ! program )
+            return ShaderProgramRef();
+
+        mPrograms[key] = program;
+        mStats.push_back( stats );
+        return program;
+    }
+
+    std::string DistortionShaderCache::generateVertexShader( const DistortionShaderVariant &variant )
+    {
+        DistortionShaderVariant normalized = variant.normalized();
+        if( ! normalized.mesh )
+            return std::string();
+        return generateDefines( normalized ) + TimewarpShaderSrc + DistortionMeshVertShaderSrc;
+    }
+
+    std::string DistortionShaderCache::generateFragmentShader( const DistortionShaderVariant &variant )
+    {
+        DistortionShaderVariant normalized = variant.normalized();
+        if( normalized.mesh )
+            return generateDefines( normalized ) + ClampShaderSrc + EyeTextureShaderSrc + DistortionMeshFragShaderSrc;
+        return generateDefines( normalized ) + TimewarpShaderSrc + ClampShaderSrc + EyeTextureShaderSrc + PostProcessFragShaderSrc;
+    }
+
+    ShaderProgramRef DistortionShaderCache::build( const std::string &vertex, const std::string &fragment, Stats *stats )
+    {
+        const std::string *sources[2]   = { &vertex, &fragment };
+        GLenum types[2]                 = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+        GLuint shaders[2]               = { 0, 0 };
+        GLuint program                  = glCreateProgram();
+
+        // The per-pixel variants only have a fragment shader and use the fixed function vertex stage
+        Timer timer( true );
+        bool compiled = true;
+        for( int i = 0; i < 2 && compiled; i++ ){
+            if( sources[i]->empty() )
+                continue;
+            const GLchar *source    = sources[i]->c_str();
+            shaders[i]              = glCreateShader( types[i] );
+            glShaderSource( shaders[i], 1, &source, NULL );
+            glCompileShader( shaders[i] );
+
+            GLint status = GL_FALSE;
+            glGetShaderiv( shaders[i], GL_COMPILE_STATUS, &status );
+            if( status != GL_TRUE ){
+                std::cout << "ovr::DistortionShaderCache Exception: " << std::endl << getInfoLog( shaders[i], false ) << std::endl;
+                compiled = false;
+            }
+            else
+                glAttachShader( program, shaders[i] );
+        }
+        stats->compileTime = timer.getSeconds() * 1000.0;
+
+        bool linked = false;
+        if( compiled ){
+#if defined( GL_ARB_get_program_binary )
+            if( mBinarySupported )
+                glProgramParameteri( program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+#endif
+            timer.start();
+            glLinkProgram( program );
+            GLint status = GL_FALSE;
+            glGetProgramiv( program, GL_LINK_STATUS, &status );
+            stats->linkTime = timer.getSeconds() * 1000.0;
+            linked          = status == GL_TRUE;
+            if( ! linked )
+                std::cout << "ovr::DistortionShaderCache Exception: " << std::endl << getInfoLog( program, true ) << std::endl;
+        }
+
+        // The linked program keeps the compiled code
+        for( int i = 0; i < 2; i++ ){
+            if( ! shaders[i] )
+                continue;
+            if( compiled )
+                glDetachShader( program, shaders[i] );
+            glDeleteShader( shaders[i] );
+        }
+
+        if( ! linked ){
+            glDeleteProgram( program );
+            return ShaderProgramRef();
+        }
+        return ShaderProgramRef( new ShaderProgram( program ) );
+    }
+
+    ShaderProgramRef DistortionShaderCache::loadBinary( const fs::path &path, uint64_t key, Stats *stats )
+    {
+#if defined( GL_ARB_get_program_binary )
+        Timer timer( true );
+        MappedFileRef file = MappedFile::open( path );
+        if( ! file || file->getSize() < sizeof( BinaryHeader ) )
+            return ShaderProgramRef();
+
+        BinaryHeader header;
+        std::memcpy( &header, file->getData(), sizeof( BinaryHeader ) );
+        if( std::memcmp( header.magic, Magic, 4 ) != 0 || header.version != VERSION || header.key != key )
+            return ShaderProgramRef();
+        if( file->getSize() != sizeof( BinaryHeader ) + header.size )
+            return ShaderProgramRef();
+
+        const uint8_t *payload = file->getData() + sizeof( BinaryHeader );
+        if( fnv1a( payload, header.size ) != header.checksum )
+            return ShaderProgramRef();
+
+        // The driver can still refuse it, after an update for instance, the program is then built from source again
+        GLuint program = glCreateProgram();
+        glProgramBinary( program, header.format, payload, header.size );
+        GLint status = GL_FALSE;
+        glGetProgramiv( program, GL_LINK_STATUS, &status );
+        if( status != GL_TRUE ){
+            glDeleteProgram( program );
+            return ShaderProgramRef();
+        }
+
+        stats->origin           = ORIGIN_BINARY;
+        stats->binaryLoadTime   = timer.getSeconds() * 1000.0;
+        stats->binarySize       = header.size;
+        return ShaderProgramRef( new ShaderProgram( program ) );
+#else
+        return ShaderProgramRef();
+#endif
+    }
+
+    bool DistortionShaderCache::saveBinary( const fs::path &path, uint64_t key, const ShaderProgramRef &program, Stats *stats )
+    {
+#if defined( GL_ARB_get_program_binary )
+        GLint length = 0;
+        glGetProgramiv( program->getHandle(), GL_PROGRAM_BINARY_LENGTH, &length );
+        if( length <= 0 )
+            return false;
+
+        std::vector<uint8_t> binary( length );
+        GLenum format   = 0;
+        GLsizei written = 0;
+        glGetProgramBinary( program->getHandle(), length, &written, &format, &binary.front() );
+        if( written <= 0 )
+            return false;
+
+        BinaryHeader header;
+        std::memset( &header, 0, sizeof( BinaryHeader ) );
+        std::memcpy( header.magic, Magic, 4 );
+        header.version  = VERSION;
+        header.key      = key;
+        header.format   = format;
+        header.size     = written;
+        header.checksum = fnv1a( &binary.front(), written );
+
+        std::vector<FileChunk> chunks;
+        chunks.push_back( FileChunk( &header, sizeof( BinaryHeader ) ) );
+        chunks.push_back( FileChunk( &binary.front(), written ) );
+
+        try {
+            if( ! writeFileAtomically( path, chunks ) )
+                return false;
+        }
+        catch( const std::exception &exc ){
+            std::cout << "ovr::DistortionShaderCache Exception: " << std::endl << exc.what() << std::endl;
+            return false;
+        }
+        stats->binarySize = written;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void DistortionShaderCache::writeReport( std::ostream &out ) const
+    {
+        out << mStats.size() << " distortion shaders built, program binaries " << ( mBinarySupported ? ( mBinaryDirectory.empty() ? "not stored" : "stored in " + mBinaryDirectory.string() ) : "unsupported" ) << std::endl;
+        for( std::vector<Stats>::const_iterator it = mStats.begin(); it != mStats.end(); ++it ){
+            out << "  " << it->name << ": ";
+            if( it->origin == ORIGIN_BINARY )
+                out << "binary loaded in " << it->binaryLoadTime << "ms";
+            else
+                out << "compiled in " << it->compileTime << "ms, linked in " << it->linkTime << "ms";
+            if( it->binarySize )
+                out << ", " << it->binarySize << " bytes binary";
+            out << std::endl;
+        }
+    }
+}
@@ -0,0 +1,137 @@
+//
+//  DistortionShaders.h
+//  OculusSDKTest
+//
+//  Distortion shader variants and their in-memory and program binary caches.
+//
+
+#pragma once
+
+#include "cinder/gl/gl.h"
+#include "cinder/Filesystem.h"
+#include "cinder/Vector.h"
+
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace ovr {
+
+    typedef std::shared_ptr<class ShaderProgram> ShaderProgramRef;
+    typedef std::shared_ptr<class DistortionShaderCache> DistortionShaderCacheRef;
+
+    //! Linked GLSL program, compiled from sources or loaded from a program binary
+    class ShaderProgram
+    {
+    public:
+        ~ShaderProgram();
+
+        void    bind() const { glUseProgram( mHandle ); }
+        void    unbind() const { glUseProgram( 0 ); }
+
+        //! Returns the location of \a name, looked up once
+        GLint   getUniformLocation( const std::string &name ) const;
+        //! Sets \a name on the bound program
+        void    uniform( const std::string &name, int value ) const { glUniform1i( getUniformLocation( name ), value ); }
+        void    uniform( const std::string &name, const ci::Vec2f &value ) const { glUniform2f( getUniformLocation( name ), value.x, value.y ); }
+
+        GLuint  getHandle() const { return mHandle; }
+
+    protected:
+        ShaderProgram( GLuint handle ) : mHandle( handle ) {}
+
+        GLuint                                  mHandle;
+        mutable std::map<std::string, GLint>    mUniformLocations;
+
+        friend class DistortionShaderCache;
+    };
+
+    //! Features a distortion shader is assembled from
+    struct DistortionShaderVariant {
+        //! What the shaders do with the lookups falling outside of the eye
+        enum ClampMode { CLAMP_BLACK, CLAMP_EDGE };
+
+        DistortionShaderVariant();
+
+        //! Precomputed DistortionMesh instead of the per-pixel warp
+        bool        mesh;
+        bool        chromaticAbCorrection;
+        bool        timewarp;
+        //! Eyes coming from a MultiResTarget
+        bool        multiRes;
+        ClampMode   clampMode;
+        //! Number of coefficients of the warp polynomial evaluated, 1 to 4
+        int         polynomialOrder;
+
+        //! Returns the variant actually compiled, the mesh bakes the warp so its polynomial order doesn't matter there
+        DistortionShaderVariant normalized() const;
+        //! Returns a key unique to the normalized variant
+        uint32_t    getKey() const;
+        //! Returns a readable description, for reports
+        std::string getName() const;
+
+        //! Returns the lowest order evaluating every non zero coefficient of \a distortionParams
+        static int  calcPolynomialOrder( const ci::Vec4f &distortionParams );
+    };
+
+    //! Keeps the programs of the variants used so far, so switching back to one is free, and stores their
+    //! program binaries on disk when the driver supports GL_ARB_get_program_binary so later runs skip the compile
+    class DistortionShaderCache
+    {
+    public:
+        //! How a program was obtained
+        enum Origin { ORIGIN_SOURCE, ORIGIN_BINARY };
+        //! Cost of building one program, in milliseconds
+        struct Stats {
+            std::string name;
+            Origin      origin;
+            double      compileTime;
+            double      linkTime;
+            double      binaryLoadTime;
+            size_t      binarySize;
+        };
+
+        //! Binaries are stored in \a binaryDirectory, an empty path keeps the cache in memory only
+        static DistortionShaderCacheRef create( const ci::fs::path &binaryDirectory = ci::fs::path() );
+
+        //! Returns the program of \a variant from memory, from its binary or built from source, or an empty ptr if it doesn't compile
+        ShaderProgramRef    get( const DistortionShaderVariant &variant );
+        //! Drops the programs kept in memory, the binaries stay on disk
+        void                clear() { mPrograms.clear(); }
+        size_t              getNumPrograms() const { return mPrograms.size(); }
+
+        void                    setBinaryDirectory( const ci::fs::path &directory ) { mBinaryDirectory = directory; }
+        const ci::fs::path&     getBinaryDirectory() const { return mBinaryDirectory; }
+        //! Returns whether the driver can return program binaries
+        bool                    isBinarySupported() const { return mBinarySupported; }
+
+        //! Returns the cost of every program built so far, in order
+        const std::vector<Stats>&   getStats() const { return mStats; }
+        //! Writes one line per program built with its compile, link and binary load times
+        void                        writeReport( std::ostream &out ) const;
+
+        //! Returns the vertex shader of \a variant, empty for the per-pixel variants which use the fixed function one
+        static std::string  generateVertexShader( const DistortionShaderVariant &variant );
+        static std::string  generateFragmentShader( const DistortionShaderVariant &variant );
+
+        //! Bump when the layout of the binary files changes, the shader sources are part of the key already
+        static const uint32_t VERSION = 1;
+
+    protected:
+        DistortionShaderCache( const ci::fs::path &binaryDirectory );
+
+        ShaderProgramRef    build( const std::string &vertex, const std::string &fragment, Stats *stats );
+        ShaderProgramRef    loadBinary( const ci::fs::path &path, uint64_t key, Stats *stats );
+        bool                saveBinary( const ci::fs::path &path, uint64_t key, const ShaderProgramRef &program, Stats *stats );
+
+        std::map<uint32_t, ShaderProgramRef>    mPrograms;
+        std::vector<Stats>                      mStats;
+        ci::fs::path                            mBinaryDirectory;
+        bool                                    mBinarySupported;
+        //! Hash of the GL vendor, renderer and version, binaries from another driver are never loaded
+        uint64_t                                mDriverHash;
+    };
+}
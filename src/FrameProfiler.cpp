@@ -0,0 +1,320 @@
+//
+//  FrameProfiler.cpp
+//  OculusSDKTest
+//
+
+#include "FrameProfiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <map>
+
+using namespace ci;
+
+namespace ovr {
+
+    namespace {
+        // Frames waiting for their GPU results before new frames stop issuing queries
+        const size_t    MaxPendingFrames    = 8;
+        const size_t    NoSample            = (size_t) -1;
+
+        double percentile( const std::vector<double> &sorted, double p )
+        {
+            // Nearest rank
+            size_t rank = (size_t) ceil( p * sorted.size() );
+            return sorted[std::min( std::max( rank, (size_t) 1 ), sorted.size() ) - 1];
+        }
+
+        std::string escapeJson( const std::string &str )
+        {
+            std::string escaped;
+            for( std::string::const_iterator it = str.begin(); it != str.end(); ++it ){
+                if( *it == '"' || *it == '\\' )
+                    escaped += '\\';
+                escaped += *it;
+            }
+            return escaped;
+        }
+    }
+
+    FrameProfilerRef FrameProfiler::create( size_t numFrames )
+    {
+        return FrameProfilerRef( new FrameProfiler( std::max<size_t>( numFrames, 1 ) ) );
+    }
+
+    FrameProfiler::FrameProfiler( size_t numFrames )
+    : mGpuTimed( false ), mGpuBase( 0 ), mCpuBase( 0.0 ), mInFrame( false ), mDropGpu( false ), mPreviousEnd( -1.0 ),
+    mFrameIndex( 0 ), mNumFrames( numFrames ), mNumDropped( 0 )
+    {
+        mTimer.start();
+
+        // Pair a GPU timestamp with the CPU clock once to put both on the same timeline
+#if defined( GL_TIMESTAMP )
+        mGpuTimed = gl::isExtensionAvailable( "GL_ARB_timer_query" );
+        if( mGpuTimed ){
+            GLint64 timestamp = 0;
+            glGetInteger64v( GL_TIMESTAMP, &timestamp );
+            mGpuBase = (uint64_t) timestamp;
+            mCpuBase = now();
+        }
+#endif
+    }
+    FrameProfiler::~FrameProfiler()
+    {
+        if( ! mAllQueries.empty() )
+            glDeleteQueries( (GLsizei) mAllQueries.size(), &mAllQueries.front() );
+    }
+
+    void FrameProfiler::beginFrame()
+    {
+        if( mInFrame )
+            endFrame();
+
+        mCurrent.index      = mFrameIndex++;
+        mCurrent.cpuBegin   = now();
+        mCurrent.cpuEnd     = mCurrent.cpuBegin;
+        mCurrent.lastQuery  = 0;
+        mCurrent.samples.clear();
+        mInFrame            = true;
+
+        mDropGpu = mGpuTimed && mPending.size() >= MaxPendingFrames;
+        if( mDropGpu )
+            mNumDropped++;
+
+        if( mPreviousEnd >= 0.0 ){
+            Sample swap;
+            swap.stage      = getStage( "swap" );
+            swap.cpuBegin   = mPreviousEnd;
+            swap.cpuEnd     = mCurrent.cpuBegin;
+            swap.gpuBegin   = swap.gpuEnd = -1.0;
+            swap.gpu        = false;
+            mCurrent.samples.push_back( swap );
+        }
+    }
+
+    void FrameProfiler::endFrame()
+    {
+        if( ! mInFrame )
+            return;
+        while( ! mOpenSamples.empty() )
+            end();
+
+        mCurrent.cpuEnd = now();
+        mPreviousEnd    = mCurrent.cpuEnd;
+        mInFrame        = false;
+        mPending.push_back( mCurrent );
+        collect();
+    }
+
+    void FrameProfiler::begin( const std::string &stage, bool gpu )
+    {
+        if( ! mInFrame ){
+            mOpenSamples.push_back( NoSample );
+            return;
+        }
+
+        Sample sample;
+        sample.stage    = getStage( stage );
+        sample.gpuBegin = sample.gpuEnd = -1.0;
+        sample.gpu      = gpu && mGpuTimed && ! mDropGpu;
+#if defined( GL_TIMESTAMP )
+        if( sample.gpu ){
+            sample.queries[0] = mCurrent.lastQuery = acquireQuery();
+            glQueryCounter( sample.queries[0], GL_TIMESTAMP );
+        }
+#endif
+        sample.cpuBegin = sample.cpuEnd = now();
+        mOpenSamples.push_back( mCurrent.samples.size() );
+        mCurrent.samples.push_back( sample );
+    }
+
+    void FrameProfiler::end()
+    {
+        if( mOpenSamples.empty() )
+            return;
+        size_t index = mOpenSamples.back();
+        mOpenSamples.pop_back();
+        if( index == NoSample )
+            return;
+
+        Sample &sample  = mCurrent.samples[index];
+        sample.cpuEnd   = now();
+#if defined( GL_TIMESTAMP )
+        if( sample.gpu ){
+            sample.queries[1] = mCurrent.lastQuery = acquireQuery();
+            glQueryCounter( sample.queries[1], GL_TIMESTAMP );
+        }
+#endif
+    }
+
+    uint32_t FrameProfiler::getStage( const std::string &name )
+    {
+        std::vector<std::string>::iterator it = std::find( mStageNames.begin(), mStageNames.end(), name );
+        if( it != mStageNames.end() )
+            return (uint32_t) ( it - mStageNames.begin() );
+        mStageNames.push_back( name );
+        return (uint32_t) ( mStageNames.size() - 1 );
+    }
+
+    GLuint FrameProfiler::acquireQuery()
+    {
+        if( ! mFreeQueries.empty() ){
+            GLuint query = mFreeQueries.back();
+            mFreeQueries.pop_back();
+            return query;
+        }
+        GLuint query = 0;
+        glGenQueries( 1, &query );
+        mAllQueries.push_back( query );
+        return query;
+    }
+
+    void FrameProfiler::collect()
+    {
+        while( ! mPending.empty() ){
+            Frame &frame = mPending.front();
+#if defined( GL_TIMESTAMP )
+            // Timestamps are written in order, once the last one is available all of them are
+            if( frame.lastQuery ){
+                GLint available = 0;
+                glGetQueryObjectiv( frame.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available );
+                if( ! available )
+                    break;
+            }
+            for( std::vector<Sample>::iterator it = frame.samples.begin(); it != frame.samples.end(); ++it ){
+                if( ! it->gpu )
+                    continue;
+                GLuint64 timestamps[2] = { 0, 0 };
+                for( int i = 0; i < 2; i++ ){
+                    glGetQueryObjectui64v( it->queries[i], GL_QUERY_RESULT, &timestamps[i] );
+                    mFreeQueries.push_back( it->queries[i] );
+                }
+                it->gpuBegin    = mCpuBase + (double) (int64_t) ( timestamps[0] - mGpuBase ) * 1e-6;
+                it->gpuEnd      = mCpuBase + (double) (int64_t) ( timestamps[1] - mGpuBase ) * 1e-6;
+            }
+#endif
+            mFrames.push_back( frame );
+            mPending.pop_front();
+            if( mFrames.size() > mNumFrames )
+                mFrames.pop_front();
+        }
+    }
+
+    std::vector<double> FrameProfiler::getDurations( const std::string &stage, bool gpu ) const
+    {
+        std::vector<double> durations;
+        if( stage == "frame" ){
+            for( std::deque<Frame>::const_iterator frame = mFrames.begin(); frame != mFrames.end() && ! gpu; ++frame )
+                durations.push_back( frame->cpuEnd - frame->cpuBegin );
+            return durations;
+        }
+
+        std::vector<std::string>::const_iterator name = std::find( mStageNames.begin(), mStageNames.end(), stage );
+        if( name == mStageNames.end() )
+            return durations;
+        uint32_t index = (uint32_t) ( name - mStageNames.begin() );
+
+        for( std::deque<Frame>::const_iterator frame = mFrames.begin(); frame != mFrames.end(); ++frame ){
+            double total    = 0.0;
+            bool found      = false;
+            for( std::vector<Sample>::const_iterator it = frame->samples.begin(); it != frame->samples.end(); ++it ){
+                if( it->stage != index || ( gpu && ! it->gpu ) )
+                    continue;
+                total += gpu ? it->gpuEnd - it->gpuBegin : it->cpuEnd - it->cpuBegin;
+                found = true;
+            }
+            if( found )
+                durations.push_back( total );
+        }
+        return durations;
+    }
+
+    FrameProfiler::Stats FrameProfiler::calcStats( std::vector<double> durations )
+    {
+        Stats stats;
+        if( durations.empty() )
+            return stats;
+
+        std::sort( durations.begin(), durations.end() );
+        double sum = 0.0;
+        for( std::vector<double>::const_iterator it = durations.begin(); it != durations.end(); ++it )
+            sum += *it;
+        stats.count = durations.size();
+        stats.mean  = sum / durations.size();
+        stats.p50   = percentile( durations, 0.5 );
+        stats.p99   = percentile( durations, 0.99 );
+        stats.max   = durations.back();
+        return stats;
+    }
+
+    FrameProfiler::Stats FrameProfiler::getCpuStats( const std::string &stage ) const
+    {
+        return calcStats( getDurations( stage, false ) );
+    }
+    FrameProfiler::Stats FrameProfiler::getGpuStats( const std::string &stage ) const
+    {
+        return calcStats( getDurations( stage, true ) );
+    }
+
+    bool FrameProfiler::writeStatsCsv( const fs::path &path ) const
+    {
+        std::ofstream out( path.string().c_str(), std::ios::trunc );
+        out << std::fixed << std::setprecision( 3 );
+        out << "stage,clock,count,mean_ms,p50_ms,p99_ms,max_ms" << std::endl;
+
+        std::vector<std::string> stages( 1, "frame" );
+        stages.insert( stages.end(), mStageNames.begin(), mStageNames.end() );
+        for( std::vector<std::string>::const_iterator it = stages.begin(); it != stages.end(); ++it ){
+            for( int gpu = 0; gpu < 2; gpu++ ){
+                Stats stats = gpu ? getGpuStats( *it ) : getCpuStats( *it );
+                if( stats.count )
+                    out << *it << "," << ( gpu ? "gpu" : "cpu" ) << "," << stats.count << "," << stats.mean << "," << stats.p50 << "," << stats.p99 << "," << stats.max << std::endl;
+            }
+        }
+        return (bool) out;
+    }
+
+    bool FrameProfiler::writeHistogramCsv( const fs::path &path, double binWidth ) const
+    {
+        std::ofstream out( path.string().c_str(), std::ios::trunc );
+        out << std::fixed << std::setprecision( 3 );
+        out << "stage,clock,bin_ms,count" << std::endl;
+
+        std::vector<std::string> stages( 1, "frame" );
+        stages.insert( stages.end(), mStageNames.begin(), mStageNames.end() );
+        for( std::vector<std::string>::const_iterator it = stages.begin(); it != stages.end(); ++it ){
+            for( int gpu = 0; gpu < 2; gpu++ ){
+                std::vector<double> durations = getDurations( *it, gpu != 0 );
+                std::map<int64_t, size_t> bins;
+                for( std::vector<double>::const_iterator d = durations.begin(); d != durations.end(); ++d )
+                    bins[(int64_t) floor( std::max( *d, 0.0 ) / binWidth )]++;
+                for( std::map<int64_t, size_t>::const_iterator bin = bins.begin(); bin != bins.end(); ++bin )
+                    out << *it << "," << ( gpu ? "gpu" : "cpu" ) << "," << bin->first * binWidth << "," << bin->second << std::endl;
+            }
+        }
+        return (bool) out;
+    }
+
+    bool FrameProfiler::writeChromeTrace( const fs::path &path ) const
+    {
+        // Complete events in microseconds, the CPU on the first thread and the GPU on the second
+        std::ofstream out( path.string().c_str(), std::ios::trunc );
+        out << std::fixed << std::setprecision( 3 );
+        out << "{\"traceEvents\":[" << std::endl;
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"CPU\"}}," << std::endl;
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,\"args\":{\"name\":\"GPU\"}}";
+        for( std::deque<Frame>::const_iterator frame = mFrames.begin(); frame != mFrames.end(); ++frame ){
+            out << "," << std::endl << "{\"name\":\"frame\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":" << frame->cpuBegin * 1000.0 << ",\"dur\":" << ( frame->cpuEnd - frame->cpuBegin ) * 1000.0 << ",\"args\":{\"index\":" << frame->index << "}}";
+            for( std::vector<Sample>::const_iterator it = frame->samples.begin(); it != frame->samples.end(); ++it ){
+                std::string name = escapeJson( mStageNames[it->stage] );
+                out << "," << std::endl << "{\"name\":\"" << name << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":" << it->cpuBegin * 1000.0 << ",\"dur\":" << ( it->cpuEnd - it->cpuBegin ) * 1000.0 << "}";
+                if( it->gpu )
+                    out << "," << std::endl << "{\"name\":\"" << name << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":0,\"tid\":1,\"ts\":" << it->gpuBegin * 1000.0 << ",\"dur\":" << ( it->gpuEnd - it->gpuBegin ) * 1000.0 << "}";
+            }
+        }
+        out << std::endl << "],\"displayTimeUnit\":\"ms\"}" << std::endl;
+        return (bool) out;
+    }
+}
@@ -0,0 +1,129 @@
+//
+//  FrameProfiler.h
+//  OculusSDKTest
+//
+//  CPU and GPU timings of the stages of each frame.
+//
+
+#pragma once
+
+#include "cinder/gl/gl.h"
+#include "cinder/Filesystem.h"
+#include "cinder/Timer.h"
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace ovr {
+
+    typedef std::shared_ptr<class FrameProfiler> FrameProfilerRef;
+
+    //! Records named stages of each frame on the CPU clock and, with GL_ARB_timer_query, as GPU
+    //! timestamps. The GPU results are collected once available, frames wait in a queue until
+    //! then, so profiling never stalls the pipeline. Stages can nest and repeat within a frame,
+    //! the stats use the total time of each stage per frame.
+    class FrameProfiler
+    {
+    public:
+        //! Milliseconds over the recorded frames
+        struct Stats {
+            Stats() : count( 0 ), mean( 0 ), p50( 0 ), p99( 0 ), max( 0 ) {}
+            size_t  count;
+            double  mean, p50, p99, max;
+        };
+
+        //! Times the lifetime of the scope as \a stage
+        class Scope {
+        public:
+            Scope( const FrameProfilerRef &profiler, const std::string &stage, bool gpu = true ) : mProfiler( profiler ) { mProfiler->begin( stage, gpu ); }
+            ~Scope() { mProfiler->end(); }
+        private:
+            FrameProfilerRef mProfiler;
+        };
+
+        //! Keeps the last \a numFrames frames
+        static FrameProfilerRef create( size_t numFrames = 1000 );
+        ~FrameProfiler();
+
+        //! Starts a frame. The time since the end of the previous one is recorded as its "swap" stage
+        void    beginFrame();
+        void    endFrame();
+        //! Starts timing \a stage, on the GPU too if \a gpu is true and timer queries are available
+        void    begin( const std::string &stage, bool gpu = true );
+        //! Ends the last stage started
+        void    end();
+
+        //! Returns whether GPU timestamps are recorded
+        bool    isGpuTimed() const { return mGpuTimed; }
+        //! Returns the names of the stages seen so far, in order of appearance
+        const std::vector<std::string>& getStageNames() const { return mStageNames; }
+        //! Returns the CPU stats of \a stage, or of the whole frames for "frame"
+        Stats   getCpuStats( const std::string &stage ) const;
+        Stats   getGpuStats( const std::string &stage ) const;
+        //! Returns the number of frames collected, frames still waiting for their GPU results aren't counted
+        size_t  getNumFrames() const { return mFrames.size(); }
+        //! Returns the number of frames whose GPU timings were dropped because too many frames were waiting
+        size_t  getNumDropped() const { return mNumDropped; }
+
+        //! Writes the stats of every stage on both clocks, returns false if the file can't be written
+        bool    writeStatsCsv( const ci::fs::path &path ) const;
+        //! Writes the histograms of every stage on both clocks with \a binWidth milliseconds bins
+        bool    writeHistogramCsv( const ci::fs::path &path, double binWidth = 0.5 ) const;
+        //! Writes the recorded frames in the Chrome trace event format, for chrome://tracing or Perfetto
+        bool    writeChromeTrace( const ci::fs::path &path ) const;
+
+    protected:
+        FrameProfiler( size_t numFrames );
+
+        //! Timestamps in milliseconds, the GPU ones are moved to the CPU clock
+        struct Sample {
+            uint32_t    stage;
+            double      cpuBegin, cpuEnd;
+            double      gpuBegin, gpuEnd;
+            GLuint      queries[2];
+            bool        gpu;
+        };
+        struct Frame {
+            uint64_t            index;
+            double              cpuBegin, cpuEnd;
+            std::vector<Sample> samples;
+            //! Last query issued, its result comes after all the others
+            GLuint              lastQuery;
+        };
+
+        double      now() const { return mTimer.getSeconds() * 1000.0; }
+        uint32_t    getStage( const std::string &name );
+        GLuint      acquireQuery();
+        //! Moves the frames whose GPU results are available to mFrames
+        void        collect();
+        //! Returns the total time of each frame spent in \a stage, skipping the frames without it
+        std::vector<double> getDurations( const std::string &stage, bool gpu ) const;
+
+        static Stats    calcStats( std::vector<double> durations );
+
+        ci::Timer               mTimer;
+        bool                    mGpuTimed;
+        //! GPU timestamp matching the CPU time mCpuBase, in nanoseconds
+        uint64_t                mGpuBase;
+        double                  mCpuBase;
+
+        std::vector<std::string> mStageNames;
+        Frame                   mCurrent;
+        std::vector<size_t>     mOpenSamples;
+        bool                    mInFrame;
+        //! Set for the frames started while too many frames were waiting for their GPU results
+        bool                    mDropGpu;
+        double                  mPreviousEnd;
+        uint64_t                mFrameIndex;
+
+        std::deque<Frame>       mPending;
+        std::deque<Frame>       mFrames;
+        size_t                  mNumFrames;
+        size_t                  mNumDropped;
+        std::vector<GLuint>     mFreeQueries;
+        std::vector<GLuint>     mAllQueries;
+    };
+}
@@ -0,0 +1,227 @@
+//
+//  FusionEngine.cpp
+//  OculusSDKTest
+//
+
+#include "FusionEngine.h"
+#include "Pose.h"
+#include "SimdLanes.h"
+
+#include "cinder/CinderMath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace ci;
+
+namespace ovr {
+
+    namespace {
+
+        const float Gravity = 9.81f;
+
+        // Up vector of the world seen from a head with orientation \a q, the gravity the accelerometer of a still head reads
+        inline Vec3f headUp( const Quatf &q )
+        {
+            return Vec3f( 2.0f * ( q.v.x * q.v.y + q.w * q.v.z ), 1.0f - 2.0f * ( q.v.x * q.v.x + q.v.z * q.v.z ), 2.0f * ( q.v.y * q.v.z - q.w * q.v.x ) );
+        }
+    }
+
+    OvrFusionEngineRef OvrFusionEngine::create()
+    {
+        return OvrFusionEngineRef( new OvrFusionEngine() );
+    }
+    OvrFusionEngine::OvrFusionEngine()
+    : mSensorFusion( std::make_shared<OVR::SensorFusion>() )
+    {
+    }
+    void OvrFusionEngine::process( const SensorSample *samples, size_t count )
+    {
+        for( size_t i = 0; i < count; i++ )
+            mSensorFusion->OnMessage( toBodyFrame( samples[i] ) );
+    }
+    void OvrFusionEngine::reset()
+    {
+        mSensorFusion->Reset();
+    }
+    Quatf OvrFusionEngine::getOrientation() const
+    {
+        OVR::Quatf q = mSensorFusion->GetOrientation();
+        return Quatf( q.w, q.x, q.y, q.z );
+    }
+    Vec3f OvrFusionEngine::getAngularVelocity() const
+    {
+        OVR::Vector3f v = mSensorFusion->GetAngularVelocity();
+        return Vec3f( v.x, v.y, v.z );
+    }
+
+    MadgwickFusion::Options::Options()
+    : beta( 0.05f ),
+    accelerationTolerance( 0.1f )
+    {
+    }
+
+    MadgwickFusionRef MadgwickFusion::create( const Options &options )
+    {
+        return MadgwickFusionRef( new MadgwickFusion( options ) );
+    }
+
+    MadgwickFusion::MadgwickFusion( const Options &options )
+    : mOptions( options )
+    {
+        reset();
+    }
+
+    void MadgwickFusion::reset()
+    {
+        mW                  = 1.0f;
+        mX = mY = mZ        = 0.0f;
+        mAngularVelocity    = Vec3f::zero();
+    }
+
+    size_t MadgwickFusion::getNumLanes()
+    {
+        return OVR_SIMD_LANES;
+    }
+
+    void MadgwickFusion::process( const SensorSample *samples, size_t count )
+    {
+        // The update of each sample depends on the previous one, only the normalization and the rejection of
+        // the accelerations run across samples. Chunks keep the prepared samples on the stack
+        const size_t chunkSize = 64;
+        float ax[chunkSize], ay[chunkSize], az[chunkSize];
+        float minNorm = Gravity * ( 1.0f - mOptions.accelerationTolerance );
+        float maxNorm = Gravity * ( 1.0f + mOptions.accelerationTolerance );
+
+        for( size_t first = 0; first < count; first += chunkSize ){
+            size_t chunk = std::min( chunkSize, count - first );
+            for( size_t i = 0; i < chunk; i++ ){
+                const Vec3f &a = samples[first + i].acceleration;
+                ax[i] = a.x;
+                ay[i] = a.y;
+                az[i] = a.z;
+            }
+
+            size_t i = 0;
+#if OVR_SIMD_LANES > 1
+            const size_t lanes  = OVR_SIMD_LANES;
+            lane_t center       = set1( ( minNorm + maxNorm ) * 0.5f );
+            lane_t halfRange    = set1( ( maxNorm - minNorm ) * 0.5f );
+            for( ; i + lanes <= chunk; i += lanes ){
+                lane_t x    = load( ax + i );
+                lane_t y    = load( ay + i );
+                lane_t z    = load( az + i );
+                lane_t norm = sqrt( add( add( mul( x, x ), mul( y, y ) ), mul( z, z ) ) );
+                // Zeroed when moving, a zero norm is rejected too so the division never matters
+                lane_t keep = cmple( abs( sub( norm, center ) ), halfRange );
+                store( ax + i, andMask( div( x, norm ), keep ) );
+                store( ay + i, andMask( div( y, norm ), keep ) );
+                store( az + i, andMask( div( z, norm ), keep ) );
+            }
+#endif
+            for( ; i < chunk; i++ ){
+                float norm  = sqrtf( ax[i] * ax[i] + ay[i] * ay[i] + az[i] * az[i] );
+                bool keep   = norm >= minNorm && norm <= maxNorm;
+                ax[i]       = keep ? ax[i] / norm : 0.0f;
+                ay[i]       = keep ? ay[i] / norm : 0.0f;
+                az[i]       = keep ? az[i] / norm : 0.0f;
+            }
+
+            for( size_t i = 0; i < chunk; i++ ){
+                const SensorSample &sample = samples[first + i];
+                update( sample.rotationRate.x, sample.rotationRate.y, sample.rotationRate.z, ax[i], ay[i], az[i], sample.timeDelta );
+            }
+        }
+        if( count )
+            mAngularVelocity = samples[count - 1].rotationRate;
+    }
+
+    void MadgwickFusion::update( float gx, float gy, float gz, float ax, float ay, float az, float dt )
+    {
+        float w = mW, x = mX, y = mY, z = mZ;
+
+        // Rate of change from the gyroscope, 0.5 * q * ( 0, g ) with g in the head frame
+        float dw = 0.5f * ( -x * gx - y * gy - z * gz );
+        float dx = 0.5f * ( w * gx + y * gz - z * gy );
+        float dy = 0.5f * ( w * gy - x * gz + z * gx );
+        float dz = 0.5f * ( w * gz + x * gy - y * gx );
+
+        // Gradient of the distance between the world up seen from the head and the measured acceleration, Y up
+        if( ax != 0.0f || ay != 0.0f || az != 0.0f ){
+            float f1 = 2.0f * ( x * y + w * z ) - ax;
+            float f2 = 1.0f - 2.0f * ( x * x + z * z ) - ay;
+            float f3 = 2.0f * ( y * z - w * x ) - az;
+            float sw = 2.0f * ( z * f1 - x * f3 );
+            float sx = 2.0f * ( y * f1 - w * f3 ) - 4.0f * x * f2;
+            float sy = 2.0f * ( x * f1 + z * f3 );
+            float sz = 2.0f * ( w * f1 + y * f3 ) - 4.0f * z * f2;
+            float length = sqrtf( sw * sw + sx * sx + sy * sy + sz * sz );
+            if( length > 0.0f ){
+                float step = mOptions.beta / length;
+                dw -= sw * step;
+                dx -= sx * step;
+                dy -= sy * step;
+                dz -= sz * step;
+            }
+        }
+
+        w += dw * dt;
+        x += dx * dt;
+        y += dy * dt;
+        z += dz * dt;
+        float invLength = 1.0f / sqrtf( w * w + x * x + y * y + z * z );
+        mW = w * invLength;
+        mX = x * invLength;
+        mY = y * invLength;
+        mZ = z * invLength;
+    }
+
+    float tiltBetween( const Quatf &a, const Quatf &b )
+    {
+        float d = headUp( a ).dot( headUp( b ) );
+        return acosf( std::min( std::max( d, -1.0f ), 1.0f ) );
+    }
+
+    FusionComparison compareFusion( const SensorSourceRef &source, const FusionEngineRef &engine, const FusionEngineRef &reference, size_t batchSize, double settleTime, double maxTime )
+    {
+        FusionComparison comparison;
+        source->rewind();
+        engine->reset();
+        reference->reset();
+
+        std::vector<SensorSample> batch( std::max<size_t>( batchSize, 1 ) );
+        double tiltSum = 0.0, errorSum = 0.0;
+        size_t numComparisons = 0;
+        bool done = false;
+        while( ! done ){
+            size_t count = 0;
+            while( count < batch.size() && source->nextSample( &batch[count] ) )
+                count++;
+            if( ! count )
+                break;
+
+            engine->process( batch.data(), count );
+            reference->process( batch.data(), count );
+            done = batch[count - 1].time >= maxTime;
+            if( batch[count - 1].time < settleTime )
+                continue;
+
+            float tilt  = toDegrees( tiltBetween( engine->getOrientation(), reference->getOrientation() ) );
+            float error = toDegrees( angleBetween( engine->getOrientation(), reference->getOrientation() ) );
+            tiltSum    += tilt;
+            errorSum   += error;
+            comparison.maxTiltError = std::max( comparison.maxTiltError, tilt );
+            comparison.maxError     = std::max( comparison.maxError, error );
+            comparison.numSamples  += count;
+            numComparisons++;
+        }
+
+        if( numComparisons ){
+            comparison.meanTiltError    = (float) ( tiltSum / numComparisons );
+            comparison.meanError        = (float) ( errorSum / numComparisons );
+        }
+        source->rewind();
+        return comparison;
+    }
+}
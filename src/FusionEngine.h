@@ -0,0 +1,125 @@
+//
+//  FusionEngine.h
+//  OculusSDKTest
+//
+//  Sensor fusion turning the raw IMU samples into the head orientation.
+//
+
+#pragma once
+
+#include "cinder/Quaternion.h"
+#include "cinder/Vector.h"
+
+#include "OvrSystem.h"
+#include "SensorStream.h"
+
+#include <memory>
+#include <string>
+
+namespace ovr {
+
+    typedef std::shared_ptr<class FusionEngine> FusionEngineRef;
+
+    //! Integrates raw IMU samples into an orientation. A Device runs OVR::SensorFusion unless another engine is set
+    //! with Device::setFusionEngine(). Engines aren't thread safe, the Device serializes the calls
+    class FusionEngine
+    {
+    public:
+        virtual ~FusionEngine() {}
+
+        //! Integrates \a count \a samples, oldest first
+        virtual void        process( const SensorSample *samples, size_t count ) = 0;
+        //! Goes back to the identity orientation
+        virtual void        reset() = 0;
+
+        //! Returns the head to world rotation, Y up
+        virtual ci::Quatf   getOrientation() const = 0;
+        //! Returns the angular velocity of the last sample in radians per second, head frame
+        virtual ci::Vec3f   getAngularVelocity() const = 0;
+        virtual std::string getName() const = 0;
+    };
+
+    typedef std::shared_ptr<class OvrFusionEngine> OvrFusionEngineRef;
+
+    //! OVR::SensorFusion behind the FusionEngine interface, the reference the other engines are compared to
+    class OvrFusionEngine : public FusionEngine
+    {
+    public:
+        static OvrFusionEngineRef create();
+
+        virtual void        process( const SensorSample *samples, size_t count );
+        virtual void        reset();
+
+        virtual ci::Quatf   getOrientation() const;
+        virtual ci::Vec3f   getAngularVelocity() const;
+        virtual std::string getName() const { return "OVR::SensorFusion"; }
+
+    protected:
+        OvrFusionEngine();
+
+        //! Declared first, OVR::SensorFusion needs OVR::System even outside of a Device
+        OvrSystemGuard                      mSystemGuard;
+        std::shared_ptr<OVR::SensorFusion>  mSensorFusion;
+    };
+
+    typedef std::shared_ptr<class MadgwickFusion> MadgwickFusionRef;
+
+    //! Madgwick's gradient descent filter, gyroscope and accelerometer only. The gyroscope is integrated and a step
+    //! of \a beta along the gradient pulls the estimated gravity towards the accelerometer, which corrects pitch and
+    //! roll. The cost of a sample is fixed, batches are prepared several samples per instruction before the update
+    class MadgwickFusion : public FusionEngine
+    {
+    public:
+        struct Options {
+            Options();
+
+            //! Gain of the accelerometer correction in radians per second, sqrt( 3 / 4 ) times the gyroscope error
+            float   beta;
+            //! Samples whose acceleration is further than this fraction from 1g are moving and only integrate the gyroscope
+            float   accelerationTolerance;
+        };
+
+        static MadgwickFusionRef create( const Options &options = Options() );
+
+        virtual void        process( const SensorSample *samples, size_t count );
+        virtual void        reset();
+
+        virtual ci::Quatf   getOrientation() const { return ci::Quatf( mW, mX, mY, mZ ); }
+        virtual ci::Vec3f   getAngularVelocity() const { return mAngularVelocity; }
+        virtual std::string getName() const { return "Madgwick"; }
+
+        const Options&      getOptions() const { return mOptions; }
+        void                setBeta( float beta ) { mOptions.beta = beta; }
+
+        //! Returns the number of samples prepared at once (1, 4 or 8)
+        static size_t       getNumLanes();
+
+    protected:
+        MadgwickFusion( const Options &options );
+
+        //! Updates the orientation with one sample, \a ax, \a ay, \a az being the normalized acceleration or zero to skip the correction
+        void    update( float gx, float gy, float gz, float ax, float ay, float az, float dt );
+
+        Options     mOptions;
+        float       mW, mX, mY, mZ;
+        ci::Vec3f   mAngularVelocity;
+    };
+
+    //! Difference between the orientations of two engines fed with the same samples, in degrees
+    struct FusionComparison {
+        FusionComparison() : numSamples( 0 ), meanTiltError( 0 ), maxTiltError( 0 ), meanError( 0 ), maxError( 0 ) {}
+        size_t  numSamples;
+        //! Angle between the up vectors, pitch and roll only. Without magnetometer the yaw of each engine drifts on its own
+        float   meanTiltError;
+        float   maxTiltError;
+        float   meanError;
+        float   maxError;
+    };
+
+    //! Feeds the samples of \a source to \a engine and \a reference from the start to its end, \a batchSize at a time,
+    //! and measures their difference after each batch, ignoring the first \a settleTime seconds. Stops after the batch
+    //! reaching \a maxTime seconds, the only end of an endless source such as a SyntheticSensor without duration
+    FusionComparison compareFusion( const SensorSourceRef &source, const FusionEngineRef &engine, const FusionEngineRef &reference, size_t batchSize = 16, double settleTime = 1.0, double maxTime = 60.0 );
+    //! Returns the angle in radians between the up vectors of the heads oriented by \a a and \a b
+    float tiltBetween( const ci::Quatf &a, const ci::Quatf &b );
+}
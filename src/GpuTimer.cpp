@@ -0,0 +1,75 @@
+//
+//  GpuTimer.cpp
+//  OculusSDKTest
+//
+
+#include "GpuTimer.h"
+
+#include <algorithm>
+
+namespace ovr {
+
+    GpuTimerRef GpuTimer::create( size_t numQueries )
+    {
+#if defined( GL_TIME_ELAPSED_EXT )
+        if( ci::gl::isExtensionAvailable( "GL_EXT_timer_query" ) || ci::gl::isExtensionAvailable( "GL_ARB_timer_query" ) )
+            return GpuTimerRef( new GpuTimer( std::max<size_t>( numQueries, 2 ) ) );
+#endif
+        return GpuTimerRef();
+    }
+
+    GpuTimer::GpuTimer( size_t numQueries )
+    : mQueries( numQueries, 0 ), mFirstPending( 0 ), mNumPending( 0 ), mActive( false ), mNumSkipped( 0 )
+    {
+        glGenQueries( (GLsizei) mQueries.size(), &mQueries.front() );
+    }
+    GpuTimer::~GpuTimer()
+    {
+        glDeleteQueries( (GLsizei) mQueries.size(), &mQueries.front() );
+    }
+
+    void GpuTimer::begin()
+    {
+#if defined( GL_TIME_ELAPSED_EXT )
+        mActive = mNumPending < mQueries.size();
+        if( ! mActive ){
+            mNumSkipped++;
+            return;
+        }
+        glBeginQuery( GL_TIME_ELAPSED_EXT, mQueries[( mFirstPending + mNumPending ) % mQueries.size()] );
+#endif
+    }
+    void GpuTimer::end()
+    {
+#if defined( GL_TIME_ELAPSED_EXT )
+        if( ! mActive )
+            return;
+        glEndQuery( GL_TIME_ELAPSED_EXT );
+        mNumPending++;
+        mActive = false;
+#endif
+    }
+
+    bool GpuTimer::getElapsed( double *ms )
+    {
+        bool collected = false;
+#if defined( GL_TIME_ELAPSED_EXT )
+        // Queries complete in order, stop at the first one still running
+        while( mNumPending ){
+            GLuint query    = mQueries[mFirstPending];
+            GLint available = 0;
+            glGetQueryObjectiv( query, GL_QUERY_RESULT_AVAILABLE, &available );
+            if( ! available )
+                break;
+
+            GLuint64EXT ns = 0;
+            glGetQueryObjectui64vEXT( query, GL_QUERY_RESULT, &ns );
+            *ms             = ns * 1e-6;
+            collected       = true;
+            mFirstPending   = ( mFirstPending + 1 ) % mQueries.size();
+            mNumPending--;
+        }
+#endif
+        return collected;
+    }
+}
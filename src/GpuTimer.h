@@ -0,0 +1,48 @@
+//
+//  GpuTimer.h
+//  OculusSDKTest
+//
+//  Non-blocking GPU time measurements with timer queries.
+//
+
+#pragma once
+
+#include "cinder/gl/gl.h"
+
+#include <memory>
+#include <vector>
+
+namespace ovr {
+
+    typedef std::shared_ptr<class GpuTimer> GpuTimerRef;
+
+    //! Measures the GPU time spent on the commands issued between begin() and end(). Each measure
+    //! uses its own query from a small ring and is only read back once the GPU is done with it,
+    //! usually a couple of frames later, so reading the results never stalls the pipeline.
+    class GpuTimer
+    {
+    public:
+        //! Returns an empty ptr if GL_EXT_timer_query or GL_ARB_timer_query isn't available
+        static GpuTimerRef create( size_t numQueries = 4 );
+        ~GpuTimer();
+
+        //! Starts a measure, skipped if all the queries are still in flight
+        void    begin();
+        void    end();
+        //! Collects the measures completed since the last call. Returns false if none did, otherwise \a ms receives the newest one
+        bool    getElapsed( double *ms );
+
+        //! Returns the number of measures skipped because all the queries were in flight
+        size_t  getNumSkipped() const { return mNumSkipped; }
+
+    protected:
+        GpuTimer( size_t numQueries );
+
+        std::vector<GLuint> mQueries;
+        //! Index of the oldest query in flight and number of queries in flight
+        size_t              mFirstPending;
+        size_t              mNumPending;
+        bool                mActive;
+        size_t              mNumSkipped;
+    };
+}
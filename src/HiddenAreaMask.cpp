@@ -0,0 +1,294 @@
+//
+//  HiddenAreaMask.cpp
+//  OculusSDKTest
+//
+
+#include "HiddenAreaMask.h"
+
+#include "cinder/Rect.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace ci;
+
+namespace ovr {
+
+    namespace {
+        // Radii sampled along each spoke to find the furthest lookup, in case the warp isn't monotonic
+        const int   RadialSamples   = 32;
+        // Directions checked between two spokes, the edge joining them must stay outside the outline
+        const int   ChordSamples    = 8;
+
+        // Distance from the origin, inside \a rect, to its border along the unit direction \a d
+        float rayToRect( const Rectf &rect, const Vec2f &d )
+        {
+            float t = std::numeric_limits<float>::max();
+            if( d.x > 0.0f )
+                t = std::min( t, rect.x2 / d.x );
+            else if( d.x < 0.0f )
+                t = std::min( t, rect.x1 / d.x );
+            if( d.y > 0.0f )
+                t = std::min( t, rect.y2 / d.y );
+            else if( d.y < 0.0f )
+                t = std::min( t, rect.y1 / d.y );
+            return t;
+        }
+
+        // Distance from the origin to the line through \a p0 and \a p1 along \a d
+        float rayToLine( const Vec2f &p0, const Vec2f &p1, const Vec2f &d )
+        {
+            Vec2f e     = p1 - p0;
+            float denom = d.x * e.y - d.y * e.x;
+            if( fabsf( denom ) < 1e-12f )
+                return std::numeric_limits<float>::max();
+            return ( p0.x * e.y - p0.y * e.x ) / denom;
+        }
+
+        float cross( const Vec2f &a, const Vec2f &b, const Vec2f &c )
+        {
+            return ( b.x - a.x ) * ( c.y - a.y ) - ( b.y - a.y ) * ( c.x - a.x );
+        }
+    }
+
+    HiddenAreaMaskRef HiddenAreaMask::create( const Vec4f &distortionParams, float distortionScale, const Vec4f &chromaticAbCorrection, bool useChromaticAbCorrection, float aspectRatio, const Vec2i &targetSize, int numSpokes, float margin )
+    {
+        HiddenAreaMaskRef mask( new HiddenAreaMask( distortionParams, distortionScale, chromaticAbCorrection, useChromaticAbCorrection, aspectRatio, targetSize ) );
+        for( int eye = 0; eye < 2; eye++ ){
+            mask->generateEye( (Eye) eye, std::max( numSpokes, 4 ), std::max( margin, 0.0f ) );
+            mask->rasterizeEye( (Eye) eye );
+        }
+        return mask;
+    }
+
+    HiddenAreaMask::HiddenAreaMask( const Vec4f &distortionParams, float distortionScale, const Vec4f &chromaticAbCorrection, bool useChromaticAbCorrection, float aspectRatio, const Vec2i &targetSize )
+    : mDistortionParams( distortionParams ),
+    mDistortionScale( distortionScale ),
+    mChromaticAbCorrection( chromaticAbCorrection ),
+    mUseChromaticAbCorrection( useChromaticAbCorrection ),
+    mAspectRatio( aspectRatio ),
+    mTargetSize( std::max( targetSize.x, 2 ), std::max( targetSize.y, 1 ) )
+    {
+        mCoverages[EYE_LEFT] = mCoverages[EYE_RIGHT] = 0.0f;
+    }
+
+    void HiddenAreaMask::generateEye( Eye eye, int numSpokes, float margin )
+    {
+        // The warp is radial once the texture coordinates are taken relative to the lens center and divided
+        // by Scale: a display position theta reads the target at theta * f(|theta|^2). Along each direction
+        // from the lens center the lookups stop at the warped display border, everything past it is hidden.
+        EyeWarpParams params    = EyeWarpParams::calc( eye, mAspectRatio, mDistortionScale );
+        float eyeX              = eye == EYE_LEFT ? 0.0f : 0.5f;
+        Rectf display( ( eyeX - params.lensCenter.x ) * params.scaleIn.x, -params.lensCenter.y * params.scaleIn.y, ( eyeX + 0.5f - params.lensCenter.x ) * params.scaleIn.x, ( 1.0f - params.lensCenter.y ) * params.scaleIn.y );
+        Rectf target( ( eyeX - params.lensCenter.x ) / params.scale.x, -params.lensCenter.y / params.scale.y, ( eyeX + 0.5f - params.lensCenter.x ) / params.scale.x, ( 1.0f - params.lensCenter.y ) / params.scale.y );
+
+        // Margin along any direction, in the same space, using the larger side of a pixel
+        float pixel     = std::max( 1.0f / mTargetSize.x / params.scale.x, 1.0f / mTargetSize.y / params.scale.y );
+        float padding   = margin * pixel;
+
+        // Furthest lookup along d plus the margin, the red and blue ones are scaled around the green one
+        auto calcOutline = [&]( const Vec2f &d ) {
+            float displayRadius = rayToRect( display, d );
+            float radius        = 0.0f;
+            for( int i = 1; i <= RadialSamples; i++ ){
+                float r     = displayRadius * i / RadialSamples;
+                float rSq   = r * r;
+                float scale = 1.0f;
+                if( mUseChromaticAbCorrection )
+                    scale = std::max( scale, std::max( mChromaticAbCorrection.x + mChromaticAbCorrection.y * rSq, mChromaticAbCorrection.z + mChromaticAbCorrection.w * rSq ) );
+                radius = std::max( radius, r * warpFactor( mDistortionParams, rSq ) * scale );
+            }
+            return radius + padding;
+        };
+
+        // Evenly spaced spokes plus the corners, so the outer edges follow the border of the eye exactly
+        std::vector<float> angles;
+        for( int i = 0; i < numSpokes; i++ )
+            angles.push_back( 2.0f * (float) M_PI * i / numSpokes );
+        Vec2f corners[4] = { target.getUpperLeft(), target.getUpperRight(), target.getLowerRight(), target.getLowerLeft() };
+        for( int i = 0; i < 4; i++ ){
+            float angle = atan2f( corners[i].y, corners[i].x );
+            angles.push_back( angle < 0.0f ? angle + 2.0f * (float) M_PI : angle );
+        }
+        std::sort( angles.begin(), angles.end() );
+        angles.erase( std::unique( angles.begin(), angles.end(), []( float a, float b ) { return b - a < 1e-6f; } ), angles.end() );
+
+        std::vector<Vec2f> &triangles = mTriangles[eye];
+        triangles.clear();
+        auto addTriangle = [&]( const Vec2f &a, const Vec2f &b, const Vec2f &c ) {
+            if( fabsf( cross( a, b, c ) ) < 1e-9f )
+                return;
+            const Vec2f *vertices[3] = { &a, &b, &c };
+            for( int i = 0; i < 3; i++ ){
+                Vec2f tc = params.lensCenter + *vertices[i] * params.scale;
+                triangles.push_back( Vec2f( ( tc.x - eyeX ) * 4.0f - 1.0f, tc.y * 2.0f - 1.0f ) );
+            }
+        };
+
+        size_t numAngles = angles.size();
+        for( size_t i = 0; i < numAngles; i++ ){
+            float angle0    = angles[i];
+            float angle1    = i + 1 < numAngles ? angles[i + 1] : angles[0] + 2.0f * (float) M_PI;
+            Vec2f d0( cosf( angle0 ), sinf( angle0 ) );
+            Vec2f d1( cosf( angle1 ), sinf( angle1 ) );
+            float outer0    = rayToRect( target, d0 );
+            float outer1    = rayToRect( target, d1 );
+            float inner0    = std::min( calcOutline( d0 ), outer0 );
+            float inner1    = std::min( calcOutline( d1 ), outer1 );
+            if( inner0 >= outer0 && inner1 >= outer1 )
+                continue;
+
+            // Push the inner edge out until the outline between the spokes stays behind it
+            float push = 1.0f;
+            for( int s = 1; s < ChordSamples; s++ ){
+                float angle = angle0 + ( angle1 - angle0 ) * s / ChordSamples;
+                Vec2f d( cosf( angle ), sinf( angle ) );
+                float r     = rayToLine( d0 * inner0, d1 * inner1, d );
+                if( r > 0.0f )
+                    push = std::max( push, calcOutline( d ) / r );
+            }
+            Vec2f p0 = d0 * std::min( inner0 * push, outer0 );
+            Vec2f p1 = d1 * std::min( inner1 * push, outer1 );
+
+            // Once clamped to the border the edge can cut the outline again, the segment is then left unmasked
+            bool clear = true;
+            for( int s = 1; s < ChordSamples && clear; s++ ){
+                float angle = angle0 + ( angle1 - angle0 ) * s / ChordSamples;
+                Vec2f d( cosf( angle ), sinf( angle ) );
+                clear = rayToLine( p0, p1, d ) >= calcOutline( d );
+            }
+            if( ! clear )
+                continue;
+
+            Vec2f q0 = d0 * outer0;
+            Vec2f q1 = d1 * outer1;
+            addTriangle( p0, q0, q1 );
+            addTriangle( p0, q1, p1 );
+        }
+    }
+
+    void HiddenAreaMask::rasterizeEye( Eye eye )
+    {
+        int width   = mTargetSize.x / 2;
+        int height  = mTargetSize.y;
+        std::vector<uint8_t> &mask = mMasks[eye];
+        mask.assign( width * height, 0 );
+
+        const std::vector<Vec2f> &triangles = mTriangles[eye];
+        for( size_t i = 0; i + 2 < triangles.size(); i += 3 ){
+            Vec2f v[3];
+            for( int j = 0; j < 3; j++ )
+                v[j] = Vec2f( ( triangles[i + j].x + 1.0f ) * 0.5f * width, ( triangles[i + j].y + 1.0f ) * 0.5f * height );
+
+            int x0 = std::max( (int) floorf( std::min( v[0].x, std::min( v[1].x, v[2].x ) ) ), 0 );
+            int x1 = std::min( (int) ceilf( std::max( v[0].x, std::max( v[1].x, v[2].x ) ) ), width );
+            int y0 = std::max( (int) floorf( std::min( v[0].y, std::min( v[1].y, v[2].y ) ) ), 0 );
+            int y1 = std::min( (int) ceilf( std::max( v[0].y, std::max( v[1].y, v[2].y ) ) ), height );
+            for( int y = y0; y < y1; y++ ){
+                for( int x = x0; x < x1; x++ ){
+                    Vec2f c( x + 0.5f, y + 0.5f );
+                    float e0 = cross( v[0], v[1], c );
+                    float e1 = cross( v[1], v[2], c );
+                    float e2 = cross( v[2], v[0], c );
+                    if( ( e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f ) || ( e0 <= 0.0f && e1 <= 0.0f && e2 <= 0.0f ) )
+                        mask[y * width + x] = 1;
+                }
+            }
+        }
+
+        size_t covered = std::count( mask.begin(), mask.end(), 1 );
+        mCoverages[eye] = mask.empty() ? 0.0f : (float) covered / mask.size();
+    }
+
+    bool HiddenAreaMask::isMasked( Eye eye, int x, int y ) const
+    {
+        int width = mTargetSize.x / 2;
+        if( x < 0 || y < 0 || x >= width || y >= mTargetSize.y )
+            return false;
+        return mMasks[eye][y * width + x] != 0;
+    }
+
+    size_t HiddenAreaMask::countMaskedLookups( const Vec2i &displaySize ) const
+    {
+        int width           = mTargetSize.x / 2;
+        int height          = mTargetSize.y;
+        int displayWidth    = displaySize.x / 2;
+        size_t count        = 0;
+        for( int eye = 0; eye < 2; eye++ ){
+            EyeWarpParams params    = EyeWarpParams::calc( (Eye) eye, mAspectRatio, mDistortionScale );
+            float eyeX              = eye == EYE_LEFT ? 0.0f : 0.5f;
+            for( int y = 0; y < displaySize.y; y++ ){
+                for( int x = 0; x < displayWidth; x++ ){
+                    Vec2f in01( eyeX + 0.5f * ( x + 0.5f ) / displayWidth, ( y + 0.5f ) / displaySize.y );
+                    Vec2f tcs[3];
+                    int numLookups = 1;
+                    if( mUseChromaticAbCorrection ){
+                        hmdWarpChromatic( params, mDistortionParams, mChromaticAbCorrection, in01, &tcs[0], &tcs[1], &tcs[2] );
+                        numLookups = 3;
+                    }
+                    else
+                        hmdWarp( params, mDistortionParams, in01, &tcs[0] );
+
+                    for( int i = 0; i < numLookups; i++ ){
+                        if( ! isInsideEye( params, tcs[i] ) )
+                            continue;
+                        int px = (int) floorf( ( tcs[i].x - eyeX ) * 2.0f * width - 0.5f ) - 1;
+                        int py = (int) floorf( tcs[i].y * height - 0.5f ) - 1;
+                        bool masked = false;
+                        for( int j = 0; j < 16 && ! masked; j++ )
+                            masked = isMasked( (Eye) eye, px + j % 4, py + j / 4 );
+                        count += masked ? 1 : 0;
+                    }
+                }
+            }
+        }
+        return count;
+    }
+
+    void HiddenAreaMask::render( const Vec2i &size ) const
+    {
+        int half = size.x / 2;
+        glPushAttrib( GL_VIEWPORT_BIT );
+        glViewport( 0, 0, half, size.y );
+        render( EYE_LEFT );
+        glViewport( half, 0, size.x - half, size.y );
+        render( EYE_RIGHT );
+        glPopAttrib();
+    }
+
+    void HiddenAreaMask::render( Eye eye ) const
+    {
+        const std::vector<Vec2f> &triangles = mTriangles[eye];
+        if( triangles.empty() )
+            return;
+
+        // The triangles are already in clip space, and a null depth range puts them at the near plane
+        // whatever the depth function of the scene is
+        glPushAttrib( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_ENABLE_BIT | GL_VIEWPORT_BIT );
+        glMatrixMode( GL_PROJECTION );
+        glPushMatrix();
+        glLoadIdentity();
+        glMatrixMode( GL_MODELVIEW );
+        glPushMatrix();
+        glLoadIdentity();
+
+        glDisable( GL_CULL_FACE );
+        glEnable( GL_DEPTH_TEST );
+        glDepthFunc( GL_ALWAYS );
+        glDepthMask( GL_TRUE );
+        glDepthRange( 0.0, 0.0 );
+        glColorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
+
+        glEnableClientState( GL_VERTEX_ARRAY );
+        glVertexPointer( 2, GL_FLOAT, 0, &triangles[0].x );
+        glDrawArrays( GL_TRIANGLES, 0, (GLsizei) triangles.size() );
+        glDisableClientState( GL_VERTEX_ARRAY );
+
+        glMatrixMode( GL_PROJECTION );
+        glPopMatrix();
+        glMatrixMode( GL_MODELVIEW );
+        glPopMatrix();
+        glPopAttrib();
+    }
+}
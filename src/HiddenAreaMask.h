@@ -0,0 +1,70 @@
+//
+//  HiddenAreaMask.h
+//  OculusSDKTest
+//
+//  Parts of the side by side render target the distortion never reads.
+//
+
+#pragma once
+
+#include "cinder/gl/gl.h"
+
+#include "Distortion.h"
+
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+namespace ovr {
+
+    typedef std::shared_ptr<class HiddenAreaMask> HiddenAreaMaskRef;
+
+    //! Triangles covering the pixels of each eye that no lookup of the distortion reaches, outside of the
+    //! warped outline of the display. Laid into the depth buffer before the eyes are drawn, the depth test
+    //! rejects the scene there before it is shaded.
+    class HiddenAreaMask
+    {
+    public:
+        //! Returns the mask of both eyes of a \a targetSize side by side target. \a aspectRatio is the width of one eye of the display divided by
+        //! its height. \a numSpokes is the number of directions the outline is sampled along, \a margin the number of pixels left unmasked around it
+        static HiddenAreaMaskRef create( const ci::Vec4f &distortionParams, float distortionScale, const ci::Vec4f &chromaticAbCorrection, bool useChromaticAbCorrection, float aspectRatio, const ci::Vec2i &targetSize, int numSpokes = 64, float margin = 3.0f );
+
+        //! Writes the masks at the near plane of the depth buffer of the bound target, \a size being the part both eyes are rendered to. Call after clearing it
+        void    render( const ci::Vec2i &size ) const;
+        //! Writes the mask of \a eye to the current viewport
+        void    render( Eye eye ) const;
+
+        //! Returns the triangle list of \a eye, in the normalized device coordinates of its viewport
+        const std::vector<ci::Vec2f>&   getTriangles( Eye eye ) const { return mTriangles[eye]; }
+        //! Returns the fraction of the pixels of \a eye whose center is covered, the pixels the scene isn't shaded at
+        float   getCoverage( Eye eye ) const { return mCoverages[eye]; }
+        //! Returns the fraction of the pixels of both eyes covered
+        float   getCoverage() const { return ( mCoverages[EYE_LEFT] + mCoverages[EYE_RIGHT] ) * 0.5f; }
+        //! Returns whether pixel \a x, \a y of \a eye, from the bottom left of its half of the target, is covered
+        bool    isMasked( Eye eye, int x, int y ) const;
+        //! Returns the number of lookups of the distortion of a \a displaySize display whose bilinear footprint, grown by a pixel
+        //! for the multisampled edges, touches a covered pixel. 0 means the mask never hides anything the distortion reads
+        size_t  countMaskedLookups( const ci::Vec2i &displaySize = ci::Vec2i( 1280, 800 ) ) const;
+
+        const ci::Vec2i&    getTargetSize() const { return mTargetSize; }
+
+    protected:
+        HiddenAreaMask( const ci::Vec4f &distortionParams, float distortionScale, const ci::Vec4f &chromaticAbCorrection, bool useChromaticAbCorrection, float aspectRatio, const ci::Vec2i &targetSize );
+
+        void    generateEye( Eye eye, int numSpokes, float margin );
+        //! Rasterizes the triangles of \a eye at pixel centers to mMasks and measures the coverage
+        void    rasterizeEye( Eye eye );
+
+        ci::Vec4f               mDistortionParams;
+        float                   mDistortionScale;
+        ci::Vec4f               mChromaticAbCorrection;
+        bool                    mUseChromaticAbCorrection;
+        float                   mAspectRatio;
+        //! Size of both eyes, each one gets half of its width
+        ci::Vec2i               mTargetSize;
+
+        std::vector<ci::Vec2f>  mTriangles[2];
+        std::vector<uint8_t>    mMasks[2];
+        float                   mCoverages[2];
+    };
+}
@@ -0,0 +1,124 @@
+//
+//  MappedFile.cpp
+//  OculusSDKTest
+//
+
+#include "MappedFile.h"
+
+#include <fstream>
+
+#if defined( _WIN32 )
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace ovr {
+
+#if defined( _WIN32 )
+
+    MappedFile::MappedFile()
+    : mData( NULL ), mSize( 0 ), mFile( INVALID_HANDLE_VALUE ), mMapping( NULL )
+    {
+    }
+    MappedFile::~MappedFile()
+    {
+        if( mData )
+            UnmapViewOfFile( mData );
+        if( mMapping )
+            CloseHandle( mMapping );
+        if( mFile != INVALID_HANDLE_VALUE )
+            CloseHandle( mFile );
+    }
+
+    MappedFileRef MappedFile::open( const ci::fs::path &path )
+    {
+        MappedFileRef file( new MappedFile() );
+        file->mFile = CreateFileW( path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+        if( file->mFile == INVALID_HANDLE_VALUE )
+            return MappedFileRef();
+
+        LARGE_INTEGER size;
+        if( ! GetFileSizeEx( file->mFile, &size ) || size.QuadPart == 0 )
+            return MappedFileRef();
+
+        file->mMapping = CreateFileMappingW( file->mFile, NULL, PAGE_READONLY, 0, 0, NULL );
+        if( ! file->mMapping )
+            return MappedFileRef();
+
+        file->mData = static_cast<const uint8_t*>( MapViewOfFile( file->mMapping, FILE_MAP_READ, 0, 0, 0 ) );
+        if( ! file->mData )
+            return MappedFileRef();
+
+        file->mSize = (size_t) size.QuadPart;
+        return file;
+    }
+
+#else
+
+    MappedFile::MappedFile()
+    : mData( NULL ), mSize( 0 ), mFile( -1 )
+    {
+    }
+    MappedFile::~MappedFile()
+    {
+        if( mData )
+            munmap( const_cast<uint8_t*>( mData ), mSize );
+        if( mFile != -1 )
+            close( mFile );
+    }
+
+    MappedFileRef MappedFile::open( const ci::fs::path &path )
+    {
+        MappedFileRef file( new MappedFile() );
+        file->mFile = ::open( path.string().c_str(), O_RDONLY );
+        if( file->mFile == -1 )
+            return MappedFileRef();
+
+        struct stat info;
+        if( fstat( file->mFile, &info ) != 0 || info.st_size == 0 )
+            return MappedFileRef();
+
+        void *data = mmap( NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, file->mFile, 0 );
+        if( data == MAP_FAILED )
+            return MappedFileRef();
+
+        file->mData = static_cast<const uint8_t*>( data );
+        file->mSize = (size_t) info.st_size;
+        return file;
+    }
+
+#endif
+
+    uint64_t fnv1a( const void *data, size_t size, uint64_t hash )
+    {
+        const uint8_t *bytes = static_cast<const uint8_t*>( data );
+        for( size_t i = 0; i < size; i++ ){
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    bool writeFileAtomically( const ci::fs::path &path, const std::vector<FileChunk> &chunks )
+    {
+        if( path.has_parent_path() && ! ci::fs::exists( path.parent_path() ) )
+            ci::fs::create_directories( path.parent_path() );
+
+        ci::fs::path tempPath = path.string() + ".tmp";
+        {
+            std::ofstream out( tempPath.string().c_str(), std::ios::binary | std::ios::trunc );
+            for( size_t i = 0; i < chunks.size(); i++ ){
+                if( chunks[i].size )
+                    out.write( static_cast<const char*>( chunks[i].data ), chunks[i].size );
+            }
+            if( ! out )
+                return false;
+        }
+        ci::fs::rename( tempPath, path );
+        return true;
+    }
+}
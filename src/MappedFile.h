@@ -0,0 +1,55 @@
+//
+//  MappedFile.h
+//  OculusSDKTest
+//
+//  Read-only memory mapping of a file, and the helpers shared by the binary caches.
+//
+
+#pragma once
+
+#include "cinder/Filesystem.h"
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+namespace ovr {
+
+    typedef std::shared_ptr<class MappedFile> MappedFileRef;
+
+    class MappedFile
+    {
+    public:
+        //! Returns an empty ptr if the file can't be opened or mapped
+        static MappedFileRef open( const ci::fs::path &path );
+        ~MappedFile();
+
+        const uint8_t*  getData() const { return mData; }
+        size_t          getSize() const { return mSize; }
+
+    protected:
+        MappedFile();
+
+        const uint8_t*  mData;
+        size_t          mSize;
+#if defined( _WIN32 )
+        void*           mFile;
+        void*           mMapping;
+#else
+        int             mFile;
+#endif
+    };
+
+    //! 64 bits FNV-1a, used for the cache keys and checksums
+    uint64_t fnv1a( const void *data, size_t size, uint64_t hash = 14695981039346656037ULL );
+
+    struct FileChunk {
+        FileChunk( const void *data, size_t size ) : data( data ), size( size ) {}
+        const void* data;
+        size_t      size;
+    };
+
+    //! Writes the chunks to a temporary file then renames it to path, so a crash never leaves a
+    //! truncated file behind. Creates the parent directories, and throws on filesystem errors.
+    bool writeFileAtomically( const ci::fs::path &path, const std::vector<FileChunk> &chunks );
+}
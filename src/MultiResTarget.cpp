@@ -0,0 +1,88 @@
+//
+//  MultiResTarget.cpp
+//  OculusSDKTest
+//
+
+#include "MultiResTarget.h"
+#include "PixelDensity.h"
+
+#include <algorithm>
+
+using namespace ci;
+
+namespace ovr {
+
+    namespace {
+        // Periphery pixels left unmasked around the center regions, covers the bilinear
+        // footprint of the lookups falling right outside of the center texture coordinates
+        const int MaskMargin = 2;
+    }
+
+    MultiResTargetRef MultiResTarget::create( const Vec2i &size, const Rectf &centerRegion, float peripheryScale, const gl::Fbo::Format &format )
+    {
+        return MultiResTargetRef( new MultiResTarget( size, centerRegion, peripheryScale, format ) );
+    }
+
+    MultiResTarget::MultiResTarget( const Vec2i &size, const Rectf &centerRegion, float peripheryScale, const gl::Fbo::Format &format )
+    : mSize( size ), mPeripheryScale( peripheryScale )
+    {
+        mCenterRegions[EYE_LEFT]    = centerRegion;
+        mCenterRegions[EYE_RIGHT]   = PixelDensityMap::mirror( centerRegion );
+
+        // Both targets stay side by side with an even width, the center one only holds the regions
+        int centerWidth     = 2 * std::max( (int) ( size.x * 0.5f * centerRegion.getWidth() + 0.5f ), 1 );
+        int centerHeight    = std::max( (int) ( size.y * centerRegion.getHeight() + 0.5f ), 1 );
+        mCenterFbo          = gl::Fbo( centerWidth, centerHeight, format );
+        mPeripheryFbo       = gl::Fbo( 2 * std::max( (int) ( size.x * 0.5f * peripheryScale + 0.5f ), 1 ), std::max( (int) ( size.y * peripheryScale + 0.5f ), 1 ), format );
+
+        // Lookups within a texel of the region edges read the periphery, so the
+        // center texture is never filtered against the other eye or the clamped border
+        for( int eye = 0; eye < 2; eye++ ){
+            const Rectf &region = mCenterRegions[eye];
+            float texelX        = region.getWidth() / ( centerWidth / 2 );
+            float texelY        = region.getHeight() / centerHeight;
+            float x             = eye == EYE_LEFT ? 0.0f : 0.5f;
+            mCenterTexCoords[eye] = Rectf( x + ( region.x1 + texelX ) * 0.5f, region.y1 + texelY, x + ( region.x2 - texelX ) * 0.5f, region.y2 - texelY );
+        }
+    }
+
+    void MultiResTarget::maskCenter()
+    {
+        glEnable( GL_SCISSOR_TEST );
+        glClearDepth( 0.0 );
+        for( int eye = 0; eye < 2; eye++ ){
+            Area viewport       = getPeripheryViewport( (Eye) eye );
+            const Rectf &region = mCenterRegions[eye];
+            int x1 = viewport.x1 + (int) ( region.x1 * viewport.getWidth() ) + MaskMargin;
+            int y1 = viewport.y1 + (int) ( region.y1 * viewport.getHeight() ) + MaskMargin;
+            int x2 = viewport.x1 + (int) ( region.x2 * viewport.getWidth() ) - MaskMargin;
+            int y2 = viewport.y1 + (int) ( region.y2 * viewport.getHeight() ) - MaskMargin;
+            if( x2 <= x1 || y2 <= y1 )
+                continue;
+            glScissor( x1, y1, x2 - x1, y2 - y1 );
+            glClear( GL_DEPTH_BUFFER_BIT );
+        }
+        glClearDepth( 1.0 );
+        glDisable( GL_SCISSOR_TEST );
+    }
+
+    Matrix44f MultiResTarget::getCenterCrop( Eye eye ) const
+    {
+        // Scales and offsets clip space so the region covers the whole viewport
+        const Rectf &region = mCenterRegions[eye];
+        float sx            = 1.0f / region.getWidth();
+        float sy            = 1.0f / region.getHeight();
+        Matrix44f crop;
+        crop.m[0]   = sx;
+        crop.m[5]   = sy;
+        crop.m[12]  = -sx * ( region.x1 + region.x2 - 1.0f );
+        crop.m[13]  = -sy * ( region.y1 + region.y2 - 1.0f );
+        return crop;
+    }
+
+    Area MultiResTarget::getViewport( const gl::Fbo &fbo, Eye eye )
+    {
+        int half = fbo.getWidth() / 2;
+        return Area( half * eye, 0, half * ( eye + 1 ), fbo.getHeight() );
+    }
+}
@@ -0,0 +1,73 @@
+//
+//  MultiResTarget.h
+//  OculusSDKTest
+//
+//  Side by side render target with a reduced resolution periphery.
+//
+
+#pragma once
+
+#include "cinder/gl/Fbo.h"
+#include "cinder/Matrix.h"
+#include "cinder/Rect.h"
+
+#include "Distortion.h"
+
+namespace ovr {
+
+    typedef std::shared_ptr<class MultiResTarget> MultiResTargetRef;
+
+    //! Replaces a single side by side render target by two: one holding the center region of
+    //! each eye at full resolution and one holding the whole eyes at a reduced resolution. The
+    //! center regions are masked out of the periphery with the depth buffer so they are only
+    //! shaded once, DistortionHelper picks the right target for each lookup when recomposing.
+    class MultiResTarget
+    {
+    public:
+        //! \a size is the size of the equivalent single target. \a centerRegion is normalized in the left eye, origin at the bottom left,
+        //! the right eye uses its mirror. The periphery is rendered at \a peripheryScale times the resolution of the single target
+        static MultiResTargetRef create( const ci::Vec2i &size, const ci::Rectf &centerRegion, float peripheryScale, const ci::gl::Fbo::Format &format = ci::gl::Fbo::Format() );
+
+        //! Binds the target of the center regions, each eye renders to its half
+        void    bindCenter() { mCenterFbo.bindFramebuffer(); }
+        //! Binds the target of the periphery, each eye renders to its half
+        void    bindPeriphery() { mPeripheryFbo.bindFramebuffer(); }
+        void    unbind() { ci::gl::Fbo::unbindFramebuffer(); }
+        //! Clears the depth of the center regions of the bound periphery target to the near plane so early depth
+        //! testing rejects everything drawn there. Call right after clearing it
+        void    maskCenter();
+
+        //! Returns the viewport of \a eye in the center target
+        ci::Area        getCenterViewport( Eye eye ) const { return getViewport( mCenterFbo, eye ); }
+        //! Returns the viewport of \a eye in the periphery target
+        ci::Area        getPeripheryViewport( Eye eye ) const { return getViewport( mPeripheryFbo, eye ); }
+        //! Returns the matrix to multiply the projection of \a eye with so it only covers its center region
+        ci::Matrix44f   getCenterCrop( Eye eye ) const;
+        //! Returns the center region of \a eye, normalized in the eye
+        const ci::Rectf& getCenterRegion( Eye eye ) const { return mCenterRegions[eye]; }
+        //! Returns the part of the side by side texture coordinates read from the center target, a texel inside the center region of \a eye
+        const ci::Rectf& getCenterTexCoords( Eye eye ) const { return mCenterTexCoords[eye]; }
+
+        ci::gl::Fbo&        getCenterFbo() { return mCenterFbo; }
+        ci::gl::Fbo&        getPeripheryFbo() { return mPeripheryFbo; }
+        //! Returns the center texture, resolved if multisampled
+        ci::gl::Texture&    getCenterTexture() { return mCenterFbo.getTexture(); }
+        //! Returns the periphery texture, resolved if multisampled
+        ci::gl::Texture&    getPeripheryTexture() { return mPeripheryFbo.getTexture(); }
+
+        const ci::Vec2i&    getSize() const { return mSize; }
+        float               getPeripheryScale() const { return mPeripheryScale; }
+
+    protected:
+        MultiResTarget( const ci::Vec2i &size, const ci::Rectf &centerRegion, float peripheryScale, const ci::gl::Fbo::Format &format );
+
+        static ci::Area     getViewport( const ci::gl::Fbo &fbo, Eye eye );
+
+        ci::gl::Fbo     mCenterFbo;
+        ci::gl::Fbo     mPeripheryFbo;
+        ci::Vec2i       mSize;
+        float           mPeripheryScale;
+        ci::Rectf       mCenterRegions[2];
+        ci::Rectf       mCenterTexCoords[2];
+    };
+}
@@ -10,13 +10,35 @@
 
 #include "cinder/Utilities.h"
 
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+
 using namespace ci;
 
+// Issues a GL call, or a Cinder call wrapping one, and counts it
+#define OVR_GL_COUNT( call ) do { call; ++mNumGlCalls; } while( 0 )
+
 namespace ovr {
     
+    namespace {
+        inline bool isSameRect( const Rectf &a, const Rectf &b )
+        {
+            return a.x1 == b.x1 && a.y1 == b.y1 && a.x2 == b.x2 && a.y2 == b.y2;
+        }
+    }
     
     DeviceRef Device::create()
     {
+        // Headless backends, selected from the environment so the app code stays the same
+        if( const char *backend = std::getenv( "CINDER_OVR_DEVICE" ) ){
+            std::string name( backend );
+            if( name == "synthetic" )
+                return createSynthetic();
+            else if( name.compare( 0, 7, "replay:" ) == 0 )
+                return createFromRecording( name.substr( 7 ) );
+        }
+        
         // Try to initialize a device
         DeviceRef newDevice( new Device() );
         if( newDevice->mHMD )
@@ -25,22 +47,56 @@ namespace ovr {
         // Returns a null_ptr if it failed
         else return DeviceRef();
     }
+    std::future<DeviceRef> Device::createAsync()
+    {
+        return std::async( std::launch::async, []() { return Device::create(); } );
+    }
+    DeviceRef Device::createFromRecording( const fs::path &path, ReplayMode mode, bool loop )
+    {
+        SensorRecordingRef recording = SensorRecording::open( path );
+        if( ! recording || ! recording->getNumSamples() )
+            return DeviceRef();
+        
+        return createFromSource( recording, mode, loop );
+    }
+    DeviceRef Device::createFromSource( const SensorSourceRef &source, ReplayMode mode, bool loop )
+    {
+        DeviceRef newDevice( new Device( source->getHMDInfo() ) );
+        newDevice->mSensorSource    = source;
+        newDevice->mReplayMode      = mode;
+        newDevice->mReplayLoop      = loop;
+        if( mode != REPLAY_MANUAL ){
+            newDevice->mReplayRunning   = true;
+            newDevice->mReplayThread    = std::thread( &Device::replayThreadLoop, newDevice.get() );
+        }
+        return newDevice;
+    }
+    DeviceRef Device::createSynthetic( const SyntheticSensor::Options &options, ReplayMode mode )
+    {
+        return createFromSource( SyntheticSensor::create( options ), mode, false );
+    }
     Device::~Device()
     {
+        stopSensorThread();
+        stopRecording();
+        if( mSensorDevice && mFusionEngine )
+            mSensorDevice->SetMessageHandler( NULL );
+        if( mReplayThread.joinable() ){
+            mReplayRunning = false;
+            mReplayThread.join();
+        }
+        
         // Clear Hmd and Sensor
         mSensorDevice.Clear();
         mHMD.Clear();
         mManager.Clear();
         mSensorFusion = nullptr;
-      
-        OVR::System::Destroy();
     }
     
     Device::Device()
+    : mRecordingHandler( this )
     {
-        
-        // Init OVR
-        OVR::System::Init( OVR::Log::ConfigureDefaultLog( OVR::LogMask_All ) );
+        initDefaults();
         
         // Create Manager and Device Handle
         mManager = *OVR::DeviceManager::Create();
@@ -52,6 +108,7 @@ namespace ovr {
             if (mHMD->GetDeviceInfo(&mHMDInfo))
             {
                 mStereoConfig.SetHMDInfo( mHMDInfo );
+                invalidateEyeRenderDescs();
             }
             
             mSensorDevice = *mHMD->GetSensor();
@@ -63,6 +120,39 @@ namespace ovr {
     }
     
     
+    Device::Device( const OVR::HMDInfo &info )
+    : mRecordingHandler( this )
+    {
+        initDefaults();
+        
+        mHMDInfo = info;
+        mStereoConfig.SetHMDInfo( mHMDInfo );
+        invalidateEyeRenderDescs();
+        mSensorFusion = std::make_shared<OVR::SensorFusion>();
+    }
+    
+    void Device::initDefaults()
+    {
+        mPredictionHorizon      = -1.0f;
+        mPredictionFrames       = 2.0f;
+        mFrameTime              = 1.0f / 60.0f;
+        mLastFrameTimeStamp     = 0.0;
+        mPredictionStatsEnabled = false;
+        mSensorThreadRunning    = false;
+        mSensorThreadRate       = 1000.0f;
+        mPoseHistoryScratch.resize( mPoseRing.getCapacity() );
+        mReplayMode             = REPLAY_REALTIME;
+        mReplayLoop             = false;
+        mHasPendingSample       = false;
+        mReplayTimeOffset       = 0.0;
+        mReplayTime             = 0.0;
+        mReplayFinished         = false;
+        mReplayRunning          = false;
+        mEyeRenderDescsDirty    = true;
+        mStereoGeneration       = 0;
+        resetPredictionStats();
+    }
+    
     float Device::getIPD() const
     {
         return mStereoConfig.GetIPD();
@@ -88,186 +178,766 @@ namespace ovr {
         return Vec4f( mHMDInfo.DistortionK[0], mHMDInfo.DistortionK[1], mHMDInfo.DistortionK[2], mHMDInfo.DistortionK[3] );
     }
     
+    Vec4f Device::getChromaticAbParams() const
+    {
+        return Vec4f( mHMDInfo.ChromaAbCorrection[0], mHMDInfo.ChromaAbCorrection[1], mHMDInfo.ChromaAbCorrection[2], mHMDInfo.ChromaAbCorrection[3] );
+    }
+    Vec2i Device::getResolution() const
+    {
+        return Vec2i( mHMDInfo.HResolution, mHMDInfo.VResolution );
+    }
+    DistortionCache::Key Device::getDistortionCacheKey( bool chromaticAbCorrection )
+    {
+        DistortionCache::Key key;
+        key.distortionParams            = getDistortionParams();
+        key.distortionScale             = getDistortionScale();
+        key.chromaticAbCorrection       = getChromaticAbParams();
+        key.useChromaticAbCorrection    = chromaticAbCorrection;
+        key.resolution                  = getResolution();
+        return key;
+    }
+    
+    Pose Device::getPose()
+    {
+        Pose pose;
+        if( isSensorThreadRunning() && mPoseRing.getLatest( &pose ) )
+            return pose;
+        return readPose();
+    }
+    Pose Device::readPose()
+    {
+        {
+            std::lock_guard<std::mutex> lock( mFusionMutex );
+            if( mFusionEngine )
+                return Pose( OVR::Timer::GetSeconds(), mFusionEngine->getOrientation(), mFusionEngine->getAngularVelocity() );
+        }
+        
+        // Samples fed by hand aren't guarded by the sensor message lock
+        std::unique_lock<std::mutex> lock( mReplayMutex, std::defer_lock );
+        if( isReplay() )
+            lock.lock();
+        return Pose( OVR::Timer::GetSeconds(), toCinder( mSensorFusion->GetOrientation() ), toCinder( mSensorFusion->GetAngularVelocity() ) );
+    }
+    
     Quatf Device::getOrientation()
     {
-        return toCinder( mSensorFusion->GetOrientation() );
+        Pose pose = getPose();
+        if( mPredictionStatsEnabled )
+            updatePredictionStats( pose.time, pose.orientation );
+        return pose.orientation;
+    }
+    Vec3f Device::getAngularVelocity()
+    {
+        return getPose().angularVelocity;
     }
-    
-    
-    
-    Area        Device::getLeftEyeViewport()
-    {
-        return toCinder( mStereoConfig.GetEyeRenderParams( OVR::Util::Render::StereoEye_Left ).VP );
-    }
-    Matrix44f   Device::getLeftEyeViewAdjust()
+    
+    Quatf Device::getPredictedOrientation( float secondsAhead )
     {
-        return toCinder( mStereoConfig.GetEyeRenderParams( OVR::Util::Render::StereoEye_Left ).ViewAdjust );
+        // Extrapolate from the pose timestamp, the published pose can be slightly older than now
+        double now          = OVR::Timer::GetSeconds();
+        Pose pose           = getPose();
+        Quatf predicted     = predictOrientation( pose.orientation, pose.angularVelocity, (float) ( now + secondsAhead - pose.time ) );
+        
+        if( mPredictionStatsEnabled ){
+            updatePredictionStats( pose.time, pose.orientation );
+            mPendingPredictions.push_back( Pose( now + secondsAhead, predicted, Vec3f::zero() ) );
+        }
+        return predicted;
     }
-    Matrix44f   Device::getLeftEyeProjection()
+    Quatf Device::getPredictedOrientation()
     {
-        return toCinder( mStereoConfig.GetEyeRenderParams( OVR::Util::Render::StereoEye_Left ).Projection );
+        // Smooth the interval between calls to get a stable frame time
+        double now = OVR::Timer::GetSeconds();
+        if( mLastFrameTimeStamp > 0.0 ){
+            float frameTime = std::min( (float) ( now - mLastFrameTimeStamp ), 0.1f );
+            mFrameTime      = mFrameTime * 0.9f + frameTime * 0.1f;
+        }
+        mLastFrameTimeStamp = now;
+        
+        return getPredictedOrientation( getPredictionHorizon() );
     }
-    Matrix44f   Device::getLeftEyeOrthoProjection()
+    float Device::getPredictionHorizon() const
     {
-        return toCinder( mStereoConfig.GetEyeRenderParams( OVR::Util::Render::StereoEye_Left ).OrthoProjection );
+        return mPredictionHorizon >= 0.0f ? mPredictionHorizon : mFrameTime * mPredictionFrames;
     }
     
-    Area        Device::getRightEyeViewport()
+    void Device::startSensorThread( float rateHz )
     {
-        return toCinder( mStereoConfig.GetEyeRenderParams( OVR::Util::Render::StereoEye_Right ).VP );
+        if( mSensorThread.joinable() )
+            return;
+        
+        mSensorThreadRate       = std::max( rateHz, 1.0f );
+        mSensorThreadRunning    = true;
+        mSensorThread           = std::thread( &Device::sensorThreadLoop, this );
     }
-    Matrix44f   Device::getRightEyeViewAdjust()
+    void Device::stopSensorThread()
     {
-        return toCinder( mStereoConfig.GetEyeRenderParams( OVR::Util::Render::StereoEye_Right ).ViewAdjust );
+        if( ! mSensorThread.joinable() )
+            return;
+        
+        mSensorThreadRunning = false;
+        mSensorThread.join();
     }
-    Matrix44f   Device::getRightEyeProjection()
+    size_t Device::updatePoseHistory( PoseHistory *history ) const
     {
-        return toCinder( mStereoConfig.GetEyeRenderParams( OVR::Util::Render::StereoEye_Right ).Projection );
+        // The ring gives the newest first, the history wants them in order and only the new ones
+        std::vector<Pose> &poses = mPoseHistoryScratch;
+        size_t count = mPoseRing.getHistory( poses.data(), poses.size() );
+        while( count && ! history->empty() && poses[count - 1].time <= history->getNewestTime() )
+            count--;
+        for( size_t i = count; i > 0; i-- )
+            history->push( poses[i - 1] );
+        return count;
     }
-    Matrix44f   Device::getRightEyeOrthoProjection()
+    void Device::sensorThreadLoop()
     {
-        return toCinder( mStereoConfig.GetEyeRenderParams( OVR::Util::Render::StereoEye_Right ).OrthoProjection );
+        double period   = 1.0 / mSensorThreadRate;
+        double next     = OVR::Timer::GetSeconds();
+        while( mSensorThreadRunning ){
+            mPoseRing.push( readPose() );
+            
+            // Late ticks are dropped rather than caught up
+            next += period;
+            double wait = next - OVR::Timer::GetSeconds();
+            if( wait > 0.0 )
+                std::this_thread::sleep_for( std::chrono::microseconds( (int64_t) ( wait * 1000000.0 ) ) );
+            else
+                next = OVR::Timer::GetSeconds();
+        }
     }
     
-    static const char* PostProcessFragShaderSrc =
-    "uniform vec2 LensCenter;\n"
-    "uniform vec2 ScreenCenter;\n"
-    "uniform vec2 Scale;\n"
-    "uniform vec2 ScaleIn;\n"
-    "uniform vec4 HmdWarpParam;\n"
-    "uniform sampler2D Texture0;\n"
-    "\n"
-    "vec2 HmdWarp(vec2 in01)\n"
-    "{\n"
-    "   vec2  theta = (in01 - LensCenter) * ScaleIn;\n" // Scales to [-1, 1]
-    "   float rSq = theta.x * theta.x + theta.y * theta.y;\n"
-    "   vec2  theta1 = theta * (HmdWarpParam.x + HmdWarpParam.y * rSq + "
-    "                           HmdWarpParam.z * rSq * rSq + HmdWarpParam.w * rSq * rSq * rSq);\n"
-    "   return LensCenter + Scale * theta1;\n"
-    "}\n"
-    "void main()\n"
-    "{\n"
-    "   vec2 tc = HmdWarp(gl_TexCoord[0].st);\n"
-    "   if (!all(equal(clamp(tc, ScreenCenter-vec2(0.25,0.5), ScreenCenter+vec2(0.25,0.5)), tc)))\n"
-    "       gl_FragColor = vec4(0,0,0,1);\n"
-    "   else\n"
-    "       gl_FragColor = texture2D(Texture0, tc);\n"
-    "}\n";
+    bool Device::startRecording( const fs::path &path )
+    {
+        if( ! mSensorDevice || mRecorder )
+            return false;
+        
+        SensorRecorderRef recorder = SensorRecorder::create( path, mHMDInfo );
+        if( ! recorder )
+            return false;
+        {
+            std::lock_guard<std::mutex> lock( mRecorderMutex );
+            mRecorder = recorder;
+        }
+        
+        // Take over the sensor messages, the handler forwards them to the fusion
+        mSensorDevice->SetMessageHandler( &mRecordingHandler );
+        return true;
+    }
+    void Device::stopRecording()
+    {
+        if( ! mRecorder )
+            return;
+        
+        // The fusion engine still needs the messages
+        if( ! mFusionEngine ){
+            mSensorDevice->SetMessageHandler( NULL );
+            mSensorFusion->AttachToSensor( mSensorDevice );
+        }
+        
+        // The handler can still be writing a frame on the OVR thread, the recorder is only closed once it let go of it
+        SensorRecorderRef recorder;
+        {
+            std::lock_guard<std::mutex> lock( mRecorderMutex );
+            recorder.swap( mRecorder );
+        }
+        recorder->close();
+    }
+    void Device::RecordingHandler::OnMessage( const OVR::Message &msg )
+    {
+        if( msg.Type != OVR::Message_BodyFrame )
+            return;
+        
+        const OVR::MessageBodyFrame &frame = static_cast<const OVR::MessageBodyFrame&>( msg );
+        {
+            std::lock_guard<std::mutex> lock( mDevice->mRecorderMutex );
+            if( mDevice->mRecorder )
+                mDevice->mRecorder->addFrame( frame );
+        }
+        if( ! mDevice->processFusionEngine( toSensorSample( frame, OVR::Timer::GetSeconds() ) ) )
+            mDevice->mSensorFusion->OnMessage( frame );
+    }
+    
+    void Device::setFusionEngine( const FusionEngineRef &engine )
+    {
+        {
+            std::lock_guard<std::mutex> lock( mFusionMutex );
+            mFusionEngine = engine;
+            if( mFusionEngine )
+                mFusionEngine->reset();
+        }
+        
+        // The messages of the HMD go through the handler while an engine or a recording needs them
+        if( mSensorDevice && ! mRecorder ){
+            if( engine )
+                mSensorDevice->SetMessageHandler( &mRecordingHandler );
+            else {
+                mSensorDevice->SetMessageHandler( NULL );
+                mSensorFusion->AttachToSensor( mSensorDevice );
+            }
+        }
+    }
+    bool Device::processFusionEngine( const SensorSample &sample )
+    {
+        std::lock_guard<std::mutex> lock( mFusionMutex );
+        if( ! mFusionEngine )
+            return false;
+        mFusionEngine->process( &sample, 1 );
+        return true;
+    }
+    
+    void Device::deliverReplaySample( const SensorSample &sample )
+    {
+        std::lock_guard<std::mutex> lock( mReplayMutex );
+        if( ! processFusionEngine( sample ) )
+            mSensorFusion->OnMessage( toBodyFrame( sample ) );
+        mReplayTime = mReplayTimeOffset + sample.time;
+    }
+    void Device::advanceReplay( double seconds )
+    {
+        if( ! mSensorSource || mReplayMode != REPLAY_MANUAL )
+            return;
+        
+        double target = mReplayTime + seconds;
+        while( ! mReplayFinished ){
+            if( ! mHasPendingSample ){
+                mHasPendingSample = mSensorSource->nextSample( &mPendingSample );
+                if( ! mHasPendingSample ){
+                    if( ! mReplayLoop ){
+                        mReplayFinished = true;
+                        break;
+                    }
+                    // Keep the time increasing across loops
+                    mReplayTimeOffset = mReplayTime;
+                    mSensorSource->rewind();
+                    continue;
+                }
+            }
+            if( mReplayTimeOffset + mPendingSample.time > target )
+                break;
+            deliverReplaySample( mPendingSample );
+            mHasPendingSample = false;
+        }
+    }
+    void Device::replayThreadLoop()
+    {
+        double start = OVR::Timer::GetSeconds();
+        SensorSample sample;
+        while( mReplayRunning ){
+            if( ! mSensorSource->nextSample( &sample ) ){
+                if( ! mReplayLoop ){
+                    mReplayFinished = true;
+                    break;
+                }
+                mReplayTimeOffset   = mReplayTime;
+                start               = OVR::Timer::GetSeconds() - mReplayTime;
+                mSensorSource->rewind();
+                continue;
+            }
+            
+            // Wait for the recorded time of the sample
+            if( mReplayMode == REPLAY_REALTIME ){
+                double wait = start + mReplayTimeOffset + sample.time - OVR::Timer::GetSeconds();
+                if( wait > 0.0 )
+                    std::this_thread::sleep_for( std::chrono::microseconds( (int64_t) ( wait * 1000000.0 ) ) );
+            }
+            deliverReplaySample( sample );
+        }
+    }
+    
+    void Device::enablePredictionStats( bool enable )
+    {
+        mPredictionStatsEnabled = enable;
+        if( ! enable )
+            mPendingPredictions.clear();
+    }
+    Device::PredictionStats Device::getPredictionStats() const
+    {
+        PredictionStats stats;
+        stats.numSamples = mNumPredictionErrors;
+        if( mNumPredictionErrors ){
+            stats.meanError = mPredictionErrorSum / mNumPredictionErrors;
+            stats.rmsError  = sqrt( mPredictionErrorSumSq / mNumPredictionErrors );
+            stats.maxError  = mPredictionErrorMax;
+        }
+        return stats;
+    }
+    void Device::resetPredictionStats()
+    {
+        mPendingPredictions.clear();
+        mNumPredictionErrors    = 0;
+        mPredictionErrorSum     = 0.0;
+        mPredictionErrorSumSq   = 0.0;
+        mPredictionErrorMax     = 0.0f;
+    }
+    void Device::updatePredictionStats( double time, const Quatf &measured )
+    {
+        // Compare the predictions that reached their target time with what is measured now
+        while( ! mPendingPredictions.empty() && mPendingPredictions.front().time <= time ){
+            float error = toDegrees( angleBetween( mPendingPredictions.front().orientation, measured ) );
+            mNumPredictionErrors++;
+            mPredictionErrorSum     += error;
+            mPredictionErrorSumSq   += error * error;
+            mPredictionErrorMax     = std::max( mPredictionErrorMax, error );
+            mPendingPredictions.pop_front();
+        }
+    }
     
     
-    // Shader with lens distortion and chromatic aberration correction.
-    static const char* PostProcessFullFragShaderSrc =
-    "uniform vec2 LensCenter;\n"
-    "uniform vec2 ScreenCenter;\n"
-    "uniform vec2 Scale;\n"
-    "uniform vec2 ScaleIn;\n"
-    "uniform vec4 HmdWarpParam;\n"
-    "uniform vec4 ChromAbParam;\n"
-    "uniform sampler2D Texture0;\n"
-    "\n"
-    // Scales input texture coordinates for distortion.
-    // ScaleIn maps texture coordinates to Scales to ([-1, 1]), although top/bottom will be
-    // larger due to aspect ratio.
-    "void main()\n"
-    "{\n"
-    "   vec2  theta = (gl_TexCoord[0].st - LensCenter) * ScaleIn;\n" // Scales to [-1, 1]
-    "   float rSq= theta.x * theta.x + theta.y * theta.y;\n"
-    "   vec2  theta1 = theta * (HmdWarpParam.x + HmdWarpParam.y * rSq + "
-    "                  HmdWarpParam.z * rSq * rSq + HmdWarpParam.w * rSq * rSq * rSq);\n"
-    "   \n"
-    "   // Detect whether blue texture coordinates are out of range since these will scaled out the furthest.\n"
-    "   vec2 thetaBlue = theta1 * (ChromAbParam.z + ChromAbParam.w * rSq);\n"
-    "   vec2 tcBlue = LensCenter + Scale * thetaBlue;\n"
-    "   if (!all(equal(clamp(tcBlue, ScreenCenter-vec2(0.25,0.5), ScreenCenter+vec2(0.25,0.5)), tcBlue)))\n"
-    "   {\n"
-    "       gl_FragColor = vec4(0);\n"
-    "       return;\n"
-    "   }\n"
-    "   \n"
-    "   // Now do blue texture lookup.\n"
-    "   float blue = texture2D(Texture0, tcBlue).b;\n"
-    "   \n"
-    "   // Do green lookup (no scaling).\n"
-    "   vec2  tcGreen = LensCenter + Scale * theta1;\n"
-    "   vec4  center = texture2D(Texture0, tcGreen);\n"
-    "   \n"
-    "   // Do red scale and lookup.\n"
-    "   vec2  thetaRed = theta1 * (ChromAbParam.x + ChromAbParam.y * rSq);\n"
-    "   vec2  tcRed = LensCenter + Scale * thetaRed;\n"
-    "   float red = texture2D(Texture0, tcRed).r;\n"
-    "   \n"
-    "   gl_FragColor = vec4(red, center.g, blue, 1);\n"
-    "}\n";
     
+    const Device::EyeRenderDesc& Device::getEyeRenderDesc( Eye eye )
+    {
+        if( mEyeRenderDescsDirty ){
+            const OVR::Util::Render::StereoEye stereoEyes[2] = { OVR::Util::Render::StereoEye_Left, OVR::Util::Render::StereoEye_Right };
+            for( int i = 0; i < 2; i++ ){
+                const OVR::Util::Render::StereoEyeParams &params = mStereoConfig.GetEyeRenderParams( stereoEyes[i] );
+                mEyeRenderDescs[i].viewport         = toCinder( params.VP );
+                mEyeRenderDescs[i].viewAdjust       = toCinder( params.ViewAdjust );
+                mEyeRenderDescs[i].projection       = toCinder( params.Projection );
+                mEyeRenderDescs[i].orthoProjection  = toCinder( params.OrthoProjection );
+            }
+            mEyeRenderDescsDirty = false;
+        }
+        return mEyeRenderDescs[eye];
+    }
+    void Device::invalidateEyeRenderDescs()
+    {
+        mEyeRenderDescsDirty = true;
+        mStereoGeneration++;
+    }
+    void Device::setIPD( float ipd )
+    {
+        mStereoConfig.SetIPD( ipd );
+        invalidateEyeRenderDescs();
+    }
+    void Device::setFullViewport( const Area &viewport )
+    {
+        mStereoConfig.SetFullViewport( OVR::Util::Render::Viewport( viewport.x1, viewport.y1, viewport.getWidth(), viewport.getHeight() ) );
+        invalidateEyeRenderDescs();
+    }
     
     DistortionHelperRef DistortionHelper::create( bool chromaticAbCorrection )
     {
         return DistortionHelperRef( new DistortionHelper( chromaticAbCorrection ) );
     }
+    DistortionHelperRef DistortionHelper::create( const DeviceRef &device, bool chromaticAbCorrection )
+    {
+        DistortionHelperRef helper( new DistortionHelper( chromaticAbCorrection ) );
+        helper->setDevice( device );
+        return helper;
+    }
+    void DistortionHelper::setDevice( const DeviceRef &device )
+    {
+        // The key of the device holds every input of the distortion tables
+        DistortionCache::Key key = device->getDistortionCacheKey( mUseChromaticAbCorrection );
+        setDistortionParams( key.distortionParams );
+        setDistortionScale( key.distortionScale );
+        setChromaticAbCorrection( key.chromaticAbCorrection );
+        setFov( device->getFov() );
+        
+        // Load the mesh of the HMD resolution now rather than on the first frame
+        if( mUseMesh )
+            updateMesh( key );
+    }
     DistortionHelper::DistortionHelper( bool chromaticAbCorrection )
     :
-    mDistortionParams( 1,0.22,0.24,0 ),
-    mDistortionScale( 1.71461f ),
-    mChromaticAbCorrection( 0.996, -0.004, 1.014, 0 ),
-    mUseChromaticAbCorrection( chromaticAbCorrection )
+    mDistortionParams( DK1DistortionParams ),
+    mDistortionScale( DK1DistortionScale ),
+    mChromaticAbCorrection( DK1ChromaticAbCorrection ),
+    mUseChromaticAbCorrection( chromaticAbCorrection ),
+    mUseMesh( false ),
+    mEyeBlocksDirty( true ),
+    mUniformsDirty( true ),
+    mMeshUniformsDirty( true ),
+    mNumGlCalls( 0 ),
+    mTimewarp( false ),
+    mFov( 125.87f ),
+    mMultiRes( false ),
+    mTexCoordScale( 1.0f, 1.0f ),
+    mShaderCache( DistortionShaderCache::create() ),
+    mShadersDirty( true ),
+    mClampMode( DistortionShaderVariant::CLAMP_BLACK )
+    {
+    }
+    
+    DistortionShaderVariant DistortionHelper::getShaderVariant( bool mesh ) const
+    {
+        DistortionShaderVariant variant;
+        variant.mesh                    = mesh;
+        variant.chromaticAbCorrection   = mUseChromaticAbCorrection;
+        variant.timewarp                = mTimewarp;
+        variant.multiRes                = mMultiRes;
+        variant.clampMode               = mClampMode;
+        variant.polynomialOrder         = DistortionShaderVariant::calcPolynomialOrder( mDistortionParams );
+        return variant;
+    }
+    
+    void DistortionHelper::loadShaders()
     {
+        // Both programs of the current features, only built the first time a variant is used
+        ShaderProgramRef shader     = mShaderCache->get( getShaderVariant( false ) );
+        ShaderProgramRef meshShader = mShaderCache->get( getShaderVariant( true ) );
+        mShadersDirty               = false;
+        if( ! shader || ! meshShader )
+            return;
+        mShader                     = shader;
+        mMeshShader                 = meshShader;
         
-        // Load and compile Distortion Shader
-        try {
-            mShader = gl::GlslProg::create( NULL, chromaticAbCorrection ? PostProcessFullFragShaderSrc : PostProcessFragShaderSrc );
-        }
-        catch( gl::GlslProgCompileExc exc ){
-            std::cout << "ovr::DistortionHelper Exception: " << std::endl << exc.what() << std::endl;
+        // Cache the uniform locations once
+        mUniforms.lensCenter    = mShader->getUniformLocation( "LensCenter" );
+        mUniforms.screenCenter  = mShader->getUniformLocation( "ScreenCenter" );
+        mUniforms.scale         = mShader->getUniformLocation( "Scale" );
+        mUniforms.scaleIn       = mShader->getUniformLocation( "ScaleIn" );
+        mUniforms.hmdWarpParam  = mShader->getUniformLocation( "HmdWarpParam" );
+        mUniforms.chromAbParam  = mUseChromaticAbCorrection ? mShader->getUniformLocation( "ChromAbParam" ) : -1;
+        mUniforms.texture0      = mShader->getUniformLocation( "Texture0" );
+        mUniforms.texCoordScale = mShader->getUniformLocation( "TexCoordScale" );
+        mUniforms.timewarpMatrix = mTimewarp ? mShader->getUniformLocation( "TimewarpMatrix" ) : -1;
+        mUniforms.timewarpScale = mTimewarp ? mShader->getUniformLocation( "TimewarpScale" ) : -1;
+        mUniforms.texture1      = mMultiRes ? mShader->getUniformLocation( "Texture1" ) : -1;
+        mUniforms.centerTexCoordsLeft   = mMultiRes ? mShader->getUniformLocation( "CenterTexCoordsLeft" ) : -1;
+        mUniforms.centerTexCoordsRight  = mMultiRes ? mShader->getUniformLocation( "CenterTexCoordsRight" ) : -1;
+        mUniformsDirty          = true;
+        
+        mMeshUniforms.texture0              = mMeshShader->getUniformLocation( "Texture0" );
+        mMeshUniforms.texCoordScale         = mMeshShader->getUniformLocation( "TexCoordScale" );
+        mMeshUniforms.timewarpMatrixLeft    = mTimewarp ? mMeshShader->getUniformLocation( "TimewarpMatrixLeft" ) : -1;
+        mMeshUniforms.timewarpMatrixRight   = mTimewarp ? mMeshShader->getUniformLocation( "TimewarpMatrixRight" ) : -1;
+        mMeshUniforms.lensCenterLeft        = mTimewarp ? mMeshShader->getUniformLocation( "LensCenterLeft" ) : -1;
+        mMeshUniforms.lensCenterRight       = mTimewarp ? mMeshShader->getUniformLocation( "LensCenterRight" ) : -1;
+        mMeshUniforms.timewarpScale         = mTimewarp ? mMeshShader->getUniformLocation( "TimewarpScale" ) : -1;
+        mMeshUniforms.texture1              = mMultiRes ? mMeshShader->getUniformLocation( "Texture1" ) : -1;
+        mMeshUniforms.centerTexCoordsLeft   = mMultiRes ? mMeshShader->getUniformLocation( "CenterTexCoordsLeft" ) : -1;
+        mMeshUniforms.centerTexCoordsRight  = mMultiRes ? mMeshShader->getUniformLocation( "CenterTexCoordsRight" ) : -1;
+        mMeshUniformsDirty      = true;
+    }
+    
+    void DistortionHelper::precompileShaders()
+    {
+        // Every combination render() switches between, so toggling them later never compiles anything
+        DistortionShaderVariant variant = getShaderVariant( false );
+        for( int i = 0; i < 8; i++ ){
+            variant.mesh        = ( i & 1 ) != 0;
+            variant.timewarp    = ( i & 2 ) != 0;
+            variant.multiRes    = ( i & 4 ) != 0;
+            mShaderCache->get( variant );
         }
     }
     
+    void DistortionHelper::setClampMode( DistortionShaderVariant::ClampMode mode )
+    {
+        if( mClampMode == mode )
+            return;
+        mClampMode      = mode;
+        mShadersDirty   = true;
+    }
+    void DistortionHelper::setCacheDirectory( const fs::path &directory )
+    {
+        mCacheDirectory = directory;
+        mShaderCache->setBinaryDirectory( directory );
+    }
+    
+    void DistortionHelper::enableTimewarp( bool enable )
+    {
+        if( mTimewarp == enable )
+            return;
+        mTimewarp       = enable;
+        mShadersDirty   = true;
+    }
+    void DistortionHelper::setRenderOrientations( const Quatf &left, const Quatf &right )
+    {
+        mRenderOrientations[EYE_LEFT]   = left;
+        mRenderOrientations[EYE_RIGHT]  = right;
+    }
+    void DistortionHelper::setLatestOrientation( const Quatf &latest )
+    {
+        mLatestOrientation = latest;
+    }
+    void DistortionHelper::calcTimewarpMatrix( Eye eye, float m[9] ) const
+    {
+        toRotationMatrix( calcTimewarpDelta( mRenderOrientations[eye], mLatestOrientation ), m );
+    }
+    
     void DistortionHelper::render( const gl::TextureRef &texture, const Rectf &rect )
     {
         render( *texture, rect );
     }
     void DistortionHelper::render( const gl::Texture &texture, const Rectf &rect )
     {
-        float w                         = 0.5f;
-        float h                         = 1.0f;
-        float x                         = 0.0f;
-        float y                         = 0.0f;
-        float as                        = ( (float) rect.getWidth() * 0.5f ) / (float) rect.getHeight();
-        float distortionXCenterOffset   = 0.25f / mDistortionScale;
-        float scaleFactor               = 1.0f / mDistortionScale;
-        
-        mShader->bind();
-        mShader->uniform( "LensCenter", Vec2f( x + (w + distortionXCenterOffset * 0.5f)*0.5f, y + h*0.5f ) );
-        mShader->uniform( "ScreenCenter", Vec2f( x + w*0.5f, y + h*0.5f ) );
-        
-        mShader->uniform( "Scale", Vec2f( (w/2) * scaleFactor, (h/2) * scaleFactor * as ) );
-        mShader->uniform( "ScaleIn", Vec2f( (2/w),               (2/h) / as ) );
-        mShader->uniform( "HmdWarpParam", mDistortionParams );
-
-        if( mUseChromaticAbCorrection )
-            mShader->uniform( "ChromAbParam", mChromaticAbCorrection );
+        render( texture, rect, Vec2f( 1.0f, 1.0f ) );
+    }
+    void DistortionHelper::render( const gl::Texture &texture, const Rectf &rect, const Vec2f &texCoordScale )
+    {
+        enableMultiRes( false );
+        setTexCoordScale( texCoordScale );
+        renderTexture( texture, rect );
+    }
+    void DistortionHelper::render( const MultiResTargetRef &target, const Rectf &rect )
+    {
+        // The periphery covers the whole eyes and takes the place of the single texture
+        enableMultiRes( true );
+        setTexCoordScale( Vec2f( 1.0f, 1.0f ) );
+        mMultiResTarget = target;
+        renderTexture( target->getPeripheryTexture(), rect );
+        mMultiResTarget.reset();
+    }
+    void DistortionHelper::setTexCoordScale( const Vec2f &scale )
+    {
+        if( scale == mTexCoordScale )
+            return;
+        mTexCoordScale      = scale;
+        mUniformsDirty      = true;
+        mMeshUniformsDirty  = true;
+    }
+    void DistortionHelper::renderTexture( const gl::Texture &texture, const Rectf &rect )
+    {
+        if( mShadersDirty )
+            loadShaders();
+        if( ! mShader || ! mMeshShader )
+            return;
+        if( mUseMesh )
+            renderMesh( texture, rect );
+        else
+            renderPerPixel( texture, rect );
+    }
+    
+    void DistortionHelper::enableMultiRes( bool enable )
+    {
+        if( mMultiRes == enable )
+            return;
+        mMultiRes       = enable;
+        mShadersDirty   = true;
+    }
+    void DistortionHelper::bindCenterTexture( GLint texture1, GLint centerTexCoordsLeft, GLint centerTexCoordsRight )
+    {
+        const Rectf &left   = mMultiResTarget->getCenterTexCoords( EYE_LEFT );
+        const Rectf &right  = mMultiResTarget->getCenterTexCoords( EYE_RIGHT );
+        OVR_GL_COUNT( glUniform1i( texture1, 1 ) );
+        OVR_GL_COUNT( glUniform4f( centerTexCoordsLeft, left.x1, left.y1, left.x2, left.y2 ) );
+        OVR_GL_COUNT( glUniform4f( centerTexCoordsRight, right.x1, right.y1, right.x2, right.y2 ) );
+        OVR_GL_COUNT( mMultiResTarget->getCenterTexture().bind( 1 ) );
+    }
+    void DistortionHelper::unbindCenterTexture()
+    {
+        OVR_GL_COUNT( mMultiResTarget->getCenterTexture().unbind( 1 ) );
+    }
+    
+    void DistortionHelper::renderPerPixel( const gl::Texture &texture, const Rectf &rect )
+    {
+        mNumGlCalls = 0;
+        updateEyeBlocks( texture, rect );
+        
+        OVR_GL_COUNT( mShader->bind() );
+        
+        // Per-frame constant uniforms only need to be sent when they changed
+        if( mUniformsDirty ){
+            const EyeWarpParams &params = mEyeBlocks[EYE_LEFT].params;
+            OVR_GL_COUNT( glUniform2f( mUniforms.scale, params.scale.x, params.scale.y ) );
+            OVR_GL_COUNT( glUniform2f( mUniforms.scaleIn, params.scaleIn.x, params.scaleIn.y ) );
+            OVR_GL_COUNT( glUniform4f( mUniforms.hmdWarpParam, mDistortionParams.x, mDistortionParams.y, mDistortionParams.z, mDistortionParams.w ) );
+            if( mUseChromaticAbCorrection )
+                OVR_GL_COUNT( glUniform4f( mUniforms.chromAbParam, mChromaticAbCorrection.x, mChromaticAbCorrection.y, mChromaticAbCorrection.z, mChromaticAbCorrection.w ) );
+            OVR_GL_COUNT( glUniform1i( mUniforms.texture0, 0 ) );
+            OVR_GL_COUNT( glUniform2f( mUniforms.texCoordScale, mTexCoordScale.x, mTexCoordScale.y ) );
+            if( mTimewarp ){
+                Vec2f timewarpScale = calcTimewarpScale( ( rect.getWidth() * 0.5f ) / rect.getHeight(), mFov );
+                OVR_GL_COUNT( glUniform2f( mUniforms.timewarpScale, timewarpScale.x, timewarpScale.y ) );
+            }
+            mUniformsDirty = false;
+        }
+        
+        OVR_GL_COUNT( glActiveTexture( GL_TEXTURE0 ) );
+        OVR_GL_COUNT( glBindTexture( texture.getTarget(), texture.getId() ) );
+        if( mMultiResTarget )
+            bindCenterTexture( mUniforms.texture1, mUniforms.centerTexCoordsLeft, mUniforms.centerTexCoordsRight );
+        
+        // Each eye is drawn as its own half quad, no need for a scissor
+        OVR_GL_COUNT( glEnableClientState( GL_VERTEX_ARRAY ) );
+        OVR_GL_COUNT( glEnableClientState( GL_TEXTURE_COORD_ARRAY ) );
+        for( int eye = 0; eye < 2; eye++ ){
+            const EyeBlock &block = mEyeBlocks[eye];
+            OVR_GL_COUNT( glUniform2f( mUniforms.lensCenter, block.params.lensCenter.x, block.params.lensCenter.y ) );
+            OVR_GL_COUNT( glUniform2f( mUniforms.screenCenter, block.params.screenCenter.x, block.params.screenCenter.y ) );
+            if( mTimewarp ){
+                float m[9];
+                calcTimewarpMatrix( (Eye) eye, m );
+                OVR_GL_COUNT( glUniformMatrix3fv( mUniforms.timewarpMatrix, 1, GL_FALSE, m ) );
+            }
+            OVR_GL_COUNT( glVertexPointer( 2, GL_FLOAT, 0, &block.positions[0].x ) );
+            OVR_GL_COUNT( glTexCoordPointer( 2, GL_FLOAT, 0, &block.texCoords[0].x ) );
+            OVR_GL_COUNT( glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 ) );
+        }
+        OVR_GL_COUNT( glDisableClientState( GL_TEXTURE_COORD_ARRAY ) );
+        OVR_GL_COUNT( glDisableClientState( GL_VERTEX_ARRAY ) );
+        
+        if( mMultiResTarget )
+            unbindCenterTexture();
+        OVR_GL_COUNT( glBindTexture( texture.getTarget(), 0 ) );
+        OVR_GL_COUNT( mShader->unbind() );
+    }
+    
+    void DistortionHelper::updateEyeBlocks( const gl::Texture &texture, const Rectf &rect )
+    {
+        Rectf texCoords = texture.getAreaTexCoords( Area( 0, 0, texture.getCleanWidth(), texture.getCleanHeight() ) );
+        if( ! mEyeBlocksDirty && isSameRect( mEyeBlocksRect, rect ) && isSameRect( mEyeBlocksTexCoords, texCoords ) )
+            return;
+        
+        float as = ( (float) rect.getWidth() * 0.5f ) / (float) rect.getHeight();
+        for( int eye = 0; eye < 2; eye++ ){
+            EyeBlock &block     = mEyeBlocks[eye];
+            block.params        = EyeWarpParams::calc( (Eye) eye, as, mDistortionScale );
+            
+            // Same split as the former glScissor
+            float x1            = rect.x1 + rect.getWidth() * 0.5f * eye;
+            float x2            = x1 + rect.getWidth() * 0.5f;
+            float u1            = texCoords.x1 + texCoords.getWidth() * 0.5f * eye;
+            float u2            = u1 + texCoords.getWidth() * 0.5f;
+            block.positions[0]  = Vec2f( x1, rect.y1 ); block.texCoords[0] = Vec2f( u1, texCoords.y1 );
+            block.positions[1]  = Vec2f( x1, rect.y2 ); block.texCoords[1] = Vec2f( u1, texCoords.y2 );
+            block.positions[2]  = Vec2f( x2, rect.y1 ); block.texCoords[2] = Vec2f( u2, texCoords.y1 );
+            block.positions[3]  = Vec2f( x2, rect.y2 ); block.texCoords[3] = Vec2f( u2, texCoords.y2 );
+        }
+        
+        mEyeBlocksRect      = rect;
+        mEyeBlocksTexCoords = texCoords;
+        mEyeBlocksDirty     = false;
+        mUniformsDirty      = true;
+        mMeshUniformsDirty  = true;
+    }
+    
+    void DistortionHelper::setDistortionParams( const Vec4f &params )
+    {
+        // Coefficients becoming zero or non zero change the polynomial the shader evaluates
+        if( DistortionShaderVariant::calcPolynomialOrder( params ) != DistortionShaderVariant::calcPolynomialOrder( mDistortionParams ) )
+            mShadersDirty = true;
+        mDistortionParams   = params;
+        mEyeBlocksDirty     = true;
+        mMesh.reset();
+    }
+    void DistortionHelper::setDistortionScale( float scale )
+    {
+        mDistortionScale    = scale;
+        mEyeBlocksDirty     = true;
+        mMesh.reset();
+    }
+    void DistortionHelper::setChromaticAbCorrection( const Vec4f &params )
+    {
+        mChromaticAbCorrection  = params;
+        mEyeBlocksDirty         = true;
+        mMesh.reset();
+    }
+    
+    void DistortionHelper::renderMesh( const gl::Texture &texture, const Rectf &rect )
+    {
+        mNumGlCalls = 0;
+        updateMesh( getDistortionCacheKey( Vec2i( rect.getWidth(), rect.getHeight() ) ) );
+        // Only the lens centers of the eye blocks are used, they're the centers of the timewarp rotation
+        updateEyeBlocks( texture, rect );
         
-        texture.enableAndBind();
-        mShader->uniform( "Texture0", 0 );
+        OVR_GL_COUNT( mMeshShader->bind() );
+        OVR_GL_COUNT( texture.enableAndBind() );
         
-        glEnable( GL_SCISSOR_TEST );
-        glScissor( 0, 0, rect.getWidth() * 0.5f, rect.getHeight() );
-        gl::draw(texture, rect);
-      
-        distortionXCenterOffset = -0.25f / mDistortionScale;
-        scaleFactor             = 1.0f / mDistortionScale;
-        x                       = 0.5f;
+        // Per-frame constant uniforms only need to be sent when they changed
+        if( mMeshUniformsDirty ){
+            OVR_GL_COUNT( glUniform1i( mMeshUniforms.texture0, 0 ) );
+            OVR_GL_COUNT( glUniform2f( mMeshUniforms.texCoordScale, mTexCoordScale.x, mTexCoordScale.y ) );
+            if( mTimewarp ){
+                const Vec2f &left   = mEyeBlocks[EYE_LEFT].params.lensCenter;
+                const Vec2f &right  = mEyeBlocks[EYE_RIGHT].params.lensCenter;
+                Vec2f timewarpScale = calcTimewarpScale( ( rect.getWidth() * 0.5f ) / rect.getHeight(), mFov );
+                OVR_GL_COUNT( glUniform2f( mMeshUniforms.lensCenterLeft, left.x, left.y ) );
+                OVR_GL_COUNT( glUniform2f( mMeshUniforms.lensCenterRight, right.x, right.y ) );
+                OVR_GL_COUNT( glUniform2f( mMeshUniforms.timewarpScale, timewarpScale.x, timewarpScale.y ) );
+            }
+            mMeshUniformsDirty = false;
+        }
         
-        mShader->uniform( "LensCenter", Vec2f( x + (w + distortionXCenterOffset * 0.5f)*0.5f, y + h*0.5f ) );
-        mShader->uniform( "ScreenCenter", Vec2f( x + w*0.5f, y + h*0.5f ) );
-        mShader->uniform( "Scale", Vec2f( (w/2) * scaleFactor, (h/2) * scaleFactor * as ) );
+        if( mMultiResTarget )
+            bindCenterTexture( mMeshUniforms.texture1, mMeshUniforms.centerTexCoordsLeft, mMeshUniforms.centerTexCoordsRight );
+        if( mTimewarp ){
+            float left[9], right[9];
+            calcTimewarpMatrix( EYE_LEFT, left );
+            calcTimewarpMatrix( EYE_RIGHT, right );
+            OVR_GL_COUNT( glUniformMatrix3fv( mMeshUniforms.timewarpMatrixLeft, 1, GL_FALSE, left ) );
+            OVR_GL_COUNT( glUniformMatrix3fv( mMeshUniforms.timewarpMatrixRight, 1, GL_FALSE, right ) );
+        }
         
-        glScissor( rect.getWidth() * 0.5f, 0, rect.getWidth(), rect.getHeight() );
-        gl::draw(texture, rect);
-        glDisable( GL_SCISSOR_TEST );
+        // The mesh is built in texture space, so flip it
+        // the same way gl::draw would flip the texture
+        gl::pushModelView();
+        if( texture.isFlipped() ){
+            gl::translate( Vec2f( rect.x1, rect.y2 ) );
+            gl::scale( rect.getWidth(), -rect.getHeight() );
+        }
+        else {
+            gl::translate( Vec2f( rect.x1, rect.y1 ) );
+            gl::scale( rect.getWidth(), rect.getHeight() );
+        }
+        OVR_GL_COUNT( gl::draw( mVboMesh ) );
+        gl::popModelView();
         
-        texture.unbind();
-        mShader->unbind();
+        if( mMultiResTarget )
+            unbindCenterTexture();
+        OVR_GL_COUNT( texture.unbind() );
+        OVR_GL_COUNT( mMeshShader->unbind() );
+    }
+    
+    DistortionCache::Key DistortionHelper::getDistortionCacheKey( const Vec2i &resolution ) const
+    {
+        DistortionCache::Key key;
+        key.distortionParams            = mDistortionParams;
+        key.distortionScale             = mDistortionScale;
+        key.chromaticAbCorrection       = mChromaticAbCorrection;
+        key.useChromaticAbCorrection    = mUseChromaticAbCorrection;
+        key.resolution                  = resolution;
+        return key;
+    }
+    
+    void DistortionHelper::updateMesh( const DistortionCache::Key &key )
+    {
+        if( mMesh && mMeshResolution == key.resolution )
+            return;
         
+        // Use the on-disk cache if there's one, it regenerates the mesh itself if needed
+        mMeshResolution = key.resolution;
+        if( ! mCacheDirectory.empty() )
+            mMesh = DistortionCache::loadOrGenerate( mCacheDirectory, key );
+        else
+            mMesh = DistortionMesh::create( key.distortionParams, key.distortionScale, key.chromaticAbCorrection, key.useChromaticAbCorrection, ( (float) key.resolution.x * 0.5f ) / (float) key.resolution.y, key.columns, key.rows );
+        
+        // Split the vertices in separate attributes, the left eye is the first half of the vertices and the red tells them apart
+        const std::vector<DistortionMesh::Vertex>& vertices = mMesh->getVertices();
+        std::vector<Vec3f>  positions;
+        std::vector<ColorA> colors;
+        std::vector<Vec2f>  texCoordsRed, texCoordsGreen, texCoordsBlue;
+        for( std::vector<DistortionMesh::Vertex>::const_iterator it = vertices.begin(); it != vertices.end(); ++it ){
+            float eye = ( it - vertices.begin() ) < (ptrdiff_t) vertices.size() / 2 ? 0.0f : 1.0f;
+            positions.push_back( Vec3f( it->position, 0.0f ) );
+            colors.push_back( ColorA( eye, 1.0f, 1.0f, 1.0f ) );
+            texCoordsRed.push_back( it->texCoordRed );
+            texCoordsGreen.push_back( it->texCoordGreen );
+            texCoordsBlue.push_back( it->texCoordBlue );
+        }
+        
+        gl::VboMesh::Layout layout;
+        layout.setStaticIndices();
+        layout.setStaticPositions();
+        layout.setStaticColorsRGBA();
+        layout.setStaticTexCoords2d( 0 );
+        if( mUseChromaticAbCorrection ){
+            layout.setStaticTexCoords2d( 1 );
+            layout.setStaticTexCoords2d( 2 );
+        }
+        
+        mVboMesh = gl::VboMesh::create( vertices.size(), mMesh->getIndices().size(), layout, GL_TRIANGLES );
+        mVboMesh->bufferIndices( mMesh->getIndices() );
+        mVboMesh->bufferPositions( positions );
+        mVboMesh->bufferColorsRGBA( colors );
+        if( mUseChromaticAbCorrection ){
+            mVboMesh->bufferTexCoords2d( 0, texCoordsRed );
+            mVboMesh->bufferTexCoords2d( 1, texCoordsGreen );
+            mVboMesh->bufferTexCoords2d( 2, texCoordsBlue );
+        }
+        else mVboMesh->bufferTexCoords2d( 0, texCoordsGreen );
     }
     
 }
\ No newline at end of file
@@ -13,6 +13,26 @@
 
 #include "cinder/gl/Texture.h"
 #include "cinder/gl/GlslProg.h"
+#include "cinder/gl/Vbo.h"
+
+#include "DistortionMesh.h"
+#include "DistortionCache.h"
+#include "DistortionShaders.h"
+#include "FusionEngine.h"
+#include "MultiResTarget.h"
+#include "OvrSystem.h"
+#include "Pose.h"
+#include "PoseHistory.h"
+#include "PoseRing.h"
+#include "SensorStream.h"
+#include "SyntheticSensor.h"
+#include "Timewarp.h"
+
+#include <atomic>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
 
 
 namespace ovr {
@@ -47,8 +67,28 @@ namespace ovr {
     class Device
     {
     public:
-        // ! Returns an empty ptr if we can't initialize correctly the HMD device
+        //! How a recording is played back
+        enum ReplayMode {
+            //! Samples are delivered at the pace they were recorded
+            REPLAY_REALTIME,
+            //! Samples are delivered as fast as possible on the replay thread
+            REPLAY_UNTHROTTLED,
+            //! Samples are only delivered by advanceReplay(), on the calling thread
+            REPLAY_MANUAL
+        };
+        
+        // ! Returns an empty ptr if we can't initialize correctly the HMD device.
+        //! Setting CINDER_OVR_DEVICE to "synthetic" or "replay:<path>" returns the matching headless Device instead
         static DeviceRef create();
+        //! Runs create() on a background thread, the enumeration and the sensor attachment no longer hold the first frame. Poll the
+        //! future with wait_for( 0 ) each frame and pick the Device up once it's ready, it holds an empty ptr if there's no HMD
+        static std::future<DeviceRef> createAsync();
+        //! Returns a Device driven by a recording made with startRecording(), or an empty ptr if the file isn't valid
+        static DeviceRef createFromRecording( const ci::fs::path &path, ReplayMode mode = REPLAY_REALTIME, bool loop = true );
+        //! Returns a Device driven by any stream of samples, without hardware
+        static DeviceRef createFromSource( const SensorSourceRef &source, ReplayMode mode = REPLAY_REALTIME, bool loop = true );
+        //! Returns a DK1 following the parametric motion described by \a options
+        static DeviceRef createSynthetic( const SyntheticSensor::Options &options = SyntheticSensor::Options(), ReplayMode mode = REPLAY_REALTIME );
         ~Device();
         
         //! Returns the Inter-Pupilary Distance
@@ -63,30 +103,184 @@ namespace ovr {
         float       getDistortionScale();
         //! Returns the 4 values used by the distortion correction
         ci::Vec4f   getDistortionParams() const;
+        //! Returns the 4 values used by the chromatic aberration correction
+        ci::Vec4f   getChromaticAbParams() const;
+        //! Returns the resolution of the HMD screen
+        ci::Vec2i   getResolution() const;
+        //! Returns the key identifying the distortion tables of this HMD in a DistortionCache
+        DistortionCache::Key getDistortionCacheKey( bool chromaticAbCorrection = true );
         
+        //! Returns the latest timestamped pose, from the sensor thread if it runs
+        Pose        getPose();
         //! Returns Device Orientation
         ci::Quatf   getOrientation();
+        //! Returns Device angular velocity in radians per second
+        ci::Vec3f   getAngularVelocity();
+        
+        //! Returns the orientation predicted \a secondsAhead in the future from the current angular velocity
+        ci::Quatf   getPredictedOrientation( float secondsAhead );
+        //! Returns the orientation predicted with the default horizon. Meant to be called once per frame, the interval between calls is the measured frame time
+        ci::Quatf   getPredictedOrientation();
+        //! Overrides the default prediction horizon, a negative value goes back to the horizon derived from the frame time
+        void        setPredictionHorizon( float seconds ) { mPredictionHorizon = seconds; }
+        //! Returns the default prediction horizon in seconds
+        float       getPredictionHorizon() const;
+        //! Sets how many measured frames the derived horizon covers, 2 by default
+        void        setPredictionFrames( float frames ) { mPredictionFrames = frames; }
+        //! Returns the smoothed interval between two calls to getPredictedOrientation()
+        float       getMeasuredFrameTime() const { return mFrameTime; }
+        
+        //! Starts a thread publishing the fused pose \a rateHz times per second. Readers then never touch the OVR objects
+        void        startSensorThread( float rateHz = 1000.0f );
+        void        stopSensorThread();
+        //! Can be called from any thread, start and stop the thread from a single one
+        bool        isSensorThreadRunning() const { return mSensorThreadRunning.load(); }
+        //! Copies the latest pose published by the sensor thread, never blocks. Can be called from any thread
+        bool        getLatestPose( Pose *pose ) const { return mPoseRing.getLatest( pose ); }
+        //! Copies up to \a maxPoses of the latest published poses, newest first, never blocks. Can be called from any thread
+        size_t      getPoseHistory( Pose *poses, size_t maxPoses ) const { return mPoseRing.getHistory( poses, maxPoses ); }
+        //! Appends to \a history the poses published since its newest one and returns how many. Call it at least every 255 sensor updates, the size of the ring, to keep them all.
+        //! Call it from one thread at a time, it reuses a scratch buffer
+        size_t      updatePoseHistory( PoseHistory *history ) const;
+        
+        //! Feeds the sensor samples to \a engine instead of OVR::SensorFusion, an empty ptr goes back to OVR::SensorFusion. The pose starts again from the identity
+        void        setFusionEngine( const FusionEngineRef &engine );
+        //! Returns the engine set with setFusionEngine(), empty while OVR::SensorFusion runs
+        const FusionEngineRef& getFusionEngine() const { return mFusionEngine; }
+        
+        //! Starts writing the raw sensor samples and the HMD description to \a path. Returns false if there's no sensor or the file can't be created
+        bool        startRecording( const ci::fs::path &path );
+        void        stopRecording();
+        bool        isRecording() const { return (bool) mRecorder; }
+        
+        //! Returns whether the Device plays a recording or a synthetic stream instead of a physical HMD
+        bool        isReplay() const { return (bool) mSensorSource; }
+        //! Returns the stream driving the Device, empty with a physical HMD
+        const SensorSourceRef& getSensorSource() const { return mSensorSource; }
+        //! Delivers the samples of the next \a seconds to the sensor fusion. Only used with REPLAY_MANUAL
+        void        advanceReplay( double seconds );
+        //! Returns the recording time of the last delivered sample
+        double      getReplayTime() const { return mReplayTime; }
+        //! Returns whether a replay that doesn't loop delivered all its samples
+        bool        isReplayFinished() const { return mReplayFinished; }
+        
+        //! Error between predicted orientations and the orientations measured once their target time is reached, in degrees
+        struct PredictionStats {
+            PredictionStats() : numSamples( 0 ), meanError( 0 ), rmsError( 0 ), maxError( 0 ) {}
+            size_t  numSamples;
+            float   meanError;
+            float   rmsError;
+            float   maxError;
+        };
+        //! Starts comparing each prediction with the orientation measured at its target time
+        void            enablePredictionStats( bool enable = true );
+        //! Returns the prediction error measured so far
+        PredictionStats getPredictionStats() const;
+        void            resetPredictionStats();
+        
+        //! Viewport, view adjust and projections of one eye, already converted to Cinder types
+        struct EyeRenderDesc {
+            ci::Area        viewport;
+            ci::Matrix44f   viewAdjust;
+            ci::Matrix44f   projection;
+            ci::Matrix44f   orthoProjection;
+        };
+        //! Returns the cached descriptor of \a eye, recomputed only after the stereo configuration changed
+        const EyeRenderDesc& getEyeRenderDesc( Eye eye );
+        //! Incremented each time the stereo configuration changes, compare it with a stored value to know if the descriptors must be fetched again
+        uint32_t        getStereoGeneration() const { return mStereoGeneration; }
+        
+        //! Overrides the Inter-Pupilary Distance of the HMD
+        void            setIPD( float ipd );
+        //! Sets the area of the window used by both eyes, the full HMD resolution by default
+        void            setFullViewport( const ci::Area &viewport );
         
         // not tested...
-        ci::Area        getLeftEyeViewport();
-        ci::Matrix44f   getLeftEyeViewAdjust();
-        ci::Matrix44f   getLeftEyeProjection();
-        ci::Matrix44f   getLeftEyeOrthoProjection();
+        ci::Area        getLeftEyeViewport() { return getEyeRenderDesc( EYE_LEFT ).viewport; }
+        ci::Matrix44f   getLeftEyeViewAdjust() { return getEyeRenderDesc( EYE_LEFT ).viewAdjust; }
+        ci::Matrix44f   getLeftEyeProjection() { return getEyeRenderDesc( EYE_LEFT ).projection; }
+        ci::Matrix44f   getLeftEyeOrthoProjection() { return getEyeRenderDesc( EYE_LEFT ).orthoProjection; }
         
-        ci::Area        getRightEyeViewport();
-        ci::Matrix44f   getRightEyeViewAdjust();
-        ci::Matrix44f   getRightEyeProjection();
-        ci::Matrix44f   getRightEyeOrthoProjection();
+        ci::Area        getRightEyeViewport() { return getEyeRenderDesc( EYE_RIGHT ).viewport; }
+        ci::Matrix44f   getRightEyeViewAdjust() { return getEyeRenderDesc( EYE_RIGHT ).viewAdjust; }
+        ci::Matrix44f   getRightEyeProjection() { return getEyeRenderDesc( EYE_RIGHT ).projection; }
+        ci::Matrix44f   getRightEyeOrthoProjection() { return getEyeRenderDesc( EYE_RIGHT ).orthoProjection; }
         
     protected:
         Device();
+        Device( const OVR::HMDInfo &info );
+        
+        //! Records the sensor messages and forwards them to the sensor fusion or the fusion engine
+        class RecordingHandler : public OVR::MessageHandler {
+        public:
+            RecordingHandler( Device *device ) : mDevice( device ) {}
+            virtual void OnMessage( const OVR::Message &msg );
+            virtual bool SupportsMessageType( OVR::MessageType type ) const { return type == OVR::Message_BodyFrame; }
+        protected:
+            Device* mDevice;
+        };
+        
+        void    initDefaults();
+        void    replayThreadLoop();
+        void    deliverReplaySample( const SensorSample &sample );
+        //! Feeds \a sample to the fusion engine, returns false if there's none and OVR::SensorFusion needs it
+        bool    processFusionEngine( const SensorSample &sample );
       
+        //! Declared first, OVR::System outlives the OVR objects below. The sensor fusion needs it even without hardware
+        OvrSystemGuard                  mSystemGuard;
         OVR::Ptr<OVR::DeviceManager>    mManager;
         OVR::Ptr<OVR::HMDDevice>        mHMD;
         OVR::HMDInfo                    mHMDInfo;
         std::shared_ptr<OVR::SensorFusion> mSensorFusion;
+        FusionEngineRef                 mFusionEngine;
+        //! Guards mFusionEngine, fed from the OVR or replay thread and read from the others
+        std::mutex                      mFusionMutex;
         OVR::Ptr<OVR::SensorDevice>     mSensorDevice;
         OVR::Util::Render::StereoConfig mStereoConfig;
+        
+        void    invalidateEyeRenderDescs();
+        
+        EyeRenderDesc       mEyeRenderDescs[2];
+        bool                mEyeRenderDescsDirty;
+        uint32_t            mStereoGeneration;
+        
+        void    updatePredictionStats( double time, const ci::Quatf &measured );
+        Pose    readPose();
+        void    sensorThreadLoop();
+        
+        float               mPredictionHorizon;
+        float               mPredictionFrames;
+        float               mFrameTime;
+        double              mLastFrameTimeStamp;
+        bool                mPredictionStatsEnabled;
+        std::deque<Pose>    mPendingPredictions;
+        size_t              mNumPredictionErrors;
+        double              mPredictionErrorSum;
+        double              mPredictionErrorSumSq;
+        float               mPredictionErrorMax;
+        
+        PoseRing            mPoseRing;
+        //! Poses copied out of the ring by updatePoseHistory(), allocated once
+        mutable std::vector<Pose> mPoseHistoryScratch;
+        std::thread         mSensorThread;
+        std::atomic<bool>   mSensorThreadRunning;
+        float               mSensorThreadRate;
+        
+        RecordingHandler    mRecordingHandler;
+        SensorRecorderRef   mRecorder;
+        //! Guards mRecorder, written by the OVR thread and replaced by the main thread. Only the main thread reads it without the lock
+        std::mutex          mRecorderMutex;
+        SensorSourceRef     mSensorSource;
+        ReplayMode          mReplayMode;
+        bool                mReplayLoop;
+        SensorSample        mPendingSample;
+        bool                mHasPendingSample;
+        double              mReplayTimeOffset;
+        std::atomic<double> mReplayTime;
+        std::atomic<bool>   mReplayFinished;
+        std::atomic<bool>   mReplayRunning;
+        std::thread         mReplayThread;
+        std::mutex          mReplayMutex;
     };
     
     
@@ -98,21 +292,137 @@ namespace ovr {
     public:
         //! Returns a shared_ptr DistortionHelper
         static DistortionHelperRef create( bool chromaticAbCorrection = true );
+        //! Returns a shared_ptr DistortionHelper using the distortion parameters of \a device
+        static DistortionHelperRef create( const DeviceRef &device, bool chromaticAbCorrection = true );
+        //! Takes the distortion parameters and the fov of \a device, for an HMD picked up after the helper was created.
+        //! In mesh mode the mesh of the HMD resolution is loaded from the cache directory right away
+        void    setDevice( const DeviceRef &device );
         
         //! Returns fullscreen quad with both distorted eyes from a gl::TextureRef
         void render( const ci::gl::TextureRef &texture, const ci::Rectf &rect = ci::Rectf( ci::Vec2f(0,0), ci::Vec2f(1280,800) ) );
         //! Returns fullscreen quad with both distorted eyes from a gl::Texture
         void render( const ci::gl::Texture &texture, const ci::Rectf &rect = ci::Rectf( ci::Vec2f(0,0), ci::Vec2f(1280,800) )  );
+        //! Returns fullscreen quad with both distorted eyes from the bottom left \a texCoordScale part of a gl::Texture, see ResolutionController
+        void render( const ci::gl::Texture &texture, const ci::Rectf &rect, const ci::Vec2f &texCoordScale );
+        //! Returns fullscreen quad with both distorted eyes recomposed from the center and periphery of a MultiResTarget
+        void render( const MultiResTargetRef &target, const ci::Rectf &rect = ci::Rectf( ci::Vec2f(0,0), ci::Vec2f(1280,800) ) );
+        
+        //! Enables the precomputed distortion mesh instead of the per-pixel shader
+        void    setUseMesh( bool useMesh = true ) { mUseMesh = useMesh; }
+        //! Returns whether the precomputed distortion mesh is used
+        bool    isUsingMesh() const { return mUseMesh; }
+        //! Returns the current distortion mesh, null until the first render in mesh mode
+        const DistortionMeshRef& getMesh() const { return mMesh; }
+        //! Returns the key of the distortion tables of the current parameters for an output of \a resolution
+        DistortionCache::Key getDistortionCacheKey( const ci::Vec2i &resolution ) const;
+        
+        void        setDistortionParams( const ci::Vec4f &params );
+        ci::Vec4f   getDistortionParams() const { return mDistortionParams; }
+        void        setDistortionScale( float scale );
+        float       getDistortionScale() const { return mDistortionScale; }
+        void        setChromaticAbCorrection( const ci::Vec4f &params );
+        ci::Vec4f   getChromaticAbCorrection() const { return mChromaticAbCorrection; }
+        bool        isUsingChromaticAbCorrection() const { return mUseChromaticAbCorrection; }
+        
+        //! Returns the number of GL calls issued by the last render
+        uint32_t    getNumGlCalls() const { return mNumGlCalls; }
+        
+        //! Enables the reprojection of each eye from the orientation it was rendered with to the latest orientation
+        void        enableTimewarp( bool enable = true );
+        bool        isTimewarpEnabled() const { return mTimewarp; }
+        //! Sets the head orientation each eye of the next rendered texture was rendered with
+        void        setRenderOrientations( const ci::Quatf &left, const ci::Quatf &right );
+        //! Sets the orientation the next render reprojects to, usually read from the Device right before rendering
+        void        setLatestOrientation( const ci::Quatf &latest );
+        //! Sets the vertical field of view in degrees of the eye projections, used to reproject the lookups
+        void        setFov( float fovDegrees ) { mFov = fovDegrees; mUniformsDirty = mMeshUniformsDirty = true; }
+        float       getFov() const { return mFov; }
+        
+        //! Sets the directory where the distortion meshes and shader binaries are cached between runs, an empty path disables the cache
+        void    setCacheDirectory( const ci::fs::path &directory );
+        //! Returns the directory where the distortion meshes and shader binaries are cached
+        const ci::fs::path& getCacheDirectory() const { return mCacheDirectory; }
+        
+        //! Sets what the distortion shaders do with the lookups outside of the eyes, black by default
+        void    setClampMode( DistortionShaderVariant::ClampMode mode );
+        DistortionShaderVariant::ClampMode getClampMode() const { return mClampMode; }
+        //! Builds the shaders of every timewarp, multi resolution and mesh combination, so switching between them never stalls a frame
+        void    precompileShaders();
+        //! Returns the cache of the shader variants, with their compile and link times
+        const DistortionShaderCacheRef& getShaderCache() const { return mShaderCache; }
         
     protected:
         DistortionHelper( bool chromaticAbCorrection = true );
         
+        //! Shader parameters and quad of one eye, only updated when the rect or the parameters change
+        struct EyeBlock {
+            EyeWarpParams   params;
+            ci::Vec2f       positions[4];
+            ci::Vec2f       texCoords[4];
+        };
+        struct UniformLocations {
+            GLint   lensCenter, screenCenter, scale, scaleIn, hmdWarpParam, chromAbParam, texture0, timewarpMatrix, timewarpScale;
+            GLint   texture1, centerTexCoordsLeft, centerTexCoordsRight, texCoordScale;
+        };
+        struct MeshUniformLocations {
+            GLint   texture0, texCoordScale, timewarpMatrixLeft, timewarpMatrixRight, lensCenterLeft, lensCenterRight, timewarpScale;
+            GLint   texture1, centerTexCoordsLeft, centerTexCoordsRight;
+        };
+        
+        //! Returns the shader variant of the current features
+        DistortionShaderVariant getShaderVariant( bool mesh ) const;
+        void    loadShaders();
+        //! Switches between the single texture and the MultiResTarget shaders
+        void    enableMultiRes( bool enable );
+        //! Binds the center texture of the MultiResTarget being recomposed and sends its regions to the bound shader
+        void    bindCenterTexture( GLint texture1, GLint centerTexCoordsLeft, GLint centerTexCoordsRight );
+        void    unbindCenterTexture();
+        void    setTexCoordScale( const ci::Vec2f &scale );
+        void    renderTexture( const ci::gl::Texture &texture, const ci::Rectf &rect );
+        //! Writes the timewarp matrix of \a eye to \a m
+        void    calcTimewarpMatrix( Eye eye, float m[9] ) const;
+        
+        void    renderPerPixel( const ci::gl::Texture &texture, const ci::Rectf &rect );
+        void    updateEyeBlocks( const ci::gl::Texture &texture, const ci::Rectf &rect );
+        void    renderMesh( const ci::gl::Texture &texture, const ci::Rectf &rect );
+        void    updateMesh( const DistortionCache::Key &key );
+        
         ci::Vec4f           mDistortionParams;
         float               mDistortionScale;
         
         bool                mUseChromaticAbCorrection;
         ci::Vec4f           mChromaticAbCorrection;
-        ci::gl::GlslProgRef mShader;
+        ShaderProgramRef    mShader;
+        
+        bool                mUseMesh;
+        DistortionMeshRef   mMesh;
+        ci::gl::VboMeshRef  mVboMesh;
+        ShaderProgramRef    mMeshShader;
+        ci::fs::path        mCacheDirectory;
+        ci::Vec2i           mMeshResolution;
+        
+        EyeBlock            mEyeBlocks[2];
+        UniformLocations    mUniforms;
+        MeshUniformLocations mMeshUniforms;
+        ci::Rectf           mEyeBlocksRect;
+        ci::Rectf           mEyeBlocksTexCoords;
+        bool                mEyeBlocksDirty;
+        bool                mUniformsDirty;
+        bool                mMeshUniformsDirty;
+        uint32_t            mNumGlCalls;
+        
+        bool                mTimewarp;
+        float               mFov;
+        ci::Quatf           mRenderOrientations[2];
+        ci::Quatf           mLatestOrientation;
+        
+        bool                mMultiRes;
+        MultiResTargetRef   mMultiResTarget;
+        ci::Vec2f           mTexCoordScale;
+        
+        DistortionShaderCacheRef    mShaderCache;
+        bool                mShadersDirty;
+        DistortionShaderVariant::ClampMode mClampMode;
     };
 };
 
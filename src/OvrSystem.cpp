@@ -0,0 +1,33 @@
+//
+//  OvrSystem.cpp
+//  OculusSDKTest
+//
+
+#include "OvrSystem.h"
+
+#include "OVR.h"
+
+#include <mutex>
+
+namespace ovr {
+
+    namespace {
+
+        // Guards may be created on a background thread while another one is destroyed
+        std::mutex  sSystemMutex;
+        size_t      sSystemCount = 0;
+    }
+
+    OvrSystemGuard::OvrSystemGuard()
+    {
+        std::lock_guard<std::mutex> lock( sSystemMutex );
+        if( sSystemCount++ == 0 )
+            OVR::System::Init( OVR::Log::ConfigureDefaultLog( OVR::LogMask_All ) );
+    }
+    OvrSystemGuard::~OvrSystemGuard()
+    {
+        std::lock_guard<std::mutex> lock( sSystemMutex );
+        if( --sSystemCount == 0 )
+            OVR::System::Destroy();
+    }
+}
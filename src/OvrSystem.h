@@ -0,0 +1,24 @@
+//
+//  OvrSystem.h
+//  OculusSDKTest
+//
+//  Reference count of OVR::System.
+//
+
+#pragma once
+
+namespace ovr {
+
+    //! Keeps OVR::System initialized while at least one guard is alive. OVR::System::Init() and Destroy() aren't
+    //! refcounted, the Devices and the engines using the OVR allocator each hold a guard instead of calling them
+    class OvrSystemGuard
+    {
+    public:
+        OvrSystemGuard();
+        ~OvrSystemGuard();
+
+    private:
+        OvrSystemGuard( const OvrSystemGuard& );
+        OvrSystemGuard& operator=( const OvrSystemGuard& );
+    };
+}
@@ -0,0 +1,113 @@
+//
+//  PixelDensity.cpp
+//  OculusSDKTest
+//
+
+#include "PixelDensity.h"
+
+#include <algorithm>
+
+using namespace ci;
+
+namespace ovr {
+
+    namespace {
+        // Display samples per region and axis, enough for every region reached by the warp to get some
+        const int   SamplesPerRegion    = 8;
+        // Step of the finite differences, in the normalized side by side space
+        const float Step                = 1e-4f;
+    }
+
+    PixelDensityMapRef PixelDensityMap::create( const Vec4f &distortionParams, float distortionScale, float aspectRatio, int columns, int rows )
+    {
+        PixelDensityMapRef map( new PixelDensityMap( std::max( columns, 1 ), std::max( rows, 1 ) ) );
+        map->calc( distortionParams, distortionScale, aspectRatio );
+        return map;
+    }
+
+    PixelDensityMap::PixelDensityMap( int columns, int rows )
+    : mDensities( columns * rows, Vec2f::zero() ), mNumColumns( columns ), mNumRows( rows ), mMaxDensity( 0.0f )
+    {
+    }
+
+    void PixelDensityMap::calc( const Vec4f &distortionParams, float distortionScale, float aspectRatio )
+    {
+        // Walk the display pixels of the left eye, each one reads the render target at its warped
+        // position. The inverse of the warp jacobian there gives how many display pixels one render
+        // target pixel spans along each axis, the resolution the render target needs at that spot.
+        EyeWarpParams eye   = EyeWarpParams::calc( EYE_LEFT, aspectRatio, distortionScale );
+        int samplesX        = mNumColumns * SamplesPerRegion;
+        int samplesY        = mNumRows * SamplesPerRegion;
+        for( int y = 0; y < samplesY; y++ ){
+            for( int x = 0; x < samplesX; x++ ){
+                Vec2f in01( 0.5f * ( x + 0.5f ) / samplesX, ( y + 0.5f ) / samplesY );
+                Vec2f tc, tcX0, tcX1, tcY0, tcY1;
+                if( ! hmdWarp( eye, distortionParams, in01, &tc ) )
+                    continue;
+                hmdWarp( eye, distortionParams, in01 - Vec2f( Step, 0.0f ), &tcX0 );
+                hmdWarp( eye, distortionParams, in01 + Vec2f( Step, 0.0f ), &tcX1 );
+                hmdWarp( eye, distortionParams, in01 - Vec2f( 0.0f, Step ), &tcY0 );
+                hmdWarp( eye, distortionParams, in01 + Vec2f( 0.0f, Step ), &tcY1 );
+
+                Vec2f dx    = ( tcX1 - tcX0 ) / ( 2.0f * Step );
+                Vec2f dy    = ( tcY1 - tcY0 ) / ( 2.0f * Step );
+                float det   = dx.x * dy.y - dy.x * dx.y;
+                if( fabsf( det ) < 1e-12f )
+                    continue;
+
+                // Columns of the inverse jacobian, display pixels per render target pixel
+                Vec2f density( sqrtf( dy.y * dy.y + dx.y * dx.y ) / fabsf( det ), sqrtf( dy.x * dy.x + dx.x * dx.x ) / fabsf( det ) );
+
+                int column  = std::min( std::max( (int) ( tc.x * 2.0f * mNumColumns ), 0 ), mNumColumns - 1 );
+                int row     = std::min( std::max( (int) ( tc.y * mNumRows ), 0 ), mNumRows - 1 );
+                Vec2f &cell = mDensities[row * mNumColumns + column];
+                cell.x      = std::max( cell.x, density.x );
+                cell.y      = std::max( cell.y, density.y );
+                mMaxDensity = std::max( mMaxDensity, std::max( density.x, density.y ) );
+            }
+        }
+    }
+
+    Vec2f PixelDensityMap::getDensity( const Vec2f &position ) const
+    {
+        int column  = std::min( std::max( (int) ( position.x * mNumColumns ), 0 ), mNumColumns - 1 );
+        int row     = std::min( std::max( (int) ( position.y * mNumRows ), 0 ), mNumRows - 1 );
+        return getDensity( column, row );
+    }
+
+    Rectf PixelDensityMap::calcCenterRegion( float centerDensity, float peripheryScale ) const
+    {
+        float threshold = centerDensity * peripheryScale;
+        int x1 = mNumColumns, y1 = mNumRows, x2 = -1, y2 = -1;
+        int densestColumn = 0, densestRow = 0;
+        float densest = 0.0f;
+        for( int row = 0; row < mNumRows; row++ ){
+            for( int column = 0; column < mNumColumns; column++ ){
+                Vec2f density   = getDensity( column, row );
+                float d         = std::max( density.x, density.y );
+                if( d > densest ){
+                    densest         = d;
+                    densestColumn   = column;
+                    densestRow      = row;
+                }
+                if( d > threshold ){
+                    x1 = std::min( x1, column ); x2 = std::max( x2, column );
+                    y1 = std::min( y1, row );    y2 = std::max( y2, row );
+                }
+            }
+        }
+
+        // Keep at least the densest region so the center target never ends up empty
+        if( x2 < 0 ){
+            x1 = x2 = densestColumn;
+            y1 = y2 = densestRow;
+        }
+        return Rectf( (float) x1 / mNumColumns, (float) y1 / mNumRows, (float) ( x2 + 1 ) / mNumColumns, (float) ( y2 + 1 ) / mNumRows );
+    }
+
+    float PixelDensityMap::calcShadedFraction( const Rectf &centerRegion, float peripheryScale )
+    {
+        float centerArea = centerRegion.calcArea();
+        return centerArea + peripheryScale * peripheryScale * ( 1.0f - centerArea );
+    }
+}
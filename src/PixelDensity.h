@@ -0,0 +1,63 @@
+//
+//  PixelDensity.h
+//  OculusSDKTest
+//
+//  Render target resolution actually needed by the lens warp.
+//
+
+#pragma once
+
+#include "cinder/Rect.h"
+#include "cinder/Vector.h"
+
+#include "Distortion.h"
+
+#include <memory>
+#include <vector>
+
+namespace ovr {
+
+    typedef std::shared_ptr<class PixelDensityMap> PixelDensityMapRef;
+
+    //! Grid over the render target of one eye holding how many render target pixels
+    //! each region needs per display pixel. A density of 1 matches a render target of
+    //! the display size, the barrel warp magnifies the center and squeezes the edges so
+    //! the density peaks at the lens center, around the distortion scale, and drops outwards.
+    //! Positions are normalized in the left eye, origin at the bottom left like the GL viewport,
+    //! the right eye is its mirror.
+    class PixelDensityMap
+    {
+    public:
+        //! Returns the map of \a columns x \a rows regions of an eye whose width divided by its height is \a aspectRatio
+        static PixelDensityMapRef create( const ci::Vec4f &distortionParams, float distortionScale, float aspectRatio = 0.8f, int columns = 16, int rows = 20 );
+
+        //! Returns the horizontal and vertical densities of a region, 0 when the display never samples it
+        ci::Vec2f   getDensity( int column, int row ) const { return mDensities[row * mNumColumns + column]; }
+        //! Returns the densities of the region containing \a position
+        ci::Vec2f   getDensity( const ci::Vec2f &position ) const;
+        //! Returns the highest density of both axes over the eye
+        float       getMaxDensity() const { return mMaxDensity; }
+
+        //! Returns the bounds of the regions that need more than \a centerDensity * \a peripheryScale, the area that
+        //! has to stay at \a centerDensity when the rest of the eye is rendered at \a peripheryScale times its resolution
+        ci::Rectf   calcCenterRegion( float centerDensity, float peripheryScale ) const;
+        //! Returns the number of pixels shaded with \a centerRegion at full resolution and the rest
+        //! at \a peripheryScale, relative to a single render target at full resolution
+        static float calcShadedFraction( const ci::Rectf &centerRegion, float peripheryScale );
+        //! Returns \a region of the left eye mirrored to the right eye
+        static ci::Rectf mirror( const ci::Rectf &region ) { return ci::Rectf( 1.0f - region.x2, region.y1, 1.0f - region.x1, region.y2 ); }
+
+        int     getNumColumns() const { return mNumColumns; }
+        int     getNumRows() const { return mNumRows; }
+
+    protected:
+        PixelDensityMap( int columns, int rows );
+
+        void    calc( const ci::Vec4f &distortionParams, float distortionScale, float aspectRatio );
+
+        std::vector<ci::Vec2f>  mDensities;
+        int                     mNumColumns;
+        int                     mNumRows;
+        float                   mMaxDensity;
+    };
+}
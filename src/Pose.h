@@ -0,0 +1,93 @@
+//
+//  Pose.h
+//  OculusSDKTest
+//
+//  Head pose utilities shared by ovr::Device and the tracking code.
+//
+
+#pragma once
+
+#include "cinder/Quaternion.h"
+#include "cinder/Vector.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ovr {
+
+    //! Timestamped head pose
+    struct Pose {
+        Pose() : time( 0 ) {}
+        Pose( double time, const ci::Quatf &orientation, const ci::Vec3f &angularVelocity )
+        : time( time ), orientation( orientation ), angularVelocity( angularVelocity ) {}
+
+        //! Seconds, on the OVR::Timer clock
+        double      time;
+        ci::Quatf   orientation;
+        //! Radians per second, in the head frame
+        ci::Vec3f   angularVelocity;
+    };
+
+    //! Returns the Hamilton product \a a * \a b, same convention as OVR::Quatf
+    inline ci::Quatf multiply( const ci::Quatf &a, const ci::Quatf &b )
+    {
+        return ci::Quatf( a.w * b.w - a.v.x * b.v.x - a.v.y * b.v.y - a.v.z * b.v.z,
+                          a.w * b.v.x + a.v.x * b.w + a.v.y * b.v.z - a.v.z * b.v.y,
+                          a.w * b.v.y - a.v.x * b.v.z + a.v.y * b.w + a.v.z * b.v.x,
+                          a.w * b.v.z + a.v.x * b.v.y - a.v.y * b.v.x + a.v.z * b.w );
+    }
+
+    //! Returns \a orientation rotated by \a angularVelocity (head frame) during \a dt seconds, like OVR::SensorFusion::GetPredictedOrientation
+    inline ci::Quatf predictOrientation( const ci::Quatf &orientation, const ci::Vec3f &angularVelocity, float dt )
+    {
+        float speed = angularVelocity.length();
+        if( speed <= 0.001f )
+            return orientation;
+
+        float halfAngle = speed * dt * 0.5f;
+        float s         = sinf( halfAngle ) / speed;
+        ci::Quatf delta( cosf( halfAngle ), angularVelocity.x * s, angularVelocity.y * s, angularVelocity.z * s );
+        return multiply( orientation, delta );
+    }
+
+    //! Returns the spherical interpolation from \a a to \a b at \a t, along the shortest arc
+    inline ci::Quatf slerp( const ci::Quatf &a, const ci::Quatf &b, float t )
+    {
+        float d     = a.w * b.w + a.v.x * b.v.x + a.v.y * b.v.y + a.v.z * b.v.z;
+        float sign  = d < 0.0f ? -1.0f : 1.0f;
+        d          *= sign;
+
+        // Close enough for a normalized lerp, and avoids dividing by a tiny sine
+        float wa, wb;
+        if( d > 0.9995f ){
+            wa = 1.0f - t;
+            wb = t;
+        }
+        else {
+            float theta = acosf( d );
+            float s     = 1.0f / sinf( theta );
+            wa          = sinf( ( 1.0f - t ) * theta ) * s;
+            wb          = sinf( t * theta ) * s;
+        }
+        wb *= sign;
+
+        ci::Quatf q( a.w * wa + b.w * wb, a.v.x * wa + b.v.x * wb, a.v.y * wa + b.v.y * wb, a.v.z * wa + b.v.z * wb );
+        float invLength = 1.0f / sqrtf( q.w * q.w + q.v.x * q.v.x + q.v.y * q.v.y + q.v.z * q.v.z );
+        return ci::Quatf( q.w * invLength, q.v.x * invLength, q.v.y * invLength, q.v.z * invLength );
+    }
+
+    //! Returns the pose at \a time between \a a and \a b, clamped to their times
+    inline Pose interpolate( const Pose &a, const Pose &b, double time )
+    {
+        double span = b.time - a.time;
+        float t     = span > 0.0 ? (float) std::min( std::max( ( time - a.time ) / span, 0.0 ), 1.0 ) : 1.0f;
+        return Pose( a.time + span * t, slerp( a.orientation, b.orientation, t ), a.angularVelocity + ( b.angularVelocity - a.angularVelocity ) * t );
+    }
+
+    //! Returns the angle in radians of the rotation between \a a and \a b
+    inline float angleBetween( const ci::Quatf &a, const ci::Quatf &b )
+    {
+        float d = fabsf( a.w * b.w + a.v.x * b.v.x + a.v.y * b.v.y + a.v.z * b.v.z );
+        return 2.0f * acosf( std::min( d, 1.0f ) );
+    }
+}
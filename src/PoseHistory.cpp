@@ -0,0 +1,238 @@
+//
+//  PoseHistory.cpp
+//  OculusSDKTest
+//
+
+#include "PoseHistory.h"
+#include "SimdLanes.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace ci;
+
+namespace ovr {
+
+    namespace {
+
+        // Same operations on a single float, for the timestamps left after the last full batch
+        inline float    set1( float v, float ) { return v; }
+        inline float    load( const float *src, float ) { return *src; }
+        inline void     store( float *dst, float v ) { *dst = v; }
+        inline float    add( float a, float b ) { return a + b; }
+        inline float    sub( float a, float b ) { return a - b; }
+        inline float    mul( float a, float b ) { return a * b; }
+        inline float    signBit( float a ) { return std::signbit( a ) ? -0.0f : 0.0f; }
+        inline float    flipSign( float a, float sign ) { return std::signbit( sign ) ? -a : a; }
+
+#if OVR_SIMD_LANES > 1
+        // interpolateLanes picks the width from its template argument
+        inline lane_t   set1( float v, lane_t ) { return set1( v ); }
+        inline lane_t   load( const float *src, lane_t ) { return load( src ); }
+#endif
+
+        // Eberly, "A Fast and Accurate Algorithm for Computing SLERP": the slerp weights expanded as polynomials
+        // of t and cos( theta ), with the last term adjusted to cancel the truncation. No trigonometry and no
+        // branches, so every lane follows the same path, and the error stays around 1e-5 degrees
+        const int   kNumSlerpTerms = 8;
+        const float kSlerpMu       = 1.85298109240830f;
+        const float kSlerpU[kNumSlerpTerms] = { 1.0f / 3.0f, 1.0f / 10.0f, 1.0f / 21.0f, 1.0f / 36.0f, 1.0f / 55.0f, 1.0f / 78.0f, 1.0f / 105.0f, kSlerpMu / 136.0f };
+        const float kSlerpV[kNumSlerpTerms] = { 1.0f / 3.0f, 2.0f / 5.0f, 3.0f / 7.0f, 4.0f / 9.0f, 5.0f / 11.0f, 6.0f / 13.0f, 7.0f / 15.0f, kSlerpMu * 8.0f / 17.0f };
+
+        //! Lookups gathered for one batch, one entry per lane
+        struct Gathered {
+            float aw[8], ax[8], ay[8], az[8];
+            float bw[8], bx[8], by[8], bz[8];
+            float avx[8], avy[8], avz[8];
+            float bvx[8], bvy[8], bvz[8];
+            float t[8];
+        };
+
+        //! Interpolates the lookups of \a in from \a first, as many as \a T holds, and writes the orientations and angular velocities to \a out
+        template<typename T>
+        void interpolateLanes( const Gathered &in, size_t first, Gathered *out )
+        {
+            T zero      = set1( 0.0f, T() );
+            T one       = set1( 1.0f, T() );
+            T t         = load( in.t + first, zero );
+            T d         = sub( one, t );
+
+            T aw = load( in.aw + first, zero ), ax = load( in.ax + first, zero ), ay = load( in.ay + first, zero ), az = load( in.az + first, zero );
+            T bw = load( in.bw + first, zero ), bx = load( in.bx + first, zero ), by = load( in.by + first, zero ), bz = load( in.bz + first, zero );
+
+            // Shortest arc, b is negated through its weight
+            T cosTheta  = add( add( mul( aw, bw ), mul( ax, bx ) ), add( mul( ay, by ), mul( az, bz ) ) );
+            T sign      = signBit( cosTheta );
+            T xm1       = sub( flipSign( cosTheta, sign ), one );
+
+            T t2        = mul( t, t );
+            T d2        = mul( d, d );
+            T weightA   = one;
+            T weightB   = one;
+            for( int i = kNumSlerpTerms - 1; i >= 0; i-- ){
+                T u     = set1( kSlerpU[i], zero );
+                T v     = set1( kSlerpV[i], zero );
+                weightA = add( one, mul( mul( sub( mul( u, d2 ), v ), xm1 ), weightA ) );
+                weightB = add( one, mul( mul( sub( mul( u, t2 ), v ), xm1 ), weightB ) );
+            }
+            weightA     = mul( weightA, d );
+            weightB     = flipSign( mul( weightB, t ), sign );
+
+            store( out->aw + first, add( mul( aw, weightA ), mul( bw, weightB ) ) );
+            store( out->ax + first, add( mul( ax, weightA ), mul( bx, weightB ) ) );
+            store( out->ay + first, add( mul( ay, weightA ), mul( by, weightB ) ) );
+            store( out->az + first, add( mul( az, weightA ), mul( bz, weightB ) ) );
+
+            // Angular velocities are lerped
+            T avx = load( in.avx + first, zero ), avy = load( in.avy + first, zero ), avz = load( in.avz + first, zero );
+            store( out->avx + first, add( avx, mul( sub( load( in.bvx + first, zero ), avx ), t ) ) );
+            store( out->avy + first, add( avy, mul( sub( load( in.bvy + first, zero ), avy ), t ) ) );
+            store( out->avz + first, add( avz, mul( sub( load( in.bvz + first, zero ), avz ), t ) ) );
+        }
+    }
+
+    PoseHistoryRef PoseHistory::create( size_t capacity )
+    {
+        return PoseHistoryRef( new PoseHistory( capacity ) );
+    }
+
+    PoseHistory::PoseHistory( size_t capacity )
+    : mStart( 0 ), mSize( 0 )
+    {
+        size_t size = 2;
+        while( size < capacity )
+            size <<= 1;
+        mMask = size - 1;
+
+        mTimes.resize( size );
+        for( std::vector<float> *component : { &mOrientationW, &mOrientationX, &mOrientationY, &mOrientationZ, &mAngularVelocityX, &mAngularVelocityY, &mAngularVelocityZ } )
+            component->resize( size );
+    }
+
+    size_t PoseHistory::getNumLanes()
+    {
+        return OVR_SIMD_LANES;
+    }
+
+    void PoseHistory::push( const Pose &pose )
+    {
+        if( mSize && pose.time <= getNewestTime() )
+            return;
+
+        size_t slot;
+        if( mSize <= mMask )
+            slot = ( mStart + mSize++ ) & mMask;
+        else {
+            slot    = mStart;
+            mStart  = ( mStart + 1 ) & mMask;
+        }
+
+        mTimes[slot]            = pose.time;
+        mOrientationW[slot]     = pose.orientation.w;
+        mOrientationX[slot]     = pose.orientation.v.x;
+        mOrientationY[slot]     = pose.orientation.v.y;
+        mOrientationZ[slot]     = pose.orientation.v.z;
+        mAngularVelocityX[slot] = pose.angularVelocity.x;
+        mAngularVelocityY[slot] = pose.angularVelocity.y;
+        mAngularVelocityZ[slot] = pose.angularVelocity.z;
+    }
+
+    void PoseHistory::push( const Pose *poses, size_t count )
+    {
+        for( size_t i = 0; i < count; i++ )
+            push( poses[i] );
+    }
+
+    Pose PoseHistory::getPose( size_t index ) const
+    {
+        size_t slot = ( mStart + index ) & mMask;
+        return Pose( mTimes[slot], Quatf( mOrientationW[slot], mOrientationX[slot], mOrientationY[slot], mOrientationZ[slot] ), Vec3f( mAngularVelocityX[slot], mAngularVelocityY[slot], mAngularVelocityZ[slot] ) );
+    }
+
+    bool PoseHistory::findInterval( double time, size_t *a, size_t *b, float *t ) const
+    {
+        // Clamped to the ends
+        if( time <= getOldestTime() || mSize == 1 ){
+            *a = *b = mStart;
+            *t = 0.0f;
+            return time == getOldestTime();
+        }
+        if( time >= getNewestTime() ){
+            *a = *b = ( mStart + mSize - 1 ) & mMask;
+            *t = 0.0f;
+            return time == getNewestTime();
+        }
+
+        // Last pose at or before time, the oldest one is before it and the newest one after
+        size_t low = 0, high = mSize - 1;
+        while( high - low > 1 ){
+            size_t mid = ( low + high ) / 2;
+            if( mTimes[( mStart + mid ) & mMask] <= time )
+                low = mid;
+            else
+                high = mid;
+        }
+        *a = ( mStart + low ) & mMask;
+        *b = ( mStart + high ) & mMask;
+        *t = (float) ( ( time - mTimes[*a] ) / ( mTimes[*b] - mTimes[*a] ) );
+        return true;
+    }
+
+    bool PoseHistory::sample( double time, Pose *pose ) const
+    {
+        if( empty() )
+            return false;
+        sample( &time, 1, pose );
+        return true;
+    }
+
+    size_t PoseHistory::sample( const double *times, size_t count, Pose *poses ) const
+    {
+        if( empty() )
+            return 0;
+
+        const size_t lanes  = OVR_SIMD_LANES;
+        size_t numInside    = 0;
+        Gathered in, out;
+        for( size_t first = 0; first < count; first += lanes ){
+            size_t batch = std::min( lanes, count - first );
+
+            // Gather the two poses around each timestamp in lanes
+            for( size_t l = 0; l < batch; l++ ){
+                size_t a, b;
+                if( findInterval( times[first + l], &a, &b, &in.t[l] ) )
+                    numInside++;
+                in.aw[l]    = mOrientationW[a];
+                in.ax[l]    = mOrientationX[a];
+                in.ay[l]    = mOrientationY[a];
+                in.az[l]    = mOrientationZ[a];
+                in.bw[l]    = mOrientationW[b];
+                in.bx[l]    = mOrientationX[b];
+                in.by[l]    = mOrientationY[b];
+                in.bz[l]    = mOrientationZ[b];
+                in.avx[l]   = mAngularVelocityX[a];
+                in.avy[l]   = mAngularVelocityY[a];
+                in.avz[l]   = mAngularVelocityZ[a];
+                in.bvx[l]   = mAngularVelocityX[b];
+                in.bvy[l]   = mAngularVelocityY[b];
+                in.bvz[l]   = mAngularVelocityZ[b];
+            }
+
+#if OVR_SIMD_LANES > 1
+            if( batch == lanes )
+                interpolateLanes<lane_t>( in, 0, &out );
+            else
+#endif
+            for( size_t l = 0; l < batch; l++ )
+                interpolateLanes<float>( in, l, &out );
+
+            for( size_t l = 0; l < batch; l++ ){
+                Pose &pose              = poses[first + l];
+                pose.time               = std::min( std::max( times[first + l], getOldestTime() ), getNewestTime() );
+                pose.orientation        = Quatf( out.aw[l], out.ax[l], out.ay[l], out.az[l] );
+                pose.angularVelocity    = Vec3f( out.avx[l], out.avy[l], out.avz[l] );
+            }
+        }
+        return numInside;
+    }
+}
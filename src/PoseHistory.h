@@ -0,0 +1,65 @@
+//
+//  PoseHistory.h
+//  OculusSDKTest
+//
+//  Timestamped pose history stored as a structure of arrays, sampled at any past time.
+//
+
+#pragma once
+
+#include "Pose.h"
+
+#include <memory>
+#include <vector>
+
+namespace ovr {
+
+    typedef std::shared_ptr<class PoseHistory> PoseHistoryRef;
+
+    //! Fixed capacity history of the latest poses, the oldest ones are dropped first. Each component is kept in
+    //! its own array so batches of lookups interpolate several timestamps at once. Not thread safe, the app
+    //! thread fills it from the poses of the sensor thread with Device::updatePoseHistory()
+    class PoseHistory
+    {
+    public:
+        //! \a capacity is rounded up to a power of two
+        static PoseHistoryRef create( size_t capacity = 1024 );
+
+        //! Appends \a pose, ignored unless it's newer than the newest pose
+        void    push( const Pose &pose );
+        //! Appends \a count \a poses, oldest first
+        void    push( const Pose *poses, size_t count );
+        void    clear() { mStart = mSize = 0; }
+
+        size_t  size() const { return mSize; }
+        bool    empty() const { return mSize == 0; }
+        size_t  getCapacity() const { return mMask + 1; }
+        double  getOldestTime() const { return mSize ? mTimes[mStart] : 0.0; }
+        double  getNewestTime() const { return mSize ? mTimes[( mStart + mSize - 1 ) & mMask] : 0.0; }
+        //! Returns the pose at \a index, 0 being the oldest
+        Pose    getPose( size_t index ) const;
+
+        //! Returns in \a pose the pose at \a time, interpolated between the poses around it and clamped to the oldest
+        //! and newest ones. Returns false if the history is empty
+        bool    sample( double time, Pose *pose ) const;
+        //! Samples the \a count \a times at once, several per instruction, in any order. Returns the number of
+        //! times within the history, the others are clamped. \a poses is left untouched if the history is empty
+        size_t  sample( const double *times, size_t count, Pose *poses ) const;
+
+        //! Returns the number of timestamps interpolated at once (1, 4 or 8)
+        static size_t getNumLanes();
+
+    protected:
+        PoseHistory( size_t capacity );
+
+        //! Returns the slot of the pose at or before \a time and the one after it, and the position of \a time between them
+        bool    findInterval( double time, size_t *a, size_t *b, float *t ) const;
+
+        std::vector<double> mTimes;
+        std::vector<float>  mOrientationW, mOrientationX, mOrientationY, mOrientationZ;
+        std::vector<float>  mAngularVelocityX, mAngularVelocityY, mAngularVelocityZ;
+        size_t              mMask;
+        size_t              mStart;
+        size_t              mSize;
+    };
+}
@@ -0,0 +1,105 @@
+//
+//  PoseRing.h
+//  OculusSDKTest
+//
+//  Single-producer / multi-reader ring of timestamped poses.
+//
+
+#pragma once
+
+#include "Pose.h"
+
+#include <atomic>
+#include <vector>
+#include <stdint.h>
+
+namespace ovr {
+
+    //! Fixed capacity ring where one thread publishes poses and any number of
+    //! threads read the latest ones without locking. Each slot is guarded by a
+    //! sequence number so readers detect and skip slots being overwritten.
+    class PoseRing
+    {
+    public:
+        //! \a capacity is rounded up to a power of two
+        explicit PoseRing( size_t capacity = 256 )
+        : mWriteCount( 0 )
+        {
+            size_t size = 1;
+            while( size < capacity )
+                size <<= 1;
+            mMask   = size - 1;
+            mSlots  = std::vector<Slot>( size );
+        }
+
+        //! Publishes \a pose, only call from the producer thread
+        void push( const Pose &pose )
+        {
+            uint64_t index  = mWriteCount.load( std::memory_order_relaxed );
+            Slot &slot      = mSlots[index & mMask];
+
+            // Odd sequence while writing, even and unique to this index once written
+            slot.sequence.store( 2 * index + 1, std::memory_order_relaxed );
+            std::atomic_thread_fence( std::memory_order_release );
+            slot.pose = pose;
+            slot.sequence.store( 2 * index + 2, std::memory_order_release );
+            mWriteCount.store( index + 1, std::memory_order_release );
+        }
+
+        //! Copies the most recent pose to \a pose, returns false if nothing has been published yet
+        bool getLatest( Pose *pose ) const
+        {
+            // Only fails if the producer laps the reader, retrying with the new head is enough
+            for( int attempt = 0; attempt < 4; attempt++ ){
+                uint64_t count = mWriteCount.load( std::memory_order_acquire );
+                if( count == 0 )
+                    return false;
+                if( read( count - 1, pose ) )
+                    return true;
+            }
+            return false;
+        }
+
+        //! Copies up to \a maxPoses of the most recent poses to \a poses, newest first. Returns the number of poses copied
+        size_t getHistory( Pose *poses, size_t maxPoses ) const
+        {
+            uint64_t count  = mWriteCount.load( std::memory_order_acquire );
+            size_t numRead  = 0;
+            // Leave one slot of margin for the producer
+            uint64_t available = std::min<uint64_t>( count, mMask );
+            for( uint64_t i = 0; i < available && numRead < maxPoses; i++ ){
+                if( ! read( count - 1 - i, &poses[numRead] ) )
+                    break;
+                numRead++;
+            }
+            return numRead;
+        }
+
+        //! Returns the number of poses published since creation
+        uint64_t    getNumPublished() const { return mWriteCount.load( std::memory_order_acquire ); }
+        size_t      getCapacity() const { return mMask + 1; }
+
+    protected:
+        struct Slot {
+            Slot() : sequence( 0 ) {}
+            Slot( const Slot &other ) : sequence( 0 ), pose( other.pose ) {}
+            std::atomic<uint64_t>   sequence;
+            Pose                    pose;
+        };
+
+        bool read( uint64_t index, Pose *pose ) const
+        {
+            const Slot &slot    = mSlots[index & mMask];
+            uint64_t expected   = 2 * index + 2;
+            if( slot.sequence.load( std::memory_order_acquire ) != expected )
+                return false;
+            *pose = slot.pose;
+            std::atomic_thread_fence( std::memory_order_acquire );
+            return slot.sequence.load( std::memory_order_relaxed ) == expected;
+        }
+
+        std::vector<Slot>       mSlots;
+        uint64_t                mMask;
+        std::atomic<uint64_t>   mWriteCount;
+    };
+}
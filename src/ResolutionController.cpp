@@ -0,0 +1,70 @@
+//
+//  ResolutionController.cpp
+//  OculusSDKTest
+//
+
+#include "ResolutionController.h"
+
+#include <algorithm>
+
+using namespace ci;
+
+namespace ovr {
+
+    const size_t ResolutionController::HISTORY_SIZE;
+
+    ResolutionControllerRef ResolutionController::create( const Vec2i &maxSize, const ResolutionPolicy::Options &options )
+    {
+        return ResolutionControllerRef( new ResolutionController( maxSize, options ) );
+    }
+
+    ResolutionController::ResolutionController( const Vec2i &maxSize, const ResolutionPolicy::Options &options )
+    : mPolicy( options ), mGpuTimer( GpuTimer::create() ), mEnabled( true ), mMaxSize( maxSize )
+    {
+        updateSize();
+    }
+
+    void ResolutionController::beginFrame()
+    {
+        mCpuTimer.start();
+        if( mGpuTimer )
+            mGpuTimer->begin();
+    }
+
+    void ResolutionController::endFrame()
+    {
+        mCpuTimer.stop();
+        if( mGpuTimer )
+            mGpuTimer->end();
+
+        // Keep the last GPU time known until a newer frame completes
+        double gpuTime;
+        mLastTiming.cpuTime = mCpuTimer.getSeconds() * 1000.0;
+        if( mGpuTimer && mGpuTimer->getElapsed( &gpuTime ) )
+            mLastTiming.gpuTime = gpuTime;
+
+        mHistory.push_back( mLastTiming );
+        if( mHistory.size() > HISTORY_SIZE )
+            mHistory.pop_front();
+
+        if( mEnabled ){
+            mPolicy.update( mLastTiming );
+            updateSize();
+        }
+    }
+
+    void ResolutionController::enable( bool enable )
+    {
+        mEnabled = enable;
+        mPolicy.reset( mPolicy.getOptions().maxScale );
+        updateSize();
+    }
+
+    void ResolutionController::updateSize()
+    {
+        // Even width so both eyes get the same number of columns
+        float scale = mPolicy.getScale();
+        mSize.x     = std::min( 2 * std::max( (int) ( mMaxSize.x * 0.5f * scale + 0.5f ), 1 ), mMaxSize.x );
+        mSize.y     = std::min( std::max( (int) ( mMaxSize.y * scale + 0.5f ), 1 ), mMaxSize.y );
+    }
+}
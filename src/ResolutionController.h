@@ -0,0 +1,72 @@
+//
+//  ResolutionController.h
+//  OculusSDKTest
+//
+//  Dynamic render resolution inside a preallocated side by side target.
+//
+
+#pragma once
+
+#include "cinder/Timer.h"
+#include "cinder/Vector.h"
+
+#include "GpuTimer.h"
+#include "ResolutionPolicy.h"
+
+#include <deque>
+
+namespace ovr {
+
+    typedef std::shared_ptr<class ResolutionController> ResolutionControllerRef;
+
+    //! Times each frame on the CPU and the GPU and shrinks or grows the viewport both eyes are
+    //! rendered to, following a ResolutionPolicy. The eyes stay side by side in the bottom left
+    //! corner of the target so the distortion only has to scale its texture coordinates.
+    class ResolutionController
+    {
+    public:
+        //! \a maxSize is the size of the preallocated side by side render target
+        static ResolutionControllerRef create( const ci::Vec2i &maxSize, const ResolutionPolicy::Options &options = ResolutionPolicy::Options() );
+
+        //! Starts timing a frame, call before its first GL command
+        void    beginFrame();
+        //! Ends timing the frame and picks the scale of the next one, call after its last GL command and before the swap
+        void    endFrame();
+
+        //! Stops scaling and goes back to the full target when disabled
+        void    enable( bool enable = true );
+        bool    isEnabled() const { return mEnabled; }
+
+        //! Returns the size of the viewport covering both eyes, the left eye is its left half
+        const ci::Vec2i&    getSize() const { return mSize; }
+        //! Returns the texture coordinates scale matching getSize(), to pass to DistortionHelper::render()
+        ci::Vec2f           getTexCoordScale() const { return ci::Vec2f( (float) mSize.x / mMaxSize.x, (float) mSize.y / mMaxSize.y ); }
+        const ci::Vec2i&    getMaxSize() const { return mMaxSize; }
+        float               getScale() const { return mPolicy.getScale(); }
+
+        //! Returns the timing fed to the policy by the last endFrame(), the GPU time lags a few frames behind
+        const FrameTiming&              getLastTiming() const { return mLastTiming; }
+        //! Returns the timings of the last frames, oldest first, in the form saveFrameTimings() expects
+        std::vector<FrameTiming>        getHistory() const { return std::vector<FrameTiming>( mHistory.begin(), mHistory.end() ); }
+        const ResolutionPolicy&         getPolicy() const { return mPolicy; }
+        //! Returns whether the GPU time is measured, otherwise the policy only sees the CPU time
+        bool                            isGpuTimed() const { return (bool) mGpuTimer; }
+
+        //! Number of frames kept in the history
+        static const size_t HISTORY_SIZE = 1000;
+
+    protected:
+        ResolutionController( const ci::Vec2i &maxSize, const ResolutionPolicy::Options &options );
+
+        void    updateSize();
+
+        ResolutionPolicy        mPolicy;
+        GpuTimerRef             mGpuTimer;
+        ci::Timer               mCpuTimer;
+        bool                    mEnabled;
+        ci::Vec2i               mMaxSize;
+        ci::Vec2i               mSize;
+        FrameTiming             mLastTiming;
+        std::deque<FrameTiming> mHistory;
+    };
+}
@@ -0,0 +1,111 @@
+//
+//  ResolutionPolicy.cpp
+//  OculusSDKTest
+//
+
+#include "ResolutionPolicy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+namespace ovr {
+
+    ResolutionPolicy::Options::Options()
+    : frameBudget( 1000.0 / 60.0 ),
+    minScale( 0.5f ),
+    maxScale( 1.0f ),
+    highWater( 0.9f ),
+    lowWater( 0.7f ),
+    framesToDecrease( 2 ),
+    framesToIncrease( 60 ),
+    settleFrames( 4 ),
+    maxIncrease( 0.05f )
+    {
+    }
+
+    ResolutionPolicy::ResolutionPolicy( const Options &options )
+    : mOptions( options )
+    {
+        reset( options.maxScale );
+    }
+
+    void ResolutionPolicy::reset( float scale )
+    {
+        mScale          = std::min( std::max( scale, mOptions.minScale ), mOptions.maxScale );
+        mFramesOver     = 0;
+        mFramesUnder    = 0;
+        mFramesToSettle = 0;
+        mNumChanges     = 0;
+    }
+
+    float ResolutionPolicy::update( const FrameTiming &timing )
+    {
+        if( mFramesToSettle > 0 ){
+            mFramesToSettle--;
+            return mScale;
+        }
+
+        double cost = std::max( timing.cpuTime, timing.gpuTime );
+        double load = cost / mOptions.frameBudget;
+        mFramesOver     = load > mOptions.highWater ? mFramesOver + 1 : 0;
+        mFramesUnder    = load < mOptions.lowWater ? mFramesUnder + 1 : 0;
+
+        bool decrease = mFramesOver >= mOptions.framesToDecrease && mScale > mOptions.minScale;
+        bool increase = mFramesUnder >= mOptions.framesToIncrease && mScale < mOptions.maxScale;
+        if( ! decrease && ! increase )
+            return mScale;
+
+        // The cost follows the pixel count, aim for the middle of the band in one step
+        double target   = 0.5 * ( mOptions.highWater + mOptions.lowWater );
+        float scale     = mScale * (float) sqrt( target / std::max( load, 1e-3 ) );
+        if( increase )
+            scale = std::min( scale, mScale + mOptions.maxIncrease );
+        scale = std::min( std::max( scale, mOptions.minScale ), mOptions.maxScale );
+
+        if( scale != mScale ){
+            mScale = scale;
+            mNumChanges++;
+            mFramesToSettle = mOptions.settleFrames;
+        }
+        mFramesOver     = 0;
+        mFramesUnder    = 0;
+        return mScale;
+    }
+
+    std::vector<float> ResolutionPolicy::simulate( const std::vector<FrameTiming> &trace, const Options &options )
+    {
+        ResolutionPolicy policy( options );
+        std::vector<float> scales;
+        scales.reserve( trace.size() );
+        for( std::vector<FrameTiming>::const_iterator it = trace.begin(); it != trace.end(); ++it ){
+            float scale = policy.getScale();
+            scales.push_back( scale );
+            policy.update( FrameTiming( it->cpuTime, it->gpuTime >= 0.0 ? it->gpuTime * scale * scale : it->gpuTime ) );
+        }
+        return scales;
+    }
+
+    std::vector<FrameTiming> loadFrameTimings( const ci::fs::path &path )
+    {
+        std::vector<FrameTiming> timings;
+        std::ifstream in( path.string().c_str() );
+        std::string line;
+        while( std::getline( in, line ) ){
+            double cpuTime, gpuTime;
+            if( sscanf( line.c_str(), "%lf , %lf", &cpuTime, &gpuTime ) == 2 )
+                timings.push_back( FrameTiming( cpuTime, gpuTime ) );
+        }
+        return timings;
+    }
+
+    bool saveFrameTimings( const ci::fs::path &path, const std::vector<FrameTiming> &timings )
+    {
+        std::ofstream out( path.string().c_str(), std::ios::trunc );
+        out << "cpu_ms,gpu_ms" << std::endl;
+        for( std::vector<FrameTiming>::const_iterator it = timings.begin(); it != timings.end(); ++it )
+            out << it->cpuTime << "," << it->gpuTime << std::endl;
+        return (bool) out;
+    }
+}
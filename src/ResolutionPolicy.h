@@ -0,0 +1,86 @@
+//
+//  ResolutionPolicy.h
+//  OculusSDKTest
+//
+//  Render scale decisions from frame timings, without any GL or clock dependency.
+//
+
+#pragma once
+
+#include "cinder/Filesystem.h"
+
+#include <vector>
+
+namespace ovr {
+
+    //! Timing of one frame
+    struct FrameTiming {
+        FrameTiming() : cpuTime( 0.0 ), gpuTime( -1.0 ) {}
+        FrameTiming( double cpuTime, double gpuTime ) : cpuTime( cpuTime ), gpuTime( gpuTime ) {}
+
+        //! Milliseconds spent by the CPU on the frame
+        double  cpuTime;
+        //! Milliseconds spent by the GPU on the scaled passes, negative when unknown
+        double  gpuTime;
+    };
+
+    //! Picks the render scale of the next frame from the timings of the previous ones. The scale
+    //! drops as soon as a couple of frames run over the high water mark of the budget, and only grows
+    //! back after a long run of frames under the low water mark, so it settles instead of oscillating.
+    //! A frame costs the longer of its CPU and GPU times, so a spike on either side misses the budget
+    //! and the scale only grows back while both are under the low water mark.
+    class ResolutionPolicy
+    {
+    public:
+        struct Options {
+            Options();
+
+            //! Milliseconds available per frame, 1000 / refresh rate
+            double  frameBudget;
+            float   minScale;
+            float   maxScale;
+            //! Fraction of the budget above which the scale drops
+            float   highWater;
+            //! Fraction of the budget below which the scale can grow
+            float   lowWater;
+            //! Consecutive frames over the high water mark before dropping
+            int     framesToDecrease;
+            //! Consecutive frames under the low water mark before growing
+            int     framesToIncrease;
+            //! Frames ignored after a change, the GPU timings arrive a few frames late
+            int     settleFrames;
+            //! Largest increase of the scale at once
+            float   maxIncrease;
+        };
+
+        explicit ResolutionPolicy( const Options &options = Options() );
+
+        //! Feeds the timing of a frame rendered at getScale() and returns the scale of the next frame
+        float   update( const FrameTiming &timing );
+        //! Goes back to \a scale, clamped to the options range, and forgets the previous frames
+        void    reset( float scale );
+
+        //! Returns the width and height scale of the render viewport
+        float           getScale() const { return mScale; }
+        //! Returns the number of scale changes since the creation or the last reset()
+        size_t          getNumChanges() const { return mNumChanges; }
+        const Options&  getOptions() const { return mOptions; }
+
+        //! Runs a policy over \a trace, whose GPU times are taken as the costs at full scale and
+        //! scaled by the pixel count of each frame. Returns the scale used by each frame
+        static std::vector<float> simulate( const std::vector<FrameTiming> &trace, const Options &options = Options() );
+
+    protected:
+        Options mOptions;
+        float   mScale;
+        int     mFramesOver;
+        int     mFramesUnder;
+        int     mFramesToSettle;
+        size_t  mNumChanges;
+    };
+
+    //! Reads comma separated CPU and GPU milliseconds, one frame per line. Lines that don't start with two numbers are skipped
+    std::vector<FrameTiming>    loadFrameTimings( const ci::fs::path &path );
+    //! Writes \a timings in the format read by loadFrameTimings(), returns false if the file can't be written
+    bool                        saveFrameTimings( const ci::fs::path &path, const std::vector<FrameTiming> &timings );
+}
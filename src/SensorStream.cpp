@@ -0,0 +1,198 @@
+//
+//  SensorStream.cpp
+//  OculusSDKTest
+//
+
+#include "SensorStream.h"
+
+#include <cstring>
+
+using namespace ci;
+
+namespace ovr {
+
+    namespace {
+
+        // Plain copy of the HMDInfo fields used by the stereo setup,
+        // HMDInfo itself holds OVR::String members and can't be written as is
+        struct HmdSnapshot {
+            uint32_t    hResolution, vResolution;
+            float       hScreenSize, vScreenSize;
+            float       vScreenCenter;
+            float       eyeToScreenDistance;
+            float       lensSeparationDistance;
+            float       interpupillaryDistance;
+            float       distortionK[4];
+            float       chromaAbCorrection[4];
+            int32_t     desktopX, desktopY;
+            char        displayDeviceName[32];
+        };
+
+        struct Header {
+            char        magic[4];
+            uint32_t    version;
+            uint32_t    sampleSize;
+            uint32_t    padding;
+            HmdSnapshot hmd;
+        };
+
+        const char Magic[4] = { 'O', 'V', 'R', 'S' };
+
+        HmdSnapshot toSnapshot( const OVR::HMDInfo &info )
+        {
+            HmdSnapshot snapshot;
+            std::memset( &snapshot, 0, sizeof( HmdSnapshot ) );
+            snapshot.hResolution            = info.HResolution;
+            snapshot.vResolution            = info.VResolution;
+            snapshot.hScreenSize            = info.HScreenSize;
+            snapshot.vScreenSize            = info.VScreenSize;
+            snapshot.vScreenCenter          = info.VScreenCenter;
+            snapshot.eyeToScreenDistance    = info.EyeToScreenDistance;
+            snapshot.lensSeparationDistance = info.LensSeparationDistance;
+            snapshot.interpupillaryDistance = info.InterpupillaryDistance;
+            snapshot.desktopX               = info.DesktopX;
+            snapshot.desktopY               = info.DesktopY;
+            for( int i = 0; i < 4; i++ ){
+                snapshot.distortionK[i]         = info.DistortionK[i];
+                snapshot.chromaAbCorrection[i]  = info.ChromaAbCorrection[i];
+            }
+            std::strncpy( snapshot.displayDeviceName, info.DisplayDeviceName, sizeof( snapshot.displayDeviceName ) - 1 );
+            return snapshot;
+        }
+
+        OVR::HMDInfo fromSnapshot( const HmdSnapshot &snapshot )
+        {
+            OVR::HMDInfo info;
+            info.HResolution            = snapshot.hResolution;
+            info.VResolution            = snapshot.vResolution;
+            info.HScreenSize            = snapshot.hScreenSize;
+            info.VScreenSize            = snapshot.vScreenSize;
+            info.VScreenCenter          = snapshot.vScreenCenter;
+            info.EyeToScreenDistance    = snapshot.eyeToScreenDistance;
+            info.LensSeparationDistance = snapshot.lensSeparationDistance;
+            info.InterpupillaryDistance = snapshot.interpupillaryDistance;
+            info.DesktopX               = snapshot.desktopX;
+            info.DesktopY               = snapshot.desktopY;
+            for( int i = 0; i < 4; i++ ){
+                info.DistortionK[i]         = snapshot.distortionK[i];
+                info.ChromaAbCorrection[i]  = snapshot.chromaAbCorrection[i];
+            }
+            std::memcpy( info.DisplayDeviceName, snapshot.displayDeviceName, sizeof( snapshot.displayDeviceName ) );
+            info.DisplayDeviceName[sizeof( snapshot.displayDeviceName ) - 1] = 0;
+            return info;
+        }
+    }
+
+    OVR::MessageBodyFrame toBodyFrame( const SensorSample &sample )
+    {
+        OVR::MessageBodyFrame frame( NULL );
+        frame.TimeDelta     = sample.timeDelta;
+        frame.Acceleration  = OVR::Vector3f( sample.acceleration.x, sample.acceleration.y, sample.acceleration.z );
+        frame.RotationRate  = OVR::Vector3f( sample.rotationRate.x, sample.rotationRate.y, sample.rotationRate.z );
+        frame.MagneticField = OVR::Vector3f( sample.magneticField.x, sample.magneticField.y, sample.magneticField.z );
+        frame.Temperature   = sample.temperature;
+        return frame;
+    }
+
+    SensorSample toSensorSample( const OVR::MessageBodyFrame &frame, double time )
+    {
+        SensorSample sample;
+        sample.time             = time;
+        sample.timeDelta        = frame.TimeDelta;
+        sample.acceleration     = Vec3f( frame.Acceleration.x, frame.Acceleration.y, frame.Acceleration.z );
+        sample.rotationRate     = Vec3f( frame.RotationRate.x, frame.RotationRate.y, frame.RotationRate.z );
+        sample.magneticField    = Vec3f( frame.MagneticField.x, frame.MagneticField.y, frame.MagneticField.z );
+        sample.temperature      = frame.Temperature;
+        return sample;
+    }
+
+
+    SensorRecorderRef SensorRecorder::create( const fs::path &path, const OVR::HMDInfo &info )
+    {
+        SensorRecorderRef recorder( new SensorRecorder() );
+        recorder->mStream.open( path.string().c_str(), std::ios::binary | std::ios::trunc );
+        if( ! recorder->mStream )
+            return SensorRecorderRef();
+
+        Header header;
+        std::memset( &header, 0, sizeof( Header ) );
+        std::memcpy( header.magic, Magic, 4 );
+        header.version      = SensorRecording::VERSION;
+        header.sampleSize   = sizeof( SensorSample );
+        header.hmd          = toSnapshot( info );
+        recorder->mStream.write( reinterpret_cast<const char*>( &header ), sizeof( Header ) );
+        return recorder;
+    }
+
+    SensorRecorder::SensorRecorder()
+    : mNumSamples( 0 ), mTime( 0.0 )
+    {
+    }
+    SensorRecorder::~SensorRecorder()
+    {
+        close();
+    }
+
+    void SensorRecorder::addFrame( const OVR::MessageBodyFrame &frame )
+    {
+        // Timestamps are rebuilt from the deltas so the stream doesn't depend on the recording clock
+        std::lock_guard<std::mutex> lock( mMutex );
+        if( mNumSamples )
+            mTime += frame.TimeDelta;
+        SensorSample sample = toSensorSample( frame, mTime );
+        if( mStream.is_open() ){
+            mStream.write( reinterpret_cast<const char*>( &sample ), sizeof( SensorSample ) );
+            mNumSamples++;
+        }
+    }
+    void SensorRecorder::addSample( const SensorSample &sample )
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        if( mStream.is_open() ){
+            mStream.write( reinterpret_cast<const char*>( &sample ), sizeof( SensorSample ) );
+            mTime = sample.time;
+            mNumSamples++;
+        }
+    }
+    void SensorRecorder::close()
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        if( mStream.is_open() )
+            mStream.close();
+    }
+
+
+    const uint32_t SensorRecording::VERSION;
+
+    SensorRecording::SensorRecording()
+    : mSamples( NULL ), mNumSamples( 0 ), mNextSample( 0 )
+    {
+    }
+
+    bool SensorRecording::nextSample( SensorSample *sample )
+    {
+        if( mNextSample >= mNumSamples )
+            return false;
+        *sample = mSamples[mNextSample++];
+        return true;
+    }
+
+    SensorRecordingRef SensorRecording::open( const fs::path &path )
+    {
+        SensorRecordingRef recording( new SensorRecording() );
+        recording->mFile = MappedFile::open( path );
+        if( ! recording->mFile || recording->mFile->getSize() < sizeof( Header ) )
+            return SensorRecordingRef();
+
+        Header header;
+        std::memcpy( &header, recording->mFile->getData(), sizeof( Header ) );
+        if( std::memcmp( header.magic, Magic, 4 ) != 0 || header.version != VERSION || header.sampleSize != sizeof( SensorSample ) )
+            return SensorRecordingRef();
+
+        // The sample count comes from the file size so an interrupted recording stays readable
+        recording->mHMDInfo     = fromSnapshot( header.hmd );
+        recording->mSamples     = reinterpret_cast<const SensorSample*>( recording->mFile->getData() + sizeof( Header ) );
+        recording->mNumSamples  = ( recording->mFile->getSize() - sizeof( Header ) ) / sizeof( SensorSample );
+        return recording;
+    }
+}
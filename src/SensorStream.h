@@ -0,0 +1,117 @@
+//
+//  SensorStream.h
+//  OculusSDKTest
+//
+//  Recording and playback of the raw sensor stream of an HMD.
+//
+
+#pragma once
+
+#include "OVR.h"
+
+#include "cinder/Filesystem.h"
+#include "cinder/Vector.h"
+
+#include "MappedFile.h"
+
+#include <fstream>
+#include <mutex>
+
+namespace ovr {
+
+    //! Raw IMU sample, the content of an OVR::MessageBodyFrame. Stored as is in the recordings
+    struct SensorSample {
+        //! Seconds since the first sample of the stream
+        double      time;
+        //! Seconds since the previous sample
+        float       timeDelta;
+        //! Meters per second squared
+        ci::Vec3f   acceleration;
+        //! Radians per second
+        ci::Vec3f   rotationRate;
+        //! Gauss
+        ci::Vec3f   magneticField;
+        //! Degrees Celsius
+        float       temperature;
+    };
+
+    //! Returns \a sample as a message that can be sent to OVR::SensorFusion::OnMessage
+    OVR::MessageBodyFrame   toBodyFrame( const SensorSample &sample );
+    //! Returns the content of \a frame timestamped at \a time
+    SensorSample            toSensorSample( const OVR::MessageBodyFrame &frame, double time );
+
+    typedef std::shared_ptr<class SensorSource> SensorSourceRef;
+
+    //! Stream of sensor samples able to drive a Device without hardware
+    class SensorSource
+    {
+    public:
+        virtual ~SensorSource() {}
+
+        //! Returns the description of the HMD producing the samples
+        virtual const OVR::HMDInfo& getHMDInfo() const = 0;
+        //! Copies the next sample to \a sample, returns false at the end of the stream
+        virtual bool    nextSample( SensorSample *sample ) = 0;
+        //! Goes back to the first sample
+        virtual void    rewind() = 0;
+    };
+
+    typedef std::shared_ptr<class SensorRecorder> SensorRecorderRef;
+
+    //! Writes the HMDInfo and the sensor samples of a session to a binary file
+    class SensorRecorder
+    {
+    public:
+        //! Returns an empty ptr if the file can't be created
+        static SensorRecorderRef create( const ci::fs::path &path, const OVR::HMDInfo &info );
+        ~SensorRecorder();
+
+        //! Appends \a frame to the recording, can be called from the sensor thread
+        void    addFrame( const OVR::MessageBodyFrame &frame );
+        //! Appends \a sample to the recording, can be called from the sensor thread
+        void    addSample( const SensorSample &sample );
+        //! Writes the pending samples and closes the file
+        void    close();
+
+        size_t  getNumSamples() const { return mNumSamples; }
+
+    protected:
+        SensorRecorder();
+
+        std::mutex      mMutex;
+        std::ofstream   mStream;
+        size_t          mNumSamples;
+        double          mTime;
+    };
+
+    typedef std::shared_ptr<class SensorRecording> SensorRecordingRef;
+
+    //! Memory mapped recording made by a SensorRecorder
+    class SensorRecording : public SensorSource
+    {
+    public:
+        //! Returns an empty ptr if the file is missing or isn't a valid recording
+        static SensorRecordingRef open( const ci::fs::path &path );
+
+        virtual const OVR::HMDInfo& getHMDInfo() const { return mHMDInfo; }
+        virtual bool    nextSample( SensorSample *sample );
+        virtual void    rewind() { mNextSample = 0; }
+
+        const SensorSample*     getSamples() const { return mSamples; }
+        size_t                  getNumSamples() const { return mNumSamples; }
+        //! Returns the time of the last sample
+        double                  getDuration() const { return mNumSamples ? mSamples[mNumSamples - 1].time : 0.0; }
+
+        //! Bump when the layout of the file changes
+        static const uint32_t   VERSION = 1;
+
+    protected:
+        SensorRecording();
+
+        MappedFileRef           mFile;
+        OVR::HMDInfo            mHMDInfo;
+        const SensorSample*     mSamples;
+        size_t                  mNumSamples;
+        size_t                  mNextSample;
+    };
+}
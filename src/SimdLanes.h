@@ -0,0 +1,68 @@
+//
+//  SimdLanes.h
+//  OculusSDKTest
+//
+//  Float lanes of the widest instruction set the build targets. Internal, only included from .cpp files.
+//
+
+#pragma once
+
+#if defined( __AVX__ )
+    #include <immintrin.h>
+    #define OVR_SIMD_LANES 8
+#elif defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 1 )
+    #include <xmmintrin.h>
+    #define OVR_SIMD_LANES 4
+#else
+    #define OVR_SIMD_LANES 1
+#endif
+
+namespace ovr {
+
+    namespace {
+
+#if OVR_SIMD_LANES == 8
+        typedef __m256 lane_t;
+        inline lane_t   set1( float v ) { return _mm256_set1_ps( v ); }
+        inline lane_t   load( const float *src ) { return _mm256_loadu_ps( src ); }
+        inline void     store( float *dst, lane_t v ) { _mm256_storeu_ps( dst, v ); }
+        inline lane_t   laneIndices() { return _mm256_setr_ps( 0, 1, 2, 3, 4, 5, 6, 7 ); }
+        inline lane_t   add( lane_t a, lane_t b ) { return _mm256_add_ps( a, b ); }
+        inline lane_t   sub( lane_t a, lane_t b ) { return _mm256_sub_ps( a, b ); }
+        inline lane_t   mul( lane_t a, lane_t b ) { return _mm256_mul_ps( a, b ); }
+        inline lane_t   div( lane_t a, lane_t b ) { return _mm256_div_ps( a, b ); }
+        inline lane_t   max( lane_t a, lane_t b ) { return _mm256_max_ps( a, b ); }
+        inline lane_t   sqrt( lane_t a ) { return _mm256_sqrt_ps( a ); }
+        inline lane_t   abs( lane_t a ) { return _mm256_andnot_ps( _mm256_set1_ps( -0.0f ), a ); }
+        inline lane_t   negate( lane_t a ) { return _mm256_sub_ps( _mm256_setzero_ps(), a ); }
+        inline lane_t   signBit( lane_t a ) { return _mm256_and_ps( a, _mm256_set1_ps( -0.0f ) ); }
+        inline lane_t   flipSign( lane_t a, lane_t sign ) { return _mm256_xor_ps( a, sign ); }
+        inline lane_t   cmpge( lane_t a, lane_t b ) { return _mm256_cmp_ps( a, b, _CMP_GE_OQ ); }
+        inline lane_t   cmple( lane_t a, lane_t b ) { return _mm256_cmp_ps( a, b, _CMP_LE_OQ ); }
+        inline lane_t   andMask( lane_t a, lane_t b ) { return _mm256_and_ps( a, b ); }
+        inline lane_t   allTrue() { return _mm256_castsi256_ps( _mm256_set1_epi32( -1 ) ); }
+        inline int      movemask( lane_t a ) { return _mm256_movemask_ps( a ); }
+#elif OVR_SIMD_LANES == 4
+        typedef __m128 lane_t;
+        inline lane_t   set1( float v ) { return _mm_set1_ps( v ); }
+        inline lane_t   load( const float *src ) { return _mm_loadu_ps( src ); }
+        inline void     store( float *dst, lane_t v ) { _mm_storeu_ps( dst, v ); }
+        inline lane_t   laneIndices() { return _mm_setr_ps( 0, 1, 2, 3 ); }
+        inline lane_t   add( lane_t a, lane_t b ) { return _mm_add_ps( a, b ); }
+        inline lane_t   sub( lane_t a, lane_t b ) { return _mm_sub_ps( a, b ); }
+        inline lane_t   mul( lane_t a, lane_t b ) { return _mm_mul_ps( a, b ); }
+        inline lane_t   div( lane_t a, lane_t b ) { return _mm_div_ps( a, b ); }
+        inline lane_t   max( lane_t a, lane_t b ) { return _mm_max_ps( a, b ); }
+        inline lane_t   sqrt( lane_t a ) { return _mm_sqrt_ps( a ); }
+        inline lane_t   abs( lane_t a ) { return _mm_andnot_ps( _mm_set1_ps( -0.0f ), a ); }
+        inline lane_t   negate( lane_t a ) { return _mm_sub_ps( _mm_setzero_ps(), a ); }
+        inline lane_t   signBit( lane_t a ) { return _mm_and_ps( a, _mm_set1_ps( -0.0f ) ); }
+        inline lane_t   flipSign( lane_t a, lane_t sign ) { return _mm_xor_ps( a, sign ); }
+        inline lane_t   cmpge( lane_t a, lane_t b ) { return _mm_cmpge_ps( a, b ); }
+        inline lane_t   cmple( lane_t a, lane_t b ) { return _mm_cmple_ps( a, b ); }
+        inline lane_t   andMask( lane_t a, lane_t b ) { return _mm_and_ps( a, b ); }
+        inline lane_t   allTrue() { return _mm_cmpeq_ps( _mm_setzero_ps(), _mm_setzero_ps() ); }
+        inline int      movemask( lane_t a ) { return _mm_movemask_ps( a ); }
+#endif
+    }
+}
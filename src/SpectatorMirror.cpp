@@ -0,0 +1,123 @@
+//
+//  SpectatorMirror.cpp
+//  OculusSDKTest
+//
+
+#include "SpectatorMirror.h"
+
+#include "cinder/gl/gl.h"
+
+#include <algorithm>
+
+using namespace ci;
+
+namespace ovr {
+
+    SpectatorMirror::Options::Options()
+    : size( 640, 400 ),
+    rate( 30.0f ),
+    source( SOURCE_BOTH_EYES )
+    {
+    }
+
+    SpectatorMirrorRef SpectatorMirror::create( const Options &options )
+    {
+        return SpectatorMirrorRef( new SpectatorMirror( options ) );
+    }
+
+    SpectatorMirror::SpectatorMirror( const Options &options )
+    : mOptions( options ), mLastUpdateTime( -1.0 ), mNumUpdates( 0 )
+    {
+#if defined( GL_EXT_framebuffer_blit )
+        mSupported = gl::isExtensionAvailable( "GL_EXT_framebuffer_blit" );
+#else
+        mSupported = false;
+#endif
+    }
+
+    Vec2i SpectatorMirror::calcSize( const Vec2i &sourceSize ) const
+    {
+        // Never upsampled, and fit in the largest size with the aspect ratio of the source
+        float scale = std::min( std::min( mOptions.size.x / (float) sourceSize.x, mOptions.size.y / (float) sourceSize.y ), 1.0f );
+        return Vec2i( std::max( (int) ( sourceSize.x * scale + 0.5f ), 1 ), std::max( (int) ( sourceSize.y * scale + 0.5f ), 1 ) );
+    }
+
+    Area SpectatorMirror::getSourceArea( const Area &area ) const
+    {
+        Area sourceArea = area;
+        if( mOptions.source == SOURCE_LEFT_EYE )
+            sourceArea.x2 = area.x1 + area.getWidth() / 2;
+        return sourceArea;
+    }
+
+    bool SpectatorMirror::beginUpdate( const Area &sourceArea, double time )
+    {
+        if( ! mSupported || ( mLastUpdateTime >= 0.0 && mOptions.rate > 0.0f && time - mLastUpdateTime < 1.0 / mOptions.rate ) )
+            return false;
+        mLastUpdateTime = time;
+
+        Vec2i size = calcSize( sourceArea.getSize() );
+        if( ! mFbo || mFbo.getSize() != size ){
+            gl::Fbo::Format format;
+            format.enableDepthBuffer( false );
+            mFbo = gl::Fbo( size.x, size.y, format );
+        }
+        mNumUpdates++;
+        return true;
+    }
+
+    void SpectatorMirror::blit( gl::Fbo &source, const Area &sourceArea, const Area &mirrorArea )
+    {
+#if defined( GL_EXT_framebuffer_blit )
+        // A scaled blit can't read a multisampled framebuffer, getTexture() resolves it if it isn't already
+        source.getTexture();
+        glBindFramebufferEXT( GL_READ_FRAMEBUFFER_EXT, source.getResolveId() );
+        glBindFramebufferEXT( GL_DRAW_FRAMEBUFFER_EXT, mFbo.getId() );
+        glBlitFramebufferEXT( sourceArea.x1, sourceArea.y1, sourceArea.x2, sourceArea.y2, mirrorArea.x1, mirrorArea.y1, mirrorArea.x2, mirrorArea.y2, GL_COLOR_BUFFER_BIT, GL_LINEAR );
+        glBindFramebufferEXT( GL_READ_FRAMEBUFFER_EXT, 0 );
+        glBindFramebufferEXT( GL_DRAW_FRAMEBUFFER_EXT, 0 );
+#endif
+    }
+
+    bool SpectatorMirror::update( gl::Fbo &source, const Area &area, double time )
+    {
+        Area sourceArea = getSourceArea( area );
+        if( ! beginUpdate( sourceArea, time ) )
+            return false;
+
+        blit( source, sourceArea, mFbo.getBounds() );
+        return true;
+    }
+
+    bool SpectatorMirror::update( MultiResTarget &target, double time )
+    {
+        gl::Fbo &periphery  = target.getPeripheryFbo();
+        Area sourceArea     = getSourceArea( periphery.getBounds() );
+        if( ! beginUpdate( sourceArea, time ) )
+            return false;
+
+        blit( periphery, sourceArea, mFbo.getBounds() );
+
+        // The center regions are normalized in each eye with the same bottom left origin as the framebuffers
+        int numEyes = mOptions.source == SOURCE_LEFT_EYE ? 1 : 2;
+        int eyeWidth = mFbo.getWidth() / numEyes;
+        for( int i = 0; i < numEyes; i++ ){
+            Eye eye             = (Eye) i;
+            const Rectf &region = target.getCenterRegion( eye );
+            Area mirrorArea( eyeWidth * i + (int) ( region.x1 * eyeWidth ), (int) ( region.y1 * mFbo.getHeight() ),
+                             eyeWidth * i + (int) ( region.x2 * eyeWidth ), (int) ( region.y2 * mFbo.getHeight() ) );
+            blit( target.getCenterFbo(), target.getCenterViewport( eye ), mirrorArea );
+        }
+        return true;
+    }
+
+    void SpectatorMirror::draw( const Area &bounds )
+    {
+        if( ! mFbo )
+            return;
+
+        gl::Texture texture = mFbo.getTexture();
+        Rectf fit           = Rectf( texture.getBounds() ).getCenteredFit( Rectf( bounds ), true );
+        gl::draw( texture, fit );
+    }
+}
@@ -0,0 +1,78 @@
+//
+//  SpectatorMirror.h
+//  OculusSDKTest
+//
+//  Downsampled copy of the rendered eyes for a desktop window.
+//
+
+#pragma once
+
+#include "cinder/gl/Fbo.h"
+#include "cinder/Area.h"
+
+#include "MultiResTarget.h"
+
+namespace ovr {
+
+    typedef std::shared_ptr<class SpectatorMirror> SpectatorMirrorRef;
+
+    //! Copies the undistorted eyes already rendered for the HMD to a small texture with a single framebuffer blit,
+    //! at a lower resolution and rate. A desktop window then only draws that texture, spectators never cost a
+    //! second render of the scene. The texture is shared with the other windows of the app
+    class SpectatorMirror
+    {
+    public:
+        //! Part of the eyes copied
+        enum Source { SOURCE_BOTH_EYES, SOURCE_LEFT_EYE };
+
+        struct Options {
+            Options();
+
+            //! Largest size of the mirror texture, the source is fit in it with its aspect ratio
+            ci::Vec2i   size;
+            //! Copies per second, 0 copies every frame
+            float       rate;
+            Source      source;
+        };
+
+        static SpectatorMirrorRef create( const Options &options = Options() );
+
+        //! Blits \a area of the side by side eyes of \a source to the mirror texture unless the last copy is more recent than the rate
+        //! allows, \a time being in seconds. Multisampled sources are resolved first. Returns whether it copied. Call with no framebuffer bound
+        bool    update( ci::gl::Fbo &source, const ci::Area &area, double time );
+        //! Same as above for the eyes of \a target, the center regions are copied over the periphery they are masked out of
+        bool    update( MultiResTarget &target, double time );
+        //! Draws the mirror texture centered in \a bounds of the current window, letterboxed
+        void    draw( const ci::Area &bounds );
+
+        void    setSource( Source source ) { mOptions.source = source; }
+        Source  getSource() const { return mOptions.source; }
+        void    setRate( float rate ) { mOptions.rate = rate; }
+        float   getRate() const { return mOptions.rate; }
+        //! Returns whether the driver can blit between framebuffers, without it update() never copies
+        bool    isSupported() const { return mSupported; }
+
+        //! Returns the mirror texture, empty until the first copy
+        ci::gl::Texture getTexture() { return mFbo ? mFbo.getTexture() : ci::gl::Texture(); }
+        //! Returns the number of copies made so far
+        size_t  getNumUpdates() const { return mNumUpdates; }
+
+    protected:
+        SpectatorMirror( const Options &options );
+
+        //! Returns the size the mirror texture takes for a \a sourceSize source
+        ci::Vec2i   calcSize( const ci::Vec2i &sourceSize ) const;
+        //! Returns the part of \a area copied with the current source
+        ci::Area    getSourceArea( const ci::Area &area ) const;
+        //! Returns whether a copy is due at \a time and resizes the mirror for \a sourceArea if so
+        bool        beginUpdate( const ci::Area &sourceArea, double time );
+        //! Blits \a sourceArea of \a source, resolved first, to \a mirrorArea of the mirror
+        void        blit( ci::gl::Fbo &source, const ci::Area &sourceArea, const ci::Area &mirrorArea );
+
+        Options         mOptions;
+        ci::gl::Fbo     mFbo;
+        double          mLastUpdateTime;
+        size_t          mNumUpdates;
+        bool            mSupported;
+    };
+}
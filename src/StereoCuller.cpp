@@ -0,0 +1,181 @@
+//
+//  StereoCuller.cpp
+//  OculusSDKTest
+//
+
+#include "StereoCuller.h"
+#include "SimdLanes.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using namespace ci;
+
+namespace ovr {
+
+    namespace {
+
+        struct PlaneD {
+            double n[3];
+            double d;
+        };
+
+        // Gribb-Hartmann extraction, rows of the column-major viewProjection
+        void extractPlanes( const Matrix44f &viewProjection, PlaneD planes[6] )
+        {
+            const float *m = viewProjection.m;
+            for( int i = 0; i < 6; i++ ){
+                int row         = i / 2;
+                double sign     = ( i % 2 ) ? -1.0 : 1.0;
+                double a        = m[3] + sign * m[row];
+                double b        = m[7] + sign * m[4 + row];
+                double c        = m[11] + sign * m[8 + row];
+                double d        = m[15] + sign * m[12 + row];
+                double length   = std::sqrt( a * a + b * b + c * c );
+                planes[i].n[0]  = a / length;
+                planes[i].n[1]  = b / length;
+                planes[i].n[2]  = c / length;
+                planes[i].d     = d / length;
+            }
+        }
+
+        void cross( const double *a, const double *b, double *out )
+        {
+            out[0] = a[1] * b[2] - a[2] * b[1];
+            out[1] = a[2] * b[0] - a[0] * b[2];
+            out[2] = a[0] * b[1] - a[1] * b[0];
+        }
+
+        // Point shared by three planes, in double to keep the far corners accurate
+        void intersect( const PlaneD &p1, const PlaneD &p2, const PlaneD &p3, double *out )
+        {
+            double c23[3], c31[3], c12[3];
+            cross( p2.n, p3.n, c23 );
+            cross( p3.n, p1.n, c31 );
+            cross( p1.n, p2.n, c12 );
+            double denom = p1.n[0] * c23[0] + p1.n[1] * c23[1] + p1.n[2] * c23[2];
+            for( int i = 0; i < 3; i++ )
+                out[i] = -( p1.d * c23[i] + p2.d * c31[i] + p3.d * c12[i] ) / denom;
+        }
+
+        inline float maxScale( const Matrix44f &m )
+        {
+            float x = m.m[0] * m.m[0] + m.m[1] * m.m[1] + m.m[2] * m.m[2];
+            float y = m.m[4] * m.m[4] + m.m[5] * m.m[5] + m.m[6] * m.m[6];
+            float z = m.m[8] * m.m[8] + m.m[9] * m.m[9] + m.m[10] * m.m[10];
+            return std::sqrt( std::max( x, std::max( y, z ) ) );
+        }
+    }
+
+    StereoCullerRef StereoCuller::create()
+    {
+        return StereoCullerRef( new StereoCuller() );
+    }
+
+    StereoCuller::StereoCuller()
+    : mNumTested( 0 ), mNumVisible( 0 ), mCullTime( 0.0 )
+    {
+        // Accept everything until a camera is set
+        for( int i = 0; i < 6; i++ ){
+            mPlanes[i].normal   = Vec3f::zero();
+            mPlanes[i].distance = 1.0f;
+        }
+    }
+
+    size_t StereoCuller::getNumLanes()
+    {
+        return OVR_SIMD_LANES;
+    }
+
+    void StereoCuller::setCamera( const CameraStereoHMD &camera )
+    {
+        Matrix44f viewProjections[2];
+        camera.getViewProjectionMatrices( viewProjections );
+
+        PlaneD eyePlanes[2][6];
+        double corners[16][3];
+        for( int eye = 0; eye < 2; eye++ ){
+            extractPlanes( viewProjections[eye], eyePlanes[eye] );
+            for( int i = 0; i < 8; i++ )
+                intersect( eyePlanes[eye][i & 1], eyePlanes[eye][2 + ( ( i >> 1 ) & 1 )], eyePlanes[eye][4 + ( i >> 2 )], corners[eye * 8 + i] );
+        }
+
+        // For each side, keep the plane of the eye that needs to be pushed out the least
+        // to also contain all the corners of the other eye, which keeps it conservative
+        for( int i = 0; i < 6; i++ ){
+            double bestPush = 0.0;
+            for( int eye = 0; eye < 2; eye++ ){
+                const PlaneD &plane = eyePlanes[eye][i];
+                double d = plane.d;
+                for( int c = 0; c < 16; c++ )
+                    d = std::max( d, -( plane.n[0] * corners[c][0] + plane.n[1] * corners[c][1] + plane.n[2] * corners[c][2] ) );
+                
+                double push = d - plane.d;
+                if( eye == 0 || push < bestPush ){
+                    bestPush            = push;
+                    mPlanes[i].normal   = Vec3f( plane.n[0], plane.n[1], plane.n[2] );
+                    mPlanes[i].distance = d;
+                }
+            }
+        }
+    }
+
+    size_t StereoCuller::cull( const Matrix44f *transforms, size_t count, float radius, Matrix44f *visible )
+    {
+        auto start          = std::chrono::high_resolution_clock::now();
+        size_t numVisible   = 0;
+        size_t i            = 0;
+
+#if OVR_SIMD_LANES > 1
+        const size_t lanes = OVR_SIMD_LANES;
+        for( ; i + lanes <= count; i += lanes ){
+            // Transpose the centers and the scale of the lanes
+            float x[lanes], y[lanes], z[lanes], sx[lanes], sy[lanes], sz[lanes];
+            for( size_t l = 0; l < lanes; l++ ){
+                const float *m = transforms[i + l].m;
+                x[l]    = m[12];
+                y[l]    = m[13];
+                z[l]    = m[14];
+                sx[l]   = m[0] * m[0] + m[1] * m[1] + m[2] * m[2];
+                sy[l]   = m[4] * m[4] + m[5] * m[5] + m[6] * m[6];
+                sz[l]   = m[8] * m[8] + m[9] * m[9] + m[10] * m[10];
+            }
+            lane_t cx       = load( x );
+            lane_t cy       = load( y );
+            lane_t cz       = load( z );
+            lane_t r        = mul( set1( radius ), sqrt( max( load( sx ), max( load( sy ), load( sz ) ) ) ) );
+            lane_t minDist  = negate( r );
+
+            lane_t inside   = allTrue();
+            for( int p = 0; p < 6; p++ ){
+                const Plane &plane = mPlanes[p];
+                lane_t dist = add( add( add( mul( set1( plane.normal.x ), cx ), mul( set1( plane.normal.y ), cy ) ), mul( set1( plane.normal.z ), cz ) ), set1( plane.distance ) );
+                inside      = andMask( inside, cmpge( dist, minDist ) );
+            }
+
+            // Compact the survivors
+            int mask = movemask( inside );
+            for( size_t l = 0; l < lanes; l++ ){
+                if( mask & ( 1 << l ) )
+                    visible[numVisible++] = transforms[i + l];
+            }
+        }
+#endif
+
+        for( ; i < count; i++ ){
+            const Matrix44f &m  = transforms[i];
+            float r             = radius * maxScale( m );
+            bool inside         = true;
+            for( int p = 0; p < 6 && inside; p++ )
+                inside = mPlanes[p].normal.x * m.m[12] + mPlanes[p].normal.y * m.m[13] + mPlanes[p].normal.z * m.m[14] + mPlanes[p].distance >= -r;
+            if( inside )
+                visible[numVisible++] = m;
+        }
+
+        mNumTested  = count;
+        mNumVisible = numVisible;
+        mCullTime   = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+        return numVisible;
+    }
+}
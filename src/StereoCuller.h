@@ -0,0 +1,60 @@
+//
+//  StereoCuller.h
+//  OculusSDKTest
+//
+//  Frustum culling of instances against both eyes of a CameraStereoHMD at once.
+//
+
+#pragma once
+
+#include "cinder/Matrix.h"
+#include "cinder/Vector.h"
+
+#include "CameraStereoHMD.h"
+
+namespace ovr {
+
+    typedef std::shared_ptr<class StereoCuller> StereoCullerRef;
+
+    //! Tests bounding spheres against a single frustum containing both eye frustums,
+    //! several instances at a time, and compacts the visible ones.
+    class StereoCuller
+    {
+    public:
+        //! Plane where dot( normal, p ) + distance >= 0 is inside
+        struct Plane {
+            ci::Vec3f   normal;
+            float       distance;
+        };
+        
+        static StereoCullerRef create();
+        
+        //! Builds the frustum from the current matrices of both eyes of \a camera
+        void    setCamera( const CameraStereoHMD &camera );
+        //! Copies the \a count \a transforms whose bounding sphere intersects the frustum to \a visible, in order, and returns how many were copied.
+        //! The spheres are centered on the translation of each transform, \a radius is scaled by its largest axis
+        size_t  cull( const ci::Matrix44f *transforms, size_t count, float radius, ci::Matrix44f *visible );
+        
+        //! Returns the left, right, bottom, top, near and far planes of the combined frustum
+        const Plane*    getPlanes() const { return mPlanes; }
+        
+        //! Returns the number of instances tested by the last cull()
+        size_t  getNumTested() const { return mNumTested; }
+        //! Returns the number of instances rejected by the last cull()
+        size_t  getNumCulled() const { return mNumTested - mNumVisible; }
+        size_t  getNumVisible() const { return mNumVisible; }
+        //! Returns the duration of the last cull() in milliseconds
+        double  getCullTime() const { return mCullTime; }
+        
+        //! Returns the number of spheres tested at once (1, 4 or 8)
+        static size_t getNumLanes();
+        
+    protected:
+        StereoCuller();
+        
+        Plane   mPlanes[6];
+        size_t  mNumTested;
+        size_t  mNumVisible;
+        double  mCullTime;
+    };
+}
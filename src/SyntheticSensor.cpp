@@ -0,0 +1,133 @@
+//
+//  SyntheticSensor.cpp
+//  OculusSDKTest
+//
+
+#include "SyntheticSensor.h"
+#include "Pose.h"
+
+#include "cinder/CinderMath.h"
+
+#include <cstring>
+
+using namespace ci;
+
+namespace ovr {
+
+    namespace {
+
+        const float Gravity = 9.81f;
+        // Roughly the earth field in Paris, in Gauss and head coordinates (Y up, -Z forward)
+        const Vec3f MagneticField( 0.0f, -0.39f, -0.21f );
+
+        // Returns the world vector \a v seen from a head with \a orientation
+        Vec3f toHeadFrame( const Quatf &orientation, const Vec3f &v )
+        {
+            Quatf inverse( orientation.w, -orientation.v.x, -orientation.v.y, -orientation.v.z );
+            Quatf rotated = multiply( multiply( inverse, Quatf( 0.0f, v.x, v.y, v.z ) ), orientation );
+            return rotated.v;
+        }
+
+        // Values reported by a DK1 with the default lenses
+        OVR::HMDInfo createDK1Info()
+        {
+            OVR::HMDInfo info;
+            info.HResolution            = 1280;
+            info.VResolution            = 800;
+            info.HScreenSize            = 0.14976f;
+            info.VScreenSize            = 0.0936f;
+            info.VScreenCenter          = 0.0468f;
+            info.EyeToScreenDistance    = 0.041f;
+            info.LensSeparationDistance = 0.0635f;
+            info.InterpupillaryDistance = 0.064f;
+            info.DistortionK[0]         = 1.0f;
+            info.DistortionK[1]         = 0.22f;
+            info.DistortionK[2]         = 0.24f;
+            info.DistortionK[3]         = 0.0f;
+            info.ChromaAbCorrection[0]  = 0.996f;
+            info.ChromaAbCorrection[1]  = -0.004f;
+            info.ChromaAbCorrection[2]  = 1.014f;
+            info.ChromaAbCorrection[3]  = 0.0f;
+            info.DesktopX               = 0;
+            info.DesktopY               = 0;
+            std::strncpy( info.DisplayDeviceName, "Synthetic", sizeof( info.DisplayDeviceName ) - 1 );
+            return info;
+        }
+    }
+
+    SyntheticSensor::Options::Options()
+    : rate( 1000.0f ),
+    spin( 0.0f, 0.5f, 0.0f ),
+    jitter( 0.02f ),
+    saccadeInterval( 2.0f ),
+    saccadeAngle( 0.5f ),
+    saccadeDuration( 0.1f ),
+    duration( 0.0 ),
+    seed( 1 )
+    {
+    }
+
+    SyntheticSensorRef SyntheticSensor::create( const Options &options )
+    {
+        return SyntheticSensorRef( new SyntheticSensor( options ) );
+    }
+
+    SyntheticSensor::SyntheticSensor( const Options &options )
+    : mOptions( options ), mHMDInfo( createDK1Info() )
+    {
+        mOptions.rate               = math<float>::clamp( mOptions.rate, 1.0f, 1000.0f );
+        mOptions.saccadeDuration    = math<float>::max( mOptions.saccadeDuration, 0.001f );
+        rewind();
+    }
+
+    void SyntheticSensor::rewind()
+    {
+        mRandom.seed( mOptions.seed );
+        mNoise          = std::normal_distribution<float>( 0.0f, 1.0f );
+        mOrientation    = Quatf( 1.0f, 0.0f, 0.0f, 0.0f );
+        mNumSamples     = 0;
+    }
+
+    Vec3f SyntheticSensor::calcAngularVelocity( double time )
+    {
+        Vec3f angularVelocity = mOptions.spin;
+
+        // Raised cosine velocity profile, integrates to exactly saccadeAngle over saccadeDuration
+        if( mOptions.saccadeInterval > 0.0f ){
+            double interval = math<double>::max( mOptions.saccadeInterval, mOptions.saccadeDuration );
+            uint64_t turn   = (uint64_t) ( time / interval );
+            float t         = (float) ( time - turn * interval );
+            if( t < mOptions.saccadeDuration ){
+                float direction = ( turn % 2 ) ? -1.0f : 1.0f;
+                angularVelocity.y += direction * mOptions.saccadeAngle / mOptions.saccadeDuration * ( 1.0f - cosf( 2.0f * (float) M_PI * t / mOptions.saccadeDuration ) );
+            }
+        }
+
+        if( mOptions.jitter > 0.0f )
+            angularVelocity += Vec3f( mNoise( mRandom ), mNoise( mRandom ), mNoise( mRandom ) ) * mOptions.jitter;
+
+        return angularVelocity;
+    }
+
+    bool SyntheticSensor::nextSample( SensorSample *sample )
+    {
+        float timeDelta = 1.0f / mOptions.rate;
+        double time     = mNumSamples * (double) timeDelta;
+        if( mOptions.duration > 0.0 && time > mOptions.duration )
+            return false;
+
+        Vec3f angularVelocity = calcAngularVelocity( time );
+        if( mNumSamples )
+            mOrientation = predictOrientation( mOrientation, angularVelocity, timeDelta ).normalized();
+
+        // The accelerometer reads the reaction to gravity, pointing up
+        sample->time            = time;
+        sample->timeDelta       = timeDelta;
+        sample->rotationRate    = angularVelocity;
+        sample->acceleration    = toHeadFrame( mOrientation, Vec3f( 0.0f, Gravity, 0.0f ) );
+        sample->magneticField   = toHeadFrame( mOrientation, MagneticField );
+        sample->temperature     = 25.0f;
+        mNumSamples++;
+        return true;
+    }
+}
@@ -0,0 +1,69 @@
+//
+//  SyntheticSensor.h
+//  OculusSDKTest
+//
+//  Parametric sensor stream standing in for an HMD.
+//
+
+#pragma once
+
+#include "SensorStream.h"
+
+#include "cinder/Quaternion.h"
+
+#include <random>
+
+namespace ovr {
+
+    typedef std::shared_ptr<class SyntheticSensor> SyntheticSensorRef;
+
+    //! Generates the IMU samples of a DK1 following a parametric head motion:
+    //! a constant spin, gaussian jitter and periodic fast yaw turns.
+    class SyntheticSensor : public SensorSource
+    {
+    public:
+        struct Options {
+            Options();
+
+            //! Samples per second, clamped to 1000 like the DK1 tracker
+            float       rate;
+            //! Constant angular velocity in radians per second, head frame
+            ci::Vec3f   spin;
+            //! Standard deviation of the angular velocity noise in radians per second
+            float       jitter;
+            //! Seconds between two saccade-like turns, 0 disables them
+            float       saccadeInterval;
+            //! Yaw of each turn in radians, the direction alternates
+            float       saccadeAngle;
+            //! Seconds taken by each turn
+            float       saccadeDuration;
+            //! Length of the stream in seconds, 0 for endless
+            double      duration;
+            //! Seed of the jitter, the same Options always produce the same stream
+            uint32_t    seed;
+        };
+
+        static SyntheticSensorRef create( const Options &options = Options() );
+
+        //! Returns a DK1 description
+        virtual const OVR::HMDInfo& getHMDInfo() const { return mHMDInfo; }
+        virtual bool    nextSample( SensorSample *sample );
+        virtual void    rewind();
+
+        const Options&  getOptions() const { return mOptions; }
+        //! Returns the orientation reached after the last sample, the ground truth of the stream
+        ci::Quatf       getOrientation() const { return mOrientation; }
+
+    protected:
+        SyntheticSensor( const Options &options );
+
+        ci::Vec3f       calcAngularVelocity( double time );
+
+        Options         mOptions;
+        OVR::HMDInfo    mHMDInfo;
+        std::mt19937    mRandom;
+        std::normal_distribution<float> mNoise;
+        ci::Quatf       mOrientation;
+        uint64_t        mNumSamples;
+    };
+}
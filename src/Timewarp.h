@@ -0,0 +1,56 @@
+//
+//  Timewarp.h
+//  OculusSDKTest
+//
+//  CPU side of the orientation timewarp done by ovr::DistortionHelper.
+//
+
+#pragma once
+
+#include "Distortion.h"
+#include "Pose.h"
+
+#include "cinder/CinderMath.h"
+
+namespace ovr {
+
+    //! Returns the rotation taking directions of the head at \a latest to the head at \a rendered
+    inline ci::Quatf calcTimewarpDelta( const ci::Quatf &rendered, const ci::Quatf &latest )
+    {
+        ci::Quatf inverse( rendered.w, -rendered.v.x, -rendered.v.y, -rendered.v.z );
+        return multiply( inverse, latest );
+    }
+
+    //! Writes the rotation of the unit quaternion \a q to \a m as a column-major 3x3 matrix, the layout of glUniformMatrix3fv
+    inline void toRotationMatrix( const ci::Quatf &q, float m[9] )
+    {
+        float x = q.v.x, y = q.v.y, z = q.v.z, w = q.w;
+        m[0] = 1 - 2 * ( y * y + z * z ); m[3] = 2 * ( x * y - w * z );     m[6] = 2 * ( x * z + w * y );
+        m[1] = 2 * ( x * y + w * z );     m[4] = 1 - 2 * ( x * x + z * z ); m[7] = 2 * ( y * z - w * x );
+        m[2] = 2 * ( x * z - w * y );     m[5] = 2 * ( y * z + w * x );     m[8] = 1 - 2 * ( x * x + y * y );
+    }
+
+    //! Returns the scale from texture space, relative to the lens center, to the tangent of the view angle.
+    //! \a aspectRatio is the width of one eye divided by its height, \a fovDegrees the vertical field of view of the eye projection
+    inline ci::Vec2f calcTimewarpScale( float aspectRatio, float fovDegrees )
+    {
+        float tanHalfFov = tanf( fovDegrees * 0.5f * (float) M_PI / 180.0f );
+        return ci::Vec2f( 4.0f * aspectRatio, 2.0f ) * tanHalfFov;
+    }
+
+    //! Moves the lookup \a tc, computed for the latest orientation, to where the same direction lies in the frame rendered
+    //! with the older orientation. \a m is the toRotationMatrix() of calcTimewarpDelta(). Same math as the TIMEWARP shaders
+    inline ci::Vec2f timewarp( const EyeWarpParams &eye, const ci::Vec2f &timewarpScale, const float m[9], const ci::Vec2f &tc )
+    {
+        float x     = ( tc.x - eye.lensCenter.x ) * timewarpScale.x;
+        float y     = ( tc.y - eye.lensCenter.y ) * timewarpScale.y;
+        float z     = -1.0f;
+        float rx    = m[0] * x + m[3] * y + m[6] * z;
+        float ry    = m[1] * x + m[4] * y + m[7] * z;
+        float rz    = m[2] * x + m[5] * y + m[8] * z;
+
+        // Directions behind the viewer can't be reprojected, push them out of the eye
+        float w     = std::max( -rz, 0.0001f );
+        return ci::Vec2f( eye.lensCenter.x + rx / ( w * timewarpScale.x ), eye.lensCenter.y + ry / ( w * timewarpScale.y ) );
+    }
+}